@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <dlfcn.h>
+
+#include "bench_harness.h"
+#include "logger.h"
+
+
+namespace {
+    std::atomic<size_t> nb_allocations(0);
+    std::atomic<size_t> nb_bytes(0);
+}
+
+void* operator new(size_t size) {
+    nb_allocations.fetch_add(1, std::memory_order_relaxed);
+    nb_bytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+// DenseMatrix and AlignedVector allocate through posix_memalign
+extern "C" int posix_memalign(void **ptr, size_t alignment, size_t size) {
+    typedef int (*PosixMemalign)(void**, size_t, size_t);
+    static PosixMemalign next = reinterpret_cast<PosixMemalign>(dlsym(RTLD_NEXT, "posix_memalign"));
+    nb_allocations.fetch_add(1, std::memory_order_relaxed);
+    nb_bytes.fetch_add(size, std::memory_order_relaxed);
+    return next(ptr, alignment, size);
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete[](void *ptr) noexcept {
+    operator delete(ptr);
+}
+
+namespace bench {
+    typedef std::chrono::steady_clock Clock;
+
+    AllocationCounters GetAllocationCounters() {
+        return {nb_allocations.load(), nb_bytes.load()};
+    }
+
+    double RunIterations(const std::function<void()> &fn, size_t nb_iterations) {
+        auto start = Clock::now();
+        for (size_t i = 0; i < nb_iterations; ++i) {
+            fn();
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    }
+
+    void Runner::Run(const std::string &name, const std::function<void()> &fn) {
+        if (!filter_.empty() && name.find(filter_) == std::string::npos) {
+            return;
+        }
+
+        Result result;
+        result.name = name;
+        {
+            ml::ScopedLogLevel silence(ml::LogLevel::Off);
+            // warm-up call also calibrates the number of iterations
+            double once_ns = std::max(1.0, RunIterations(fn, 1));
+            result.nb_iterations = std::max<size_t>(1, min_seconds_ * 1e9 / once_ns);
+
+            std::vector<double> ns_per_op;
+            for (int run = 0; run < nb_runs_; ++run) {
+                auto before = GetAllocationCounters();
+                ns_per_op.push_back(RunIterations(fn, result.nb_iterations) / result.nb_iterations);
+                if (run == 0) {
+                    auto after = GetAllocationCounters();
+                    result.allocations_per_op = static_cast<double>(
+                        after.nb_allocations - before.nb_allocations) / result.nb_iterations;
+                    result.bytes_per_op = static_cast<double>(
+                        after.nb_bytes - before.nb_bytes) / result.nb_iterations;
+                }
+            }
+            std::sort(ns_per_op.begin(), ns_per_op.end());
+            result.ns_per_op = ns_per_op[ns_per_op.size() / 2];
+        }
+
+        std::cout << std::left << std::setw(44) << name << std::right;
+        std::cout << std::setw(16) << std::fixed << std::setprecision(1) << result.ns_per_op << " ns/op";
+        std::cout << std::setw(14) << std::setprecision(0) << result.bytes_per_op << " B/op";
+        std::cout << std::setw(10) << std::setprecision(1) << result.allocations_per_op << " allocs/op";
+        std::cout << std::defaultfloat << std::endl;
+        results_.push_back(result);
+    }
+
+    void Runner::WriteJson(std::ostream &output, size_t nb_threads) const {
+        output << "{\n  \"threads\": " << nb_threads << ",\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results_.size(); ++i) {
+            auto &result = results_[i];
+            output << (i ? "," : "") << "\n    {\"name\": \"" << result.name << "\"";
+            output << ", \"iterations\": " << result.nb_iterations;
+            output << ", \"ns_per_op\": " << result.ns_per_op;
+            output << ", \"bytes_per_op\": " << result.bytes_per_op;
+            output << ", \"allocations_per_op\": " << result.allocations_per_op << "}";
+        }
+        output << "\n  ]\n}\n";
+    }
+
+} // namespace bench
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace bench {
+
+struct AllocationCounters {
+    size_t nb_allocations;
+    size_t nb_bytes;
+};
+
+// totals since start of the process, counted by the replaced operator new
+// and by the posix_memalign wrapper behind aligned buffers
+AllocationCounters GetAllocationCounters();
+
+struct Result {
+    std::string name;
+    size_t nb_iterations = 0;
+    double ns_per_op = 0;
+    double bytes_per_op = 0;
+    double allocations_per_op = 0;
+};
+
+/**
+ * Runs fn enough times to fill min_seconds, nb_runs times over.
+ * Time is the median run, allocations are counted over the first run.
+ * The library log is silenced while fn runs.
+ */
+class Runner {
+public:
+    explicit Runner(double min_seconds = 0.2, int nb_runs = 5, const std::string &filter = "")
+        :min_seconds_(min_seconds), nb_runs_(nb_runs), filter_(filter) {}
+
+    void Run(const std::string &name, const std::function<void()> &fn);
+
+    const std::vector<Result>& GetResults() const { return results_; }
+
+    void WriteJson(std::ostream &output, size_t nb_threads) const;
+
+private:
+    double min_seconds_;
+    int nb_runs_;
+    std::string filter_;
+    std::vector<Result> results_;
+};
+
+} // namespace bench
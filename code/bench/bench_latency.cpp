@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "kernels.h"
+#include "multiclass_svm.h"
+#include "predictor.h"
+#include "quadratic.h"
+
+
+const size_t NB_LABELS = 10;
+const size_t NB_IMAGES = 2000;
+const size_t NB_WARMUP = 200;
+
+ml::MulticlassSVM MakeModel(size_t nb_dim, std::mt19937 &generator) {
+    std::normal_distribution<double> normal(0, 1);
+    size_t nb_models = NB_LABELS * (NB_LABELS - 1) / 2;
+    std::vector<std::vector<double>> models(nb_models, std::vector<double>(nb_dim));
+    std::vector<double> biases(nb_models);
+    for (size_t i = 0; i < nb_models; ++i) {
+        for (auto &value : models[i]) {
+            value = normal(generator) * 0.01;
+        }
+        biases[i] = normal(generator);
+    }
+    std::vector<int> labels(NB_LABELS);
+    for (size_t i = 0; i < NB_LABELS; ++i) {
+        labels[i] = i;
+    }
+    return ml::MulticlassSVM(models, biases, labels);
+}
+
+cv::PCA MakePCA(size_t nb_components, std::mt19937 &generator) {
+    std::normal_distribution<double> normal(0, 0.05);
+    cv::PCA pca;
+    pca.mean = cv::Mat(1, ml::MNIST_DIM, CV_64FC1);
+    pca.eigenvectors = cv::Mat(nb_components, ml::MNIST_DIM, CV_64FC1);
+    for (size_t j = 0; j < ml::MNIST_DIM; ++j) {
+        pca.mean.at<double>(0, j) = normal(generator);
+        for (size_t k = 0; k < nb_components; ++k) {
+            pca.eigenvectors.at<double>(k, j) = normal(generator);
+        }
+    }
+    return pca;
+}
+
+// per call latency of PredictOne, scratch is reused between calls
+void MeasureLatency(const std::string &name,
+                    const ml::Predictor &predictor,
+                    const std::vector<std::vector<uint8_t>> &images) {
+    ml::PredictorScratch scratch;
+    volatile int sink = 0;
+    for (size_t i = 0; i < NB_WARMUP; ++i) {
+        sink = sink + predictor.PredictOne(images[i % images.size()].data(), scratch);
+    }
+
+    std::vector<double> latencies(images.size());
+    for (size_t i = 0; i < images.size(); ++i) {
+        auto start = std::chrono::steady_clock::now();
+        sink = sink + predictor.PredictOne(images[i].data(), scratch);
+        auto finish = std::chrono::steady_clock::now();
+        latencies[i] = std::chrono::duration<double, std::micro>(finish - start).count();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) {
+        return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))];
+    };
+    std::cout << name << " (model dim " << predictor.GetModelDim() << "): ";
+    std::cout << "p50 " << percentile(0.5) << " us, p99 " << percentile(0.99);
+    std::cout << " us, max " << latencies.back() << " us" << std::endl;
+}
+
+int main() {
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<int> pixel(0, 255);
+    std::vector<std::vector<uint8_t>> images(NB_IMAGES, std::vector<uint8_t>(ml::MNIST_DIM));
+    for (auto &image : images) {
+        for (auto &value : image) {
+            value = static_cast<uint8_t>(pixel(generator));
+        }
+    }
+
+    ml::Predictor raw(MakeModel(ml::MNIST_DIM, generator));
+    MeasureLatency("raw pixels", raw, images);
+
+    for (size_t nb_components : {40, 60}) {
+        ml::Predictor preprocessed(MakeModel(ml::GetQuadraticDim(nb_components), generator),
+                                   MakePCA(nb_components, generator), 33.3, 78.6);
+        MeasureLatency("pca " + std::to_string(nb_components) + " + quadratic", preprocessed, images);
+    }
+    return 0;
+}
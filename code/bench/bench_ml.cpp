@@ -0,0 +1,209 @@
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "bench_harness.h"
+#include "binary_svm.h"
+#include "kernels.h"
+#include "logger.h"
+#include "multiclass_svm.h"
+#include "parallel.h"
+#include "predictor.h"
+#include "quadratic.h"
+#include "util.h"
+
+
+const size_t NB_LABELS = 10;
+const size_t NB_ROWS = 2000;
+const size_t NB_PROJECTED = 60;
+const size_t NB_IMAGES_ON_DISK = 200;
+
+// digit-like images: a few bright strokes over a dark background
+ml::Matrix MakeImages(size_t nb_images, std::vector<int> &labels, std::mt19937 &generator) {
+    std::uniform_int_distribution<int> noise(0, 30);
+    std::uniform_int_distribution<int> position(4, 23);
+    ml::Matrix x(nb_images, std::vector<double>(ml::MNIST_DIM));
+    labels.resize(nb_images);
+    for (size_t i = 0; i < nb_images; ++i) {
+        labels[i] = i % NB_LABELS;
+        for (auto &value : x[i]) {
+            value = noise(generator);
+        }
+        for (int stroke = 0; stroke <= labels[i] % 4; ++stroke) {
+            size_t row = position(generator);
+            for (size_t col = 4; col < 24; ++col) {
+                x[i][row * 28 + col] = 200 + noise(generator);
+            }
+        }
+    }
+    return x;
+}
+
+ml::Matrix MakeGaussian(size_t nb_rows, size_t nb_dim, std::mt19937 &generator) {
+    std::normal_distribution<double> normal(0, 1);
+    ml::Matrix x(nb_rows, std::vector<double>(nb_dim));
+    for (auto &row : x) {
+        for (auto &value : row) {
+            value = normal(generator);
+        }
+    }
+    return x;
+}
+
+ml::MulticlassSVM MakeModel(size_t nb_dim, std::mt19937 &generator) {
+    size_t nb_models = NB_LABELS * (NB_LABELS - 1) / 2;
+    auto models = MakeGaussian(nb_models, nb_dim, generator);
+    std::vector<double> biases(nb_models, 0.1);
+    std::vector<int> labels(NB_LABELS);
+    for (size_t i = 0; i < NB_LABELS; ++i) {
+        labels[i] = i;
+    }
+    return ml::MulticlassSVM(models, biases, labels);
+}
+
+// AddQuadraticInteractions as it was before the packed kernel
+ml::Matrix LegacyAddQuadraticInteractions(const ml::Matrix &x) {
+    ml::Matrix result(x);
+    for (size_t i = 0; i < x.size(); ++i) {
+        for (size_t j = 0; j < x.at(0).size(); ++j) {
+            for (size_t k = j + 1; k < x.at(0).size(); ++k) {
+                result[i].push_back(x[i][j] * x[i][k]);
+            }
+        }
+    }
+    return result;
+}
+
+std::string WriteImages(const ml::Matrix &x, const std::vector<int> &labels, size_t nb_images) {
+    std::string data_path = "bench_ml_description.txt";
+    std::ofstream description(data_path);
+    for (size_t i = 0; i < nb_images; ++i) {
+        cv::Mat mat(28, 28, CV_8UC1);
+        for (int r = 0; r < 28; ++r) {
+            for (int c = 0; c < 28; ++c) {
+                mat.at<uchar>(r, c) = static_cast<uchar>(x[i][r * 28 + c]);
+            }
+        }
+        std::string path = "bench_ml_image_" + std::to_string(i) + ".png";
+        cv::imwrite(path, mat);
+        description << path << " " << labels[i] << "\n";
+    }
+    return data_path;
+}
+
+void RemoveImages(const std::string &data_path, size_t nb_images) {
+    for (size_t i = 0; i < nb_images; ++i) {
+        std::remove(("bench_ml_image_" + std::to_string(i) + ".png").c_str());
+    }
+    std::remove(data_path.c_str());
+    std::remove((data_path + ".cache").c_str());
+}
+
+int main(int argc, char* argv[]) {
+    std::map<std::string, std::string> options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        auto pos = arg.find('=');
+        if (arg.compare(0, 2, "--") == 0) {
+            options[arg.substr(2, pos == std::string::npos ? std::string::npos : pos - 2)] =
+                pos == std::string::npos ? "" : arg.substr(pos + 1);
+        }
+    }
+    // single thread by default, so runs on different machines are comparable
+    size_t nb_threads = options.count("threads") ? std::atol(options["threads"].c_str()) : 1;
+    double min_seconds = options.count("min-time") ? std::atof(options["min-time"].c_str()) : 0.2;
+    ml::SetNumThreads(nb_threads);
+    bench::Runner runner(min_seconds, 5, options["filter"]);
+
+    std::mt19937 generator(42);
+    std::vector<int> labels;
+    auto images = MakeImages(NB_ROWS, labels, generator);
+    auto projected = MakeGaussian(NB_ROWS, NB_PROJECTED, generator);
+    auto expanded = ml::AddQuadraticInteractions(projected);
+    const size_t expanded_dim = expanded.at(0).size();
+    volatile double sink = 0;
+
+    auto raw_model = MakeModel(ml::MNIST_DIM, generator);
+    auto expanded_model = MakeModel(expanded_dim, generator);
+
+    // scoring kernels
+    for (size_t nb_dim : {ml::MNIST_DIM, expanded_dim, expanded_dim + 1}) {
+        auto rows = MakeGaussian(2, nb_dim, generator);
+        std::string suffix = "/" + std::to_string(nb_dim);
+        runner.Run("DotProduct" + suffix, [&]() { sink = sink + ml::DotProduct(rows[0], rows[1]); });
+        runner.Run("GenericDotProduct" + suffix, [&]() {
+            sink = sink + ml::GenericDotProduct(rows[0].data(), rows[1].data(), nb_dim);
+        });
+    }
+
+    ml::BinarySVM binary_svm(raw_model.GetModels()[0], 0.5);
+    runner.Run("BinarySVM::Predict/784x2000", [&]() { binary_svm.Predict(images); });
+    runner.Run("MulticlassSVM::Predict/784x2000", [&]() { raw_model.Predict(images); });
+    runner.Run("MulticlassSVM::Predict/" + std::to_string(expanded_dim) + "x2000",
+               [&]() { expanded_model.Predict(expanded); });
+
+    ml::Predictor predictor(raw_model);
+    ml::PredictorScratch scratch;
+    std::vector<uint8_t> pixels(images[0].begin(), images[0].end());
+    runner.Run("Predictor::PredictOne/784", [&]() { sink = sink + predictor.PredictOne(pixels.data(), scratch); });
+
+    // preprocessing
+    runner.Run("Normalize/784x2000", [&]() { ml::Normalize(images); });
+    auto normalized = std::get<0>(ml::Normalize(images));
+    runner.Run("CreatePCA/covariance/784x2000", [&]() { ml::CreatePCA(normalized, 0.95); });
+    runner.Run("CreatePCA/randomized/784x2000", [&]() {
+        ml::CreatePCA(normalized, 0.95, ml::PCAMethod::Randomized);
+    });
+    auto pca = ml::CreatePCA(normalized, 0.95);
+    runner.Run("ProjectPCA/784x2000", [&]() { ml::ProjectPCA(pca, normalized); });
+    runner.Run("AddQuadraticInteractions/60x2000", [&]() { ml::AddQuadraticInteractions(projected); });
+    runner.Run("ExpandQuadratic/60x2000", [&]() { ml::ExpandQuadratic(projected); });
+    runner.Run("LegacyAddQuadraticInteractions/60x2000", [&]() { LegacyAddQuadraticInteractions(projected); });
+
+    // i/o
+    std::string data_path = WriteImages(images, labels, NB_IMAGES_ON_DISK);
+    runner.Run("ReadData/" + std::to_string(NB_IMAGES_ON_DISK), [&]() { ml::ReadData(data_path); });
+    {
+        ml::ScopedLogLevel silence(ml::LogLevel::Off);
+        ml::ReadData(data_path, true, true);
+    }
+    runner.Run("ReadData/cached/" + std::to_string(NB_IMAGES_ON_DISK), [&]() {
+        ml::ReadData(data_path, true, true);
+    });
+    RemoveImages(data_path, NB_IMAGES_ON_DISK);
+
+    std::string model_path = "bench_ml_model.svm";
+    runner.Run("SaveModel/45x" + std::to_string(expanded_dim), [&]() {
+        ml::SaveModel(expanded_model, model_path);
+    });
+    runner.Run("ReadModel/45x" + std::to_string(expanded_dim), [&]() { ml::ReadModel(model_path); });
+    std::remove(model_path.c_str());
+
+    // training of a single pair
+    ml::Matrix pair_x;
+    std::vector<int> pair_y;
+    for (size_t i = 0; i < NB_ROWS; ++i) {
+        if (labels[i] < 2) {
+            pair_x.push_back(expanded[i]);
+            pair_y.push_back(labels[i] == 0 ? -1 : 1);
+        }
+    }
+    runner.Run("BinarySVM::Train/" + std::to_string(expanded_dim) + "x" + std::to_string(pair_x.size()), [&]() {
+        ml::BinarySVM svm;
+        svm.Train(pair_x, pair_y);
+    });
+
+    if (options.count("json")) {
+        std::ofstream output(options["json"]);
+        runner.WriteJson(output, nb_threads);
+        std::cout << "results written to " << options["json"] << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,293 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include <unistd.h>
+
+#include "logger.h"
+#include "memory.h"
+#include "metrics.h"
+#include "multiclass_svm.h"
+#include "parallel.h"
+#include "predictor.h"
+#include "util.h"
+
+
+// downscaled MNIST, small enough for the covariance pca to stay in the seconds
+const int IMAGE_SIZE = 14;
+const size_t NB_LABELS = 10;
+const size_t NB_TRAIN_IMAGES = 4000;
+const size_t NB_TEST_IMAGES = 1000;
+
+// phases of the scenario as timed by the library
+const char *const PHASES[] = {
+    "read_data",
+    "normalize",
+    "pca_fit",
+    "pca_project",
+    "quadratic_expansion",
+    "binary_svm_train",
+    "save_model",
+    "predictor_predict"
+};
+
+typedef std::map<std::string, double> Values;
+
+// every label is a fixed set of strokes, images shift them and add noise
+class DigitGenerator {
+public:
+    explicit DigitGenerator(unsigned seed) :generator_(seed), templates_(NB_LABELS) {
+        std::uniform_int_distribution<int> position(2, IMAGE_SIZE - 3);
+        std::uniform_int_distribution<int> orientation(0, 1);
+        for (auto &strokes : templates_) {
+            for (int k = 0; k < 3; ++k) {
+                strokes.push_back({position(generator_), orientation(generator_)});
+            }
+        }
+    }
+
+    cv::Mat Make(int label) {
+        std::uniform_int_distribution<int> noise(0, 40);
+        std::uniform_int_distribution<int> shift(-1, 1);
+        cv::Mat mat(IMAGE_SIZE, IMAGE_SIZE, CV_8UC1);
+        for (int r = 0; r < IMAGE_SIZE; ++r) {
+            for (int c = 0; c < IMAGE_SIZE; ++c) {
+                mat.at<uchar>(r, c) = static_cast<uchar>(noise(generator_));
+            }
+        }
+
+        std::bernoulli_distribution keep(0.8);
+        int offset = shift(generator_);
+        for (auto &stroke : templates_[label]) {
+            if (!keep(generator_)) {
+                continue;
+            }
+            int line = std::min(IMAGE_SIZE - 1, std::max(0, stroke.first + offset));
+            for (int k = 2; k < IMAGE_SIZE - 2; ++k) {
+                int r = stroke.second ? line : k;
+                int c = stroke.second ? k : line;
+                mat.at<uchar>(r, c) = static_cast<uchar>(180 + noise(generator_));
+            }
+        }
+        return mat;
+    }
+
+private:
+    std::mt19937 generator_;
+    std::vector<std::vector<std::pair<int, int>>> templates_;
+};
+
+std::string WriteDataSet(DigitGenerator &generator,
+                         const std::string &dir,
+                         const std::string &name,
+                         size_t nb_images,
+                         std::vector<std::string> &files) {
+    std::string data_path = dir + "/" + name + ".txt";
+    std::ofstream description(data_path);
+    for (size_t i = 0; i < nb_images; ++i) {
+        int label = i % NB_LABELS;
+        std::string path = dir + "/" + name + "_" + std::to_string(i) + ".png";
+        cv::imwrite(path, generator.Make(label));
+        description << path << " " << label << "\n";
+        files.push_back(path);
+    }
+    files.push_back(data_path);
+    return data_path;
+}
+
+// load, normalize, pca, quadratic interactions, 45 pairs, save and classify
+Values RunScenario(const std::string &dir) {
+    std::vector<std::string> files;
+    DigitGenerator generator(42);
+    std::string train_path = WriteDataSet(generator, dir, "train", NB_TRAIN_IMAGES, files);
+    std::string test_path = WriteDataSet(generator, dir, "test", NB_TEST_IMAGES, files);
+    std::string model_path = dir + "/model";
+    files.push_back(model_path + ".svm");
+    files.push_back(model_path + ".pca");
+    files.push_back(model_path + ".norm");
+
+    ml::GetMetrics().Reset();
+    auto start = std::chrono::steady_clock::now();
+    double accuracy = 0;
+    {
+        // progress output of the library would bury the report
+        ml::ScopedLogLevel silence(ml::LogLevel::Off);
+
+        auto data = ml::ReadData(train_path);
+        auto x = std::move(std::get<0>(data));
+        auto y = std::move(std::get<1>(data));
+        auto out = ml::Normalize(x);
+        x = std::move(std::get<0>(out));
+        auto pca = ml::CreatePCA(x, 0.95);
+        x = ml::ProjectPCA(pca, x);
+        x = ml::AddQuadraticInteractions(x);
+
+        ml::MulticlassSVM svm;
+        svm.Train(x, y);
+        ml::SaveModel(svm, model_path + ".svm");
+        ml::SavePCA(model_path + ".pca", pca);
+        ml::SaveNormalizationParams(model_path + ".norm", std::get<1>(out), std::get<2>(out));
+
+        auto predictor = ml::LoadPredictor(model_path, true);
+        auto test = ml::ReadData(test_path);
+        accuracy = ml::Accuracy(predictor->Predict(std::get<0>(test)), std::get<1>(test));
+    }
+
+    Values values;
+    values["total_seconds"] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (auto phase : PHASES) {
+        std::string name = std::string(phase) + "_seconds";
+        values[name] = ml::GetMetrics().GetHistogram(name).GetSum();
+    }
+    values["peak_rss_bytes"] = ml::GetMemoryUsage().peak_rss_bytes;
+    values["accuracy"] = accuracy;
+
+    for (auto &file : files) {
+        std::remove(file.c_str());
+    }
+    return values;
+}
+
+// flat object of numbers, the only shape the baseline has
+Values ReadValues(const std::string &path) {
+    std::ifstream input(path);
+    if (!input) {
+        throw std::runtime_error("can't read baseline " + path);
+    }
+    std::stringstream buffer;
+    buffer << input.rdbuf();
+    std::string text = buffer.str();
+
+    Values values;
+    size_t pos = 0;
+    while ((pos = text.find('"', pos)) != std::string::npos) {
+        size_t end = text.find('"', pos + 1);
+        size_t colon = text.find(':', end);
+        if (end == std::string::npos || colon == std::string::npos) {
+            break;
+        }
+        values[text.substr(pos + 1, end - pos - 1)] = std::atof(text.c_str() + colon + 1);
+        pos = text.find_first_of(",}", colon);
+    }
+    return values;
+}
+
+void WriteValues(const std::string &path, const Values &values) {
+    std::ofstream output(path);
+    output << std::setprecision(10) << "{";
+    const char *separator = "\n";
+    for (auto &value : values) {
+        output << separator << "  \"" << value.first << "\": " << value.second;
+        separator = ",\n";
+    }
+    output << "\n}\n";
+}
+
+bool EndsWith(const std::string &value, const std::string &suffix) {
+    return value.size() >= suffix.size() &&
+           value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// prints every measured value next to its limit, returns the number of failures
+int Compare(const Values &baseline, const Values &measured) {
+    double time_tolerance = baseline.at("time_tolerance");
+    double time_slack = baseline.at("time_slack_seconds");
+    double memory_tolerance = baseline.at("memory_tolerance");
+    double accuracy_tolerance = baseline.at("accuracy_tolerance");
+
+    int nb_failures = 0;
+    std::cout << std::left << std::setw(32) << "metric" << std::right << std::setw(14) << "baseline";
+    std::cout << std::setw(14) << "measured" << std::setw(14) << "limit" << std::endl;
+    for (auto &value : measured) {
+        auto it = baseline.find(value.first);
+        if (it == baseline.end()) {
+            std::cout << std::left << std::setw(32) << value.first << std::right;
+            std::cout << "  missing in baseline" << std::endl;
+            ++nb_failures;
+            continue;
+        }
+
+        double limit = 0;
+        bool passed = true;
+        if (EndsWith(value.first, "_seconds")) {
+            limit = it->second * (1 + time_tolerance) + time_slack;
+            passed = value.second <= limit;
+        } else if (EndsWith(value.first, "_bytes")) {
+            limit = it->second * (1 + memory_tolerance);
+            passed = value.second <= limit;
+        } else {
+            limit = it->second - accuracy_tolerance;
+            passed = value.second >= limit;
+        }
+
+        nb_failures += !passed;
+        std::cout << std::left << std::setw(32) << value.first << std::right << std::setprecision(4);
+        std::cout << std::setw(14) << it->second << std::setw(14) << value.second;
+        std::cout << std::setw(14) << limit << (passed ? "" : "  REGRESSION") << std::endl;
+    }
+    return nb_failures;
+}
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string> args;
+    std::map<std::string, std::string> options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg(argv[i]);
+        auto pos = arg.find('=');
+        if (arg.compare(0, 2, "--") != 0) {
+            args.push_back(arg);
+        } else {
+            options[arg.substr(2, pos == std::string::npos ? std::string::npos : pos - 2)] =
+                pos == std::string::npos ? "" : arg.substr(pos + 1);
+        }
+    }
+
+    if (args.empty()) {
+        std::cout << "expected: perf_regress <baseline_json> [--update] [--threads=1]" << std::endl;
+        return 1;
+    }
+
+    try {
+        // single thread by default, timings of the baseline don't depend on core count
+        ml::SetNumThreads(options.count("threads") ? std::atol(options["threads"].c_str()) : 1);
+
+        char dir[] = "/tmp/perf_regress_XXXXXX";
+        if (mkdtemp(dir) == nullptr) {
+            throw std::runtime_error("can't create a temporary directory");
+        }
+        Values measured = RunScenario(dir);
+        rmdir(dir);
+
+        Values baseline = ReadValues(args[0]);
+        if (options.count("update")) {
+            // tolerances are kept, measurements replace the old ones
+            for (auto &value : measured) {
+                baseline[value.first] = value.second;
+            }
+            WriteValues(args[0], baseline);
+            std::cout << "baseline updated " << args[0] << std::endl;
+            return 0;
+        }
+
+        int nb_failures = Compare(baseline, measured);
+        std::cout << (nb_failures == 0 ? "no regressions" : std::to_string(nb_failures) + " regressions");
+        std::cout << std::endl;
+        return nb_failures == 0 ? 0 : 1;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
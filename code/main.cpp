@@ -1,6 +1,11 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -9,108 +14,605 @@
 
 #include <opencv2/opencv.hpp>
 
+#include "class_index.h"
 #include "exception.h"
+#include "export.h"
+#include "feature_cache.h"
+#include "kernels.h"
+#include "logger.h"
+#include "memory.h"
+#include "metrics.h"
+#include "model_watcher.h"
 #include "multiclass_svm.h"
+#include "pca.h"
+#include "pipeline.h"
+#include "predictor.h"
+#include "prefetch_loader.h"
+#include "quadratic.h"
+#include "quantization.h"
+#include "sparse_svm.h"
 #include "util.h"
 
 
+typedef std::map<std::string, std::string> Options;
+
+// set by --cache, every data set is then read through its binary cache
+bool use_data_cache = false;
+
+// splits "--key=value" options from positional arguments
+std::vector<std::string> ParseArgs(int argc, char* argv[], Options &options) {
+    std::vector<std::string> args;
+    for (int i = 0; i < argc; ++i) {
+        std::string arg(argv[i]);
+        if (arg.compare(0, 2, "--") != 0) {
+            args.push_back(arg);
+            continue;
+        }
+
+        auto pos = arg.find('=');
+        if (pos == std::string::npos) {
+            options[arg.substr(2)] = "";
+        } else {
+            options[arg.substr(2, pos - 2)] = arg.substr(pos + 1);
+        }
+    }
+    return args;
+}
+
+std::string GetOption(const Options &options,
+                      const std::string &key,
+                      const std::string &default_value) {
+    auto it = options.find(key);
+    return it == options.end() ? default_value : it->second;
+}
+
+ml::PCAMethod ParsePCAMethod(const std::string &name) {
+    if (name == "covariance") {
+        return ml::PCAMethod::Covariance;
+    }
+    if (name == "randomized") {
+        return ml::PCAMethod::Randomized;
+    }
+    throw ml::Exception("unknown pca method " + name);
+}
+
+// images, labels and paths of a data set once it is read
+size_t EstimateDataBytes(const std::string &data_path) {
+    auto image_paths = ml::ReadImagePaths(data_path);
+    if (image_paths.empty()) {
+        return 0;
+    }
+    size_t nb_images = image_paths.size();
+    size_t nb_dim = ml::ReadImage(image_paths[0]).size();
+    size_t per_image = sizeof(int) + sizeof(std::string) + image_paths[0].size() + 1;
+    return ml::EstimateMatrixBytes(nb_images, nb_dim) + nb_images * per_image;
+}
+
+// pairs index into the rows, no solver copies them
+size_t EstimatePairBytes(const std::vector<int> &y) {
+    std::map<int, size_t> counts;
+    for (int label : y) {
+        ++counts[label];
+    }
+    std::vector<size_t> sizes;
+    for (auto &count : counts) {
+        sizes.push_back(count.second);
+    }
+    std::sort(sizes.rbegin(), sizes.rend());
+    size_t nb_rows = sizes.size() < 2 ? y.size() : sizes[0] + sizes[1];
+    // row indices, labels and a few values of solver state per row
+    size_t per_row = sizeof(size_t) + sizeof(int) + 4 * sizeof(double);
+    return nb_rows * per_row;
+}
+
 void Train(
     const std::string &data_path,
     const std::string &save_path,
     bool preprocessed = false,
-    double lambda = 0.01,
-    double bias_multiplier = 1,
-    double epsilon = 0.02,
-    double retain_variance = 0.95
+    const ml::TrainOptions &train_options = ml::TrainOptions(),
+    double retain_variance = 0.95,
+    ml::PCAMethod pca_method = ml::PCAMethod::Covariance,
+    bool with_squares = false
 ) {
-    auto data = ml::ReadData(data_path);
-    auto x = std::get<0>(data);
-    auto y = std::get<1>(data);
+    // pixel statistics and covariance are accumulated while images are still decoded,
+    // randomized pca works on normalized rows and a cache hit has nothing to overlap with
+    bool streamed = preprocessed && pca_method == ml::PCAMethod::Covariance && !use_data_cache;
+    ml::PixelStatistics statistics;
+    ml::Data data;
+    {
+        ml::MemoryStage stage("read_data", EstimateDataBytes(data_path));
+        data = streamed ? ml::ReadDataWithStatistics(data_path, statistics) :
+                          ml::ReadData(data_path, true, use_data_cache);
+    }
+    // moved out, the tuple doesn't keep a second copy of the images
+    auto x = std::move(std::get<0>(data));
+    auto y = std::move(std::get<1>(data));
+    ml::TrackedBuffer tracked_x("train_x", ml::GetMatrixBytes(x));
+    // rows of a label stay next to each other in the matrices derived from x
+    ml::SortByLabel(x, y);
 
     if (preprocessed && !x.empty()) {
-        std::cout << "normalizing input" << std::endl;
-        auto out = ml::Normalize(x);
-        x = std::get<0>(out);
-        double mean = std::get<1>(out);
-        double std_dev = std::get<2>(out);
-
-        std::cout << "preprocessing input, retain_variance " << retain_variance << std::endl;
-        auto pca = ml::CreatePCA(x, retain_variance);
-        x = ml::ProjectPCA(pca, x);
-        std::cout << "dimensionality after projection " << x.at(0).size() << std::endl;
-        std::cout << "first image after projection: " << std::endl;
-        for (size_t i = 0; i < x.at(0).size(); ++i) {
-            std::cout << x.at(0).at(i) << " ";
-        }
-        std::cout << std::endl;
-
-        x = ml::AddQuadraticInteractions(x);
-        std::cout << "add quadratic interactions, dimensionality after ";
-        std::cout << x.at(0).size() << std::endl;
-
-        std::cout << "saving pca" << std::endl;
+        const size_t nb_rows = x.size();
+        const size_t nb_dim = x[0].size();
+        ml::Log(ml::LogLevel::Info) << "normalizing input";
+        double mean = statistics.mean;
+        double std_dev = statistics.std_dev;
+        {
+            // known statistics scale x in place, otherwise a normalized copy is made
+            ml::MemoryStage stage("normalize", streamed ? 0 : ml::GetMatrixBytes(x));
+            if (streamed) {
+                x = ml::Normalize(std::move(x), mean, std_dev);
+            } else {
+                auto out = ml::Normalize(x);
+                ml::TrackedBuffer tracked_normalized("normalized_x", ml::GetMatrixBytes(std::get<0>(out)));
+                x = std::move(std::get<0>(out));
+                mean = std::get<1>(out);
+                std_dev = std::get<2>(out);
+            }
+        }
+
+        ml::Log(ml::LogLevel::Info) << "preprocessing input, retain_variance " << retain_variance;
+        cv::PCA pca;
+        {
+            // accumulated and dense covariance with its eigenvectors
+            ml::MemoryStage stage("pca_fit", 4 * nb_dim * nb_dim * sizeof(double));
+            pca = streamed ?
+                ml::PCAFromScaledCovariance(statistics.covariance, mean, std_dev, retain_variance) :
+                ml::CreatePCA(x, retain_variance, pca_method);
+        }
+
+        const size_t nb_components = pca.eigenvectors.rows;
+        {
+            // x as cv::Mat, projection as cv::Mat and as matrix
+            ml::MemoryStage stage("pca_project",
+                                  nb_rows * nb_dim * sizeof(double) +
+                                  nb_rows * nb_components * sizeof(double) +
+                                  ml::EstimateMatrixBytes(nb_rows, nb_components));
+            auto projected = ml::ProjectPCA(pca, x);
+            ml::TrackedBuffer tracked_projected("projected_x", ml::GetMatrixBytes(projected));
+            x = std::move(projected);
+        }
+        tracked_x.Update(ml::GetMatrixBytes(x));
+        ml::Log(ml::LogLevel::Info) << "dimensionality after projection " << x.at(0).size();
+
+        {
+            ml::MemoryStage stage("quadratic_expansion",
+                                  ml::EstimateMatrixBytes(nb_rows, ml::GetQuadraticDim(nb_components, with_squares)));
+            auto expanded = ml::AddQuadraticInteractions(x, with_squares);
+            ml::TrackedBuffer tracked_expanded("quadratic_x", ml::GetMatrixBytes(expanded));
+            x = std::move(expanded);
+        }
+        tracked_x.Update(ml::GetMatrixBytes(x));
+        ml::Log(ml::LogLevel::Info) << "add quadratic interactions, dimensionality after "
+                                    << x.at(0).size();
+
+        ml::Log(ml::LogLevel::Info) << "saving pca";
         ml::SavePCA(save_path + ".pca", pca);
         ml::SaveNormalizationParams(save_path + ".norm", mean, std_dev);
     }
 
-    std::cout << "start learning\n" << std::endl;
-    std::cout << "lambda " << lambda << std::endl;
-    std::cout << "bias multiplier " << bias_multiplier << std::endl;
-    std::cout << "epsilon " << epsilon << std::endl;
+    ml::Log(ml::LogLevel::Info) << "start learning";
+    ml::Log(ml::LogLevel::Info) << "lambda " << train_options.lambda;
+    ml::Log(ml::LogLevel::Info) << "bias multiplier " << train_options.bias_multiplier;
+    ml::Log(ml::LogLevel::Info) << "epsilon " << train_options.epsilon;
 
     ml::MulticlassSVM svm;
-    svm.Train(x, y, lambda, bias_multiplier, epsilon);
+    {
+        ml::MemoryStage stage("train", x.empty() ? 0 : EstimatePairBytes(y));
+        svm.Train(x, y, train_options);
+    }
 
-    std::cout << "finish learning\n" << std::endl;
+    ml::Log(ml::LogLevel::Info) << "finish learning";
     ml::SaveModel(svm, save_path + ".svm");
 }
 
+// applies normalization, pca and quadratic interactions saved along with the model
+ml::Matrix Preprocess(const std::string &model_path, ml::Matrix input, size_t model_dim) {
+    ml::Log(ml::LogLevel::Info) << "preprocessing input";
+    auto out = ml::LoadNormalizationParams(model_path + ".norm");
+    double mean = std::get<0>(out);
+    double std_dev = std::get<1>(out);
+    auto pca = ml::LoadPCA(model_path + ".pca");
+    auto x = ml::Normalize(std::move(input), mean, std_dev);
+    x = ml::ProjectPCA(pca, x);
+    ml::Log(ml::LogLevel::Info) << "dimensionality after projection " << x.at(0).size();
+    // squared terms are part of the model if its dimensionality says so
+    bool with_squares = model_dim == ml::GetQuadraticDim(x.at(0).size(), true);
+    x = ml::AddQuadraticInteractions(x, with_squares);
+    ml::Log(ml::LogLevel::Info) << "add quadratic interactions, dimensionality after "
+                                << x.at(0).size();
+    return x;
+}
+
+// normalized and pca projected input, read from the feature cache when it is up to date
+std::unique_ptr<ml::FeatureCache> LoadProjectedFeatures(const std::string &model_path,
+                                                        const std::string &input_path) {
+    uint64_t key = ml::GetFeatureCacheKey(input_path, model_path);
+    std::string cache_path = ml::GetFeatureCachePath(input_path, key);
+    auto cache = ml::FeatureCache::Open(cache_path, key);
+    if (cache) {
+        ml::Log(ml::LogLevel::Info) << "using feature cache " << cache_path;
+        return cache;
+    }
+
+    auto data = ml::ReadData(input_path, false, use_data_cache);
+    auto out = ml::LoadNormalizationParams(model_path + ".norm");
+    auto pca = ml::LoadPCA(model_path + ".pca");
+    auto x = ml::ProjectPCA(pca, ml::Normalize(std::move(std::get<0>(data)), std::get<0>(out), std::get<1>(out)));
+    ml::FeatureCache::Save(cache_path, key, x, std::get<2>(data));
+
+    cache = ml::FeatureCache::Open(cache_path, key);
+    if (!cache) {
+        throw ml::Exception("can't read feature cache " + cache_path);
+    }
+    return cache;
+}
+
+// decode, predict and write run concurrently, images are never held all at once
+void ClassifyPipelined(const std::string &model_path,
+                       const std::string &input_path,
+                       const std::string &output_path,
+                       bool preprocessed = false,
+                       size_t queue_capacity = 256) {
+    auto predictor = ml::LoadPredictor(model_path, preprocessed);
+    auto image_paths = ml::ReadImagePaths(input_path);
+
+    ml::PipelineOptions pipeline_options;
+    pipeline_options.queue_capacity = queue_capacity;
+    std::ofstream output(output_path);
+    auto stats = ml::ClassifyPipelined(*predictor, image_paths, output, pipeline_options);
+
+    ml::Log(ml::LogLevel::Info) << "classified " << stats.nb_images << " images in " << stats.seconds
+                                << " s with " << stats.nb_workers << " workers";
+    ml::Log(ml::LogLevel::Info) << "stage time: decode " << stats.decode_seconds << " s, predict "
+                                << stats.predict_seconds << " s, write " << stats.write_seconds << " s";
+    ml::Log(ml::LogLevel::Info) << "queue occupancy: decoded " << stats.decoded_occupancy * 100
+                                << "%, predicted " << stats.predicted_occupancy * 100 << "%";
+}
+
 void Classify(const std::string &model_path, 
               const std::string &input_path, 
               const std::string &output_path, 
-              bool preprocessed = false) {
+              bool preprocessed = false,
+              const std::string &format = "dense",
+              bool use_feature_cache = false) {
+    ml::SharedPredictor predictor;
+    ml::QuantizedMulticlassSVM quantized_svm;
+    ml::SparseMulticlassSVM sparse_svm;
+    size_t model_dim = 0;
+    if (format == "dense") {
+        // preprocessing is part of the predictor
+        predictor = ml::LoadPredictor(model_path, preprocessed);
+    } else if (format == "int8") {
+        quantized_svm = ml::ReadQuantizedModel(model_path + ".qsvm");
+        model_dim = quantized_svm.GetDim();
+    } else if (format == "sparse") {
+        sparse_svm = ml::ReadSparseModel(model_path + ".ssvm");
+        model_dim = sparse_svm.GetDim();
+    } else {
+        throw ml::Exception("unknown model format " + format);
+    }
+
+    auto predict_features = [&](const ml::Matrix &x) {
+        return format == "int8" ? quantized_svm.Predict(x) : sparse_svm.Predict(x);
+    };
+
+    if (preprocessed && use_feature_cache) {
+        auto cache = LoadProjectedFeatures(model_path, input_path);
+        std::vector<int> predictions;
+        // an empty input caches no columns, there is nothing to validate or predict
+        if (cache->GetRows() > 0 && predictor) {
+            ml::ValidateDimensions(predictor->GetProjectedDim(), cache->GetCols());
+            predictions = predictor->PredictProjected(cache->GetData(), cache->GetRows());
+        } else if (cache->GetRows() > 0) {
+            ml::Matrix x(cache->GetRows());
+            for (size_t i = 0; i < x.size(); ++i) {
+                const double *row = cache->GetData() + i * cache->GetCols();
+                x[i].assign(row, row + cache->GetCols());
+            }
+            bool with_squares = model_dim == ml::GetQuadraticDim(cache->GetCols(), true);
+            predictions = predict_features(ml::AddQuadraticInteractions(x, with_squares));
+        }
+        ml::SavePredictions(cache->GetImagePaths(), predictions, output_path);
+        return;
+    }
+
+    ml::Data data;
+    {
+        ml::MemoryStage stage("read_data", EstimateDataBytes(input_path));
+        data = ml::ReadData(input_path, false, use_data_cache);
+    }
+    auto x = std::move(std::get<0>(data));
+
+    std::vector<int> predictions;
+    {
+        // preprocessing of the compact formats makes a projected and an expanded copy
+        ml::MemoryStage stage("predict", predictor ? 0 : ml::EstimateMatrixBytes(x.size(), model_dim));
+        if (predictor) {
+            predictions = predictor->Predict(x);
+        } else {
+            if (preprocessed && !x.empty()) {
+                x = Preprocess(model_path, std::move(x), model_dim);
+            }
+            predictions = predict_features(x);
+        }
+    }
+    ml::SavePredictions(std::get<2>(data), predictions, output_path);
+}
+
+void Quantize(const std::string &model_path,
+              bool preprocessed = false,
+              const std::string &eval_path = "") {
     auto svm = ml::ReadModel(model_path + ".svm");
-    auto data = ml::ReadData(input_path, false);
-    auto x = std::get<0>(data);
+    auto quantized_svm = ml::QuantizedMulticlassSVM::Quantize(svm);
+    ml::SaveQuantizedModel(quantized_svm, model_path + ".qsvm");
+
+    size_t nb_values = svm.GetModels().size() * svm.GetModels().at(0).size();
+    ml::Log(ml::LogLevel::Info) << "model weights: " << nb_values * sizeof(double) << " bytes as double, "
+                                << nb_values * sizeof(int8_t) << " bytes as int8";
+    ml::Log(ml::LogLevel::Info) << "int8 kernel: " << ml::GetInt8KernelName();
 
+    if (eval_path.empty()) {
+        return;
+    }
+
+    auto data = ml::ReadData(eval_path, true, use_data_cache);
+    auto x = std::move(std::get<0>(data));
+    auto y = std::move(std::get<1>(data));
     if (preprocessed && !x.empty()) {
-        std::cout << "preprocessing input" << std::endl;
+        x = Preprocess(model_path, std::move(x), svm.GetModels().at(0).size());
+    }
+
+    double accuracy = ml::Accuracy(svm.Predict(x), y);
+    double weights_accuracy = ml::Accuracy(quantized_svm.Predict(x, false), y);
+    double int8_accuracy = ml::Accuracy(quantized_svm.Predict(x, true), y);
+    ml::Log(ml::LogLevel::Info) << "fp64 accuracy " << accuracy;
+    ml::Log(ml::LogLevel::Info) << "int8 weights accuracy " << weights_accuracy
+                                << " (delta " << weights_accuracy - accuracy << ")";
+    ml::Log(ml::LogLevel::Info) << "int8 weights and inputs accuracy " << int8_accuracy
+                                << " (delta " << int8_accuracy - accuracy << ")";
+}
+
+void Prune(const std::string &model_path,
+           bool preprocessed = false,
+           double sparsity = 0.9,
+           const std::string &eval_path = "",
+           double max_accuracy_drop = -1) {
+    auto svm = ml::ReadModel(model_path + ".svm");
+
+    ml::Matrix x;
+    std::vector<int> y;
+    if (!eval_path.empty()) {
+        auto data = ml::ReadData(eval_path, true, use_data_cache);
+        x = std::move(std::get<0>(data));
+        y = std::move(std::get<1>(data));
+        if (preprocessed && !x.empty()) {
+            x = Preprocess(model_path, std::move(x), svm.GetModels().at(0).size());
+        }
+    }
+
+    ml::SparseMulticlassSVM sparse_svm;
+    if (max_accuracy_drop >= 0 && !x.empty()) {
+        sparse_svm = ml::SparseMulticlassSVM::PruneToAccuracy(svm, x, y, max_accuracy_drop);
+    } else {
+        sparse_svm = ml::SparseMulticlassSVM::Prune(svm, sparsity);
+    }
+    ml::SaveSparseModel(sparse_svm, model_path + ".ssvm");
+
+    size_t nb_values = svm.GetModels().size() * svm.GetModels().at(0).size();
+    size_t nb_non_zero = sparse_svm.GetNbNonZero();
+    ml::Log(ml::LogLevel::Info) << "kept " << nb_non_zero << " of " << nb_values << " weights";
+    ml::Log(ml::LogLevel::Info) << "model weights: " << nb_values * sizeof(double) << " bytes dense, "
+                                << nb_non_zero * (sizeof(double) + sizeof(uint32_t)) << " bytes sparse";
+
+    if (!x.empty()) {
+        double accuracy = ml::Accuracy(svm.Predict(x), y);
+        double sparse_accuracy = ml::Accuracy(sparse_svm.Predict(x), y);
+        ml::Log(ml::LogLevel::Info) << "dense accuracy " << accuracy;
+        ml::Log(ml::LogLevel::Info) << "sparse accuracy " << sparse_accuracy
+                                    << " (delta " << sparse_accuracy - accuracy << ")";
+    }
+}
+
+void GenerateKernels(const std::string &model_path,
+                     const std::string &output_path,
+                     bool preprocessed = false) {
+    auto svm = ml::ReadModel(model_path + ".svm");
+    std::vector<size_t> dims = {svm.GetModels().at(0).size()};
+
+    if (preprocessed) {
+        auto pca = ml::LoadPCA(model_path + ".pca");
+        dims.push_back(pca.mean.cols);
+        dims.push_back(pca.eigenvectors.rows);
+    }
+
+    ml::Log(ml::LogLevel::Info) << "writing specialized kernels to " << output_path;
+    std::ofstream output(output_path);
+    ml::WriteSpecializedKernels(output, dims, "model " + model_path);
+}
+
+void ExportHeader(const std::string &model_path,
+                  const std::string &output_path,
+                  bool preprocessed = false,
+                  const std::string &name_space = "mnist_model") {
+    auto svm = ml::ReadModel(model_path + ".svm");
+
+    ml::Log(ml::LogLevel::Info) << "exporting model header to " << output_path;
+    std::ofstream output(output_path);
+    if (preprocessed) {
         auto out = ml::LoadNormalizationParams(model_path + ".norm");
-        double mean = std::get<0>(out);
-        double std_dev = std::get<1>(out);
         auto pca = ml::LoadPCA(model_path + ".pca");
-        x = ml::Normalize(x, mean, std_dev);
-        x = ml::ProjectPCA(pca, x);
-        std::cout << "dimensionality after projection " << x.at(0).size() << std::endl;
-        x = ml::AddQuadraticInteractions(x);
-        std::cout << "add quadratic interactions, dimensionality after ";
-        std::cout << x.at(0).size() << std::endl;
+        ml::WriteModelHeader(output, svm, pca, std::get<0>(out), std::get<1>(out), name_space);
+    } else {
+        ml::WriteModelHeader(output, svm, name_space);
     }
+}
 
-    auto predictions = svm.Predict(x);
-    ml::SavePredictions(std::get<2>(data), predictions, output_path);
+// classifies image paths read from stdin, reloading the model when it changes on disk
+void Serve(const std::string &model_path,
+           bool preprocessed = false,
+           long poll_ms = 1000) {
+    ml::ModelWatcher watcher(model_path, preprocessed, std::chrono::milliseconds(poll_ms));
+    watcher.Start();
+
+    ml::Metrics &metrics = ml::GetMetrics();
+    size_t nb_requests = 0;
+    size_t nb_dropped = 0;
+    size_t nb_reloads = 0;
+    std::string image_path;
+    while (std::getline(std::cin, image_path)) {
+        if (image_path.empty()) {
+            continue;
+        }
+        ++nb_requests;
+        metrics.Increment("serve_requests");
+
+        // the request finishes on this model even if a reload swaps it meanwhile
+        ml::SharedPredictor predictor = watcher.Get();
+        try {
+            auto pixels = ml::ReadImage(image_path);
+            ml::ValidateDimensions(predictor->GetInputDim(), pixels.size(), nb_requests - 1);
+            std::cout << image_path << " " << predictor->PredictOne(pixels.data()) << std::endl;
+        } catch (const std::exception &e) {
+            ++nb_dropped;
+            metrics.Increment("serve_dropped_requests");
+            std::cerr << "dropped " << image_path << ": " << e.what() << std::endl;
+        }
+
+        auto stats = watcher.GetStats();
+        if (stats.nb_reloads != nb_reloads) {
+            nb_reloads = stats.nb_reloads;
+            std::cerr << "model reloaded in " << stats.last_reload_ms << " ms" << std::endl;
+        }
+    }
+    watcher.Stop();
+
+    auto stats = watcher.GetStats();
+    std::cerr << "requests " << nb_requests << ", dropped " << nb_dropped << std::endl;
+    std::cerr << "reloads " << stats.nb_reloads << ", failed reloads " << stats.nb_failed_reloads;
+    std::cerr << ", last reload " << stats.last_reload_ms << " ms" << std::endl;
+    if (!stats.last_error.empty()) {
+        std::cerr << "last reload error: " << stats.last_error << std::endl;
+    }
+}
+
+// plain bytes or with a K, M or G suffix
+size_t ParseByteSize(const std::string &value) {
+    std::istringstream iss(value);
+    double size = 0;
+    std::string suffix;
+    if (!(iss >> size) || size < 0) {
+        throw ml::Exception("incorrect size " + value);
+    }
+    iss >> suffix;
+    if (suffix == "K" || suffix == "k") {
+        size *= 1024;
+    } else if (suffix == "M" || suffix == "m") {
+        size *= 1024 * 1024;
+    } else if (suffix == "G" || suffix == "g") {
+        size *= 1024 * 1024 * 1024;
+    } else if (!suffix.empty()) {
+        throw ml::Exception("incorrect size " + value);
+    }
+    return static_cast<size_t>(size);
+}
+
+// --metrics=<path> dumps all phase timings and counters of the run
+void WriteMetrics(const Options &options, double seconds) {
+    std::string path = GetOption(options, "metrics", "");
+    if (path.empty()) {
+        return;
+    }
+
+    std::string format = GetOption(options, "metrics-format", "json");
+    if (format != "json" && format != "prometheus") {
+        throw ml::Exception("unknown metrics format " + format);
+    }
+
+    ml::Metrics &metrics = ml::GetMetrics();
+    metrics.SetGauge("run_seconds", seconds);
+    std::ofstream output(path);
+    if (format == "json") {
+        metrics.WriteJson(output);
+    } else {
+        metrics.WritePrometheus(output);
+    }
+    if (!output) {
+        throw ml::Exception("can't write metrics to " + path);
+    }
+    ml::Log(ml::LogLevel::Info) << "metrics written to " << path;
+}
+
+void PrintUsage() {
+    std::cout << "the following arguments are expected" << std::endl;
+    std::cout << "either: 'train' <data_path> <save_path> ";
+    std::cout << "[preprocessed] [lambda] [bias_multiplier] [epsilon] [retain_variance]";
+    std::cout << " [--pca=covariance|randomized] [--squares]";
+    std::cout << " [--solver=sgd|sdca|pegasos|dcd [--batch-size=256]]";
+    std::cout << " [--loss=hinge|hinge2|l1|l2|logistic] [--max-iterations=<n>] [--bias-learning-rate=0.01]";
+    std::cout << " [--balance-classes] [--subsample=<fraction> [--remine]]" << std::endl;
+    std::cout << "or: 'classify' <model_path>";
+    std::cout << " <input_path> <output_path> [preprocessed] [--format=dense|int8|sparse]";
+    std::cout << " [--feature-cache] [--pipeline [--queue-capacity=256]]" << std::endl;
+    std::cout << "or: 'quantize' <model_path> [preprocessed] [--eval=<data_path>]" << std::endl;
+    std::cout << "or: 'prune' <model_path> [preprocessed] [--sparsity=0.9]";
+    std::cout << " [--eval=<data_path> [--max-accuracy-drop=<drop>]]" << std::endl;
+    std::cout << "or: 'gen-kernels' <model_path> <output_cpp> [preprocessed]" << std::endl;
+    std::cout << "or: 'export-header' <model_path> <output_h> [preprocessed]";
+    std::cout << " [--namespace=mnist_model]" << std::endl;
+    std::cout << "or: 'serve' <model_path> [preprocessed] [--poll-ms=1000]";
+    std::cout << " (image paths on stdin)" << std::endl;
+    std::cout << "data sets are cached next to their description files with --cache" << std::endl;
+    std::cout << "phase timings are written with --metrics=<path> [--metrics-format=json|prometheus]";
+    std::cout << std::endl;
+    std::cout << "memory usage by stage is printed with --memory-report, ";
+    std::cout << "--memory-budget=<bytes>[K|M|G] stops before a stage that would exceed it" << std::endl;
+    std::cout << "progress is logged at --log-level=debug|info|warning|error|off, info by default" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
-    if (argc < 4) {
-        std::cout << "the following arguments are expected" << std::endl;
-        std::cout << "either: 'train' <data_path> <save_path> ";
-        std::cout << "[preprocessed] [lambda] [bias_multiplier] [epsilon]" << std::endl;
-        std::cout << "or: 'classify' <model_path>";
-        std::cout << " <input_path> <output_path> [preprocessed]" << std::endl;
+    Options options;
+    std::vector<std::string> args = ParseArgs(argc, argv, options);
+
+    if (args.size() < 3) {
+        PrintUsage();
         return 1;
     }
 
-    std::string mode(argv[1]);
-    if (mode == "train" && argc >= 4) {
+    auto start = std::chrono::steady_clock::now();
+    std::string mode(args[1]);
+    use_data_cache = options.count("cache") > 0;
+    try {
+        ml::GetMemoryTracker().SetBudget(ParseByteSize(GetOption(options, "memory-budget", "0")));
+        ml::GetLogger().SetLevel(ml::ParseLogLevel(GetOption(options, "log-level", "info")));
+    } catch (const ml::Exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    size_t nb_args = args.size();
+    bool handled = false;
+    if (mode == "train" && nb_args >= 4) {
+        handled = true;
         try {
-            Train(argv[2], 
-                  argv[3],
-                  argc >= 4 + 1 ? std::string(argv[4]) == "preprocessed" : false, 
-                  argc >= 5 + 1 ? atof(argv[5]) : 0.01,
-                  argc >= 6 + 1 ? atof(argv[6]) : 1,
-                  argc >= 7 + 1 ? atof(argv[7]) : 0.02, 
-                  argc >= 8 + 1 ? atof(argv[8]) : 0.95);
+            ml::TrainOptions train_options;
+            train_options.lambda = nb_args >= 5 + 1 ? atof(args[5].c_str()) : 0.01;
+            train_options.bias_multiplier = nb_args >= 6 + 1 ? atof(args[6].c_str()) : 1;
+            train_options.epsilon = nb_args >= 7 + 1 ? atof(args[7].c_str()) : 0.02;
+            train_options.solver = ml::ParseSolverType(GetOption(options, "solver", "sgd"));
+            train_options.batch_size = atol(GetOption(options, "batch-size", "256").c_str());
+            train_options.loss = ml::ParseLossType(GetOption(options, "loss", "hinge"));
+            train_options.max_iterations = atol(GetOption(options, "max-iterations", "0").c_str());
+            train_options.bias_learning_rate = atof(GetOption(options, "bias-learning-rate", "0.01").c_str());
+            train_options.balance_classes = options.count("balance-classes") > 0;
+            train_options.subsample = atof(GetOption(options, "subsample", "1").c_str());
+            train_options.remine_hard_examples = options.count("remine") > 0;
+            Train(args[2], 
+                  args[3],
+                  nb_args >= 4 + 1 ? args[4] == "preprocessed" : false, 
+                  train_options,
+                  nb_args >= 8 + 1 ? atof(args[8].c_str()) : 0.95,
+                  ParsePCAMethod(GetOption(options, "pca", "covariance")),
+                  options.count("squares") > 0);
         } catch (const ml::Exception& e) {
             std::cerr << e.what() << std::endl;
             return 1;
@@ -123,12 +625,23 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    if (mode == "classify" && argc >= 5) {
+    if (mode == "classify" && nb_args >= 5) {
+        handled = true;
         try {
-            Classify(argv[2],
-                     argv[3],
-                     argv[4],
-                     argc >= 5 + 1 ? std::string(argv[5]) == "preprocessed" : false);
+            if (options.count("pipeline") > 0) {
+                ClassifyPipelined(args[2],
+                                  args[3],
+                                  args[4],
+                                  nb_args >= 5 + 1 ? args[5] == "preprocessed" : false,
+                                  atol(GetOption(options, "queue-capacity", "256").c_str()));
+            } else {
+                Classify(args[2],
+                         args[3],
+                         args[4],
+                         nb_args >= 5 + 1 ? args[5] == "preprocessed" : false,
+                         GetOption(options, "format", "dense"),
+                         options.count("feature-cache") > 0);
+            }
         } catch(const ml::Exception& e) {
             std::cerr << e.what() << std::endl;
             return 1;
@@ -141,6 +654,118 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (mode == "quantize" && nb_args >= 3) {
+        handled = true;
+        try {
+            Quantize(args[2],
+                     nb_args >= 3 + 1 ? args[3] == "preprocessed" : false,
+                     GetOption(options, "eval", ""));
+        } catch(const ml::Exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        } catch (...) {
+            std::cerr << "something went wrong during quantization" << std::endl;
+            return 1;
+        }
+    }
+
+    if (mode == "prune" && nb_args >= 3) {
+        handled = true;
+        try {
+            Prune(args[2],
+                  nb_args >= 3 + 1 ? args[3] == "preprocessed" : false,
+                  atof(GetOption(options, "sparsity", "0.9").c_str()),
+                  GetOption(options, "eval", ""),
+                  atof(GetOption(options, "max-accuracy-drop", "-1").c_str()));
+        } catch(const ml::Exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        } catch (...) {
+            std::cerr << "something went wrong during pruning" << std::endl;
+            return 1;
+        }
+    }
+
+    if (mode == "gen-kernels" && nb_args >= 4) {
+        handled = true;
+        try {
+            GenerateKernels(args[2],
+                            args[3],
+                            nb_args >= 4 + 1 ? args[4] == "preprocessed" : false);
+        } catch(const ml::Exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        } catch (...) {
+            std::cerr << "something went wrong during kernel generation" << std::endl;
+            return 1;
+        }
+    }
+
+    if (mode == "export-header" && nb_args >= 4) {
+        handled = true;
+        try {
+            ExportHeader(args[2],
+                         args[3],
+                         nb_args >= 4 + 1 ? args[4] == "preprocessed" : false,
+                         GetOption(options, "namespace", "mnist_model"));
+        } catch(const ml::Exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        } catch (...) {
+            std::cerr << "something went wrong during header export" << std::endl;
+            return 1;
+        }
+    }
+
+    if (mode == "serve" && nb_args >= 3) {
+        handled = true;
+        // stdout carries the predictions
+        ml::GetLogger().SetOutput(std::cerr);
+        try {
+            Serve(args[2],
+                  nb_args >= 3 + 1 ? args[3] == "preprocessed" : false,
+                  atol(GetOption(options, "poll-ms", "1000").c_str()));
+        } catch(const ml::Exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        } catch (...) {
+            std::cerr << "something went wrong while serving" << std::endl;
+            return 1;
+        }
+    }
+
+    if (!handled) {
+        PrintUsage();
+        return 1;
+    }
+
+    if (options.count("memory-report") > 0) {
+        // the report follows the queued progress lines, stdout carries the predictions of serve
+        ml::GetLogger().Flush();
+        ml::GetMemoryTracker().WriteReport(std::cerr);
+    }
+
+    try {
+        WriteMetrics(options, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
     return 0;
 }
-
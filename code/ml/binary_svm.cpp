@@ -1,5 +1,5 @@
-#include <iostream>
 #include <memory>
+#include <numeric>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -7,13 +7,21 @@
 #include "vl/svm.h"
 
 #include "binary_svm.h"
+#include "dual_coordinate_descent.h"
 #include "exception.h"
+#include "kernels.h"
+#include "logger.h"
+#include "metrics.h"
+#include "parallel.h"
+#include "pegasos.h"
 #include "util.h"
 
 
 namespace ml {
     typedef std::vector<std::vector<double>> matrix;
 
+    const size_t PREDICT_MIN_CHUNK_SIZE = 256;
+
     const std::vector<double>& BinarySVM::GetModel() const {
         return model_;
     }
@@ -22,75 +30,230 @@ namespace ml {
         return bias_;
     }
 
+    const TrainStatistics& BinarySVM::GetTrainStatistics() const {
+        return statistics_;
+    }
+
+    SolverType ParseSolverType(const std::string &name) {
+        if (name == "sgd") {
+            return SolverType::Sgd;
+        }
+        if (name == "sdca") {
+            return SolverType::Sdca;
+        }
+        if (name == "pegasos") {
+            return SolverType::Pegasos;
+        }
+        if (name == "dcd") {
+            return SolverType::Dcd;
+        }
+        throw Exception("unknown solver " + name);
+    }
+
+    LossType ParseLossType(const std::string &name) {
+        if (name == "hinge") {
+            return LossType::Hinge;
+        }
+        if (name == "hinge2") {
+            return LossType::Hinge2;
+        }
+        if (name == "l1") {
+            return LossType::L1;
+        }
+        if (name == "l2") {
+            return LossType::L2;
+        }
+        if (name == "logistic") {
+            return LossType::Logistic;
+        }
+        throw Exception("unknown loss " + name);
+    }
+
+    VlSvmLossType GetVlLossType(LossType loss) {
+        switch (loss) {
+            case LossType::Hinge2:
+                return VlSvmLossHinge2;
+            case LossType::L1:
+                return VlSvmLossL1;
+            case LossType::L2:
+                return VlSvmLossL2;
+            case LossType::Logistic:
+                return VlSvmLossLogistic;
+            default:
+                return VlSvmLossHinge;
+        }
+    }
+
     void BinarySVM::Train(const matrix &x, 
                           const std::vector<int> &y,
                           double lambda,
                           double bias_multiplier, 
                           double epsilon) {
-        ValidateTrainData(x, y);
-
-        // reset model
-        model_.clear();
-        bias_ = 0;
+        TrainOptions options;
+        options.lambda = lambda;
+        options.bias_multiplier = bias_multiplier;
+        options.epsilon = epsilon;
+        Train(x, y, options);
+    }
 
+    // rows read in place by vlfeat through its abstract data callbacks
+    struct VlRows {
+        const matrix *x;
+        const size_t *rows;
+        size_t nb_dim;
+        DotProductKernel dot;
+    };
 
-        const vl_size nb_data = x.size();
-        const vl_size nb_dim = x[0].size();
+    double VlInnerProduct(const void *data, vl_uindex element, double *model) {
+        auto rows = static_cast<const VlRows *>(data);
+        return rows->dot((*rows->x)[rows->rows[element]].data(), model, rows->nb_dim);
+    }
 
-        std::vector<double> raw_x(nb_data * nb_dim);
-        std::vector<double> raw_y(nb_data);
+    void VlAccumulate(const void *data, vl_uindex element, double *model, double multiplier) {
+        auto rows = static_cast<const VlRows *>(data);
+        AddScaled(multiplier, (*rows->x)[rows->rows[element]].data(), model, rows->nb_dim);
+    }
 
-        for (vl_size i = 0; i < nb_data; ++i) {
-            for (vl_size j = 0; j < nb_dim; ++j) {
-                raw_x[i * nb_dim + j] = x[i][j];
-            }
-            raw_y[i] = y[i];
-        }
+    TrainStatistics TrainVlfeat(const matrix &x,
+                                const std::vector<size_t> &rows,
+                                const std::vector<int> &y,
+                                const std::vector<double> &weights,
+                                const TrainOptions &options,
+                                std::vector<double> &model,
+                                double &bias) {
+        const vl_size nb_data = rows.size();
+        const vl_size nb_dim = x[rows[0]].size();
 
+        VlRows vl_rows = {&x, rows.data(), nb_dim, GetDotProductKernel(nb_dim)};
+        std::vector<double> raw_y(y.begin(), y.end());
 
         auto deleter = [&](VlSvm* ptr) {
             vl_svm_delete(ptr);
         };
 
         std::unique_ptr<VlSvm, decltype(deleter)> svm(
-            vl_svm_new(VlSvmSolverSgd,
-                       raw_x.data(), nb_dim, nb_data,
-                       raw_y.data(),
-                       lambda),
+            vl_svm_new_with_abstract_data(options.solver == SolverType::Sdca ? VlSvmSolverSdca : VlSvmSolverSgd,
+                                          &vl_rows, nb_dim, nb_data,
+                                          raw_y.data(),
+                                          options.lambda),
             deleter
         );
+        vl_svm_set_data_functions(svm.get(), &VlInnerProduct, &VlAccumulate);
 
-        vl_svm_set_bias_multiplier(svm.get(), bias_multiplier);
-        vl_svm_set_epsilon(svm.get(), epsilon);
+        vl_svm_set_bias_multiplier(svm.get(), options.bias_multiplier);
+        vl_svm_set_epsilon(svm.get(), options.epsilon);
+        vl_svm_set_loss(svm.get(), GetVlLossType(options.loss));
+        vl_svm_set_bias_learning_rate(svm.get(), options.bias_learning_rate);
+        if (!weights.empty()) {
+            vl_svm_set_weights(svm.get(), weights.data());
+        }
+        if (options.max_iterations > 0) {
+            vl_svm_set_max_num_iterations(svm.get(), options.max_iterations);
+        }
         vl_svm_train(svm.get());
 
-        std::cout << "svm is learnt in  " << vl_svm_get_statistics(svm.get())->iteration;
-        std::cout << " iterations" << std::endl;
-
+        const VlSvmStatistics *vl_statistics = vl_svm_get_statistics(svm.get());
+        TrainStatistics statistics;
+        statistics.nb_iterations = vl_statistics->iteration;
+        statistics.objective = vl_statistics->objective;
+        if (options.solver == SolverType::Sdca) {
+            statistics.duality_gap = vl_statistics->dualityGap;
+        }
+        statistics.max_iterations_reached = vl_statistics->status == VlSvmStatusMaxNumIterationsReached;
 
-        bias_ = vl_svm_get_bias(svm.get());
+        bias = vl_svm_get_bias(svm.get());
         const double * raw_model = vl_svm_get_model(svm.get());
-        for (vl_size i = 0; i < nb_dim; ++i) {
-            model_.push_back(raw_model[i]);
+        model.assign(raw_model, raw_model + nb_dim);
+        return statistics;
+    }
+
+    void BinarySVM::Train(const matrix &x,
+                          const std::vector<int> &y,
+                          const TrainOptions &options) {
+        ValidateTrainData(x, y);
+        std::vector<size_t> rows(x.size());
+        std::iota(rows.begin(), rows.end(), 0);
+        Train(x, rows, y, options);
+    }
+
+    void BinarySVM::Train(const matrix &x,
+                          const std::vector<size_t> &rows,
+                          const std::vector<int> &y,
+                          const TrainOptions &options,
+                          const std::vector<double> &weights) {
+        if (options.solver == SolverType::Dcd && options.loss != LossType::Hinge) {
+            throw Exception("dcd solver supports only the hinge loss");
+        }
+        if (rows.empty()) {
+            throw Exception("rows are empty");
+        }
+        if (rows.size() != y.size()) {
+            throw Exception("rows y have different size");
+        }
+        ValidateBinaryLabels(y);
+        if (!weights.empty() && weights.size() != rows.size()) {
+            throw Exception("rows weights have different size");
+        }
+        for (auto weight : weights) {
+            if (!(weight >= 0)) {
+                throw Exception("weights have to be non-negative");
+            }
+        }
+        for (size_t k = 0; k < rows.size(); ++k) {
+            if (rows[k] >= x.size()) {
+                throw Exception("row " + std::to_string(rows[k]) + " is out of range");
+            }
+            ValidateDimensions(x[rows[0]].size(), x[rows[k]].size(), rows[k]);
+        }
+        ScopedTimer timer("binary_svm_train");
+        timer.SetNumItems(rows.size());
+
+        // reset model
+        model_.clear();
+        bias_ = 0;
+
+        if (options.solver == SolverType::Pegasos) {
+            statistics_ = TrainPegasos(x, rows, y, weights, options, model_, bias_);
+        } else if (options.solver == SolverType::Dcd) {
+            statistics_ = TrainDualCoordinateDescent(x, rows, y, weights, options, model_, bias_);
+        } else {
+            statistics_ = TrainVlfeat(x, rows, y, weights, options, model_, bias_);
+        }
+        statistics_.seconds = timer.GetSeconds();
+
+        Log(LogLevel::Info) << "svm is learnt in  " << statistics_.nb_iterations << " iterations";
+
+        Metrics &metrics = GetMetrics();
+        metrics.Observe("binary_svm_iterations", statistics_.nb_iterations);
+        metrics.Observe("binary_svm_objective", statistics_.objective);
+        if (options.solver == SolverType::Sdca || options.solver == SolverType::Dcd) {
+            metrics.Observe("binary_svm_duality_gap", statistics_.duality_gap);
+        }
+        if (statistics_.max_iterations_reached) {
+            metrics.Increment("binary_svm_max_iterations_reached");
         }
     }
 
-    std::vector<int> BinarySVM::Predict(const matrix &x) {
+    std::vector<int> BinarySVM::Predict(const matrix &x) const {
         if (x.empty()) {
             return {};
         }
 
         size_t nb_dim = x[0].size();
         ValidateDimensions(nb_dim, model_.size());
+        // dimensionality is fixed for the whole batch
+        DotProductKernel dot = GetDotProductKernel(nb_dim);
 
-        std::vector<int> predictions;
-        for (size_t i = 0; i < x.size(); ++i) {
-            auto &input = x[i];
-            ValidateDimensions(nb_dim, input.size());
-            double dot_product = DotProduct(input, model_);
-            int prediction = (dot_product + bias_ > 0) ? 1 : -1;
-            predictions.push_back(prediction);
-        }
+        // every chunk writes its own slice of preallocated predictions
+        std::vector<int> predictions(x.size());
+        ParallelFor(x.size(), PREDICT_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t) {
+            for (size_t i = begin; i < end; ++i) {
+                auto &input = x[i];
+                ValidateDimensions(nb_dim, input.size(), i);
+                double dot_product = dot(input.data(), model_.data(), nb_dim);
+                predictions[i] = (dot_product + bias_ > 0) ? 1 : -1;
+            }
+        });
 
         return predictions;
     }
@@ -1,10 +1,75 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 #include <vector>
 
 namespace ml {
 
+enum class SolverType {
+    // vlfeat stochastic gradient descent, one sample per step
+    Sgd,
+    // vlfeat stochastic dual coordinate ascent, stops on the duality gap
+    Sdca,
+    // mini-batch Pegasos of pegasos.h
+    Pegasos,
+    // parallel dual coordinate descent with shrinking of dual_coordinate_descent.h
+    Dcd
+};
+
+// sgd, sdca, pegasos or dcd
+SolverType ParseSolverType(const std::string &name);
+
+// http://www.vlfeat.org/api/svm-advanced.html
+enum class LossType {
+    Hinge,
+    // squared hinge
+    Hinge2,
+    L1,
+    L2,
+    Logistic
+};
+
+// hinge, hinge2, l1, l2 or logistic
+LossType ParseLossType(const std::string &name);
+
+struct TrainOptions {
+    double lambda = 0.01;
+    // http://www.vlfeat.org/api/svm-fundamentals.html
+    double bias_multiplier = 1;
+    // score variation of an epoch for SGD and Pegasos, duality gap for SDCA
+    double epsilon = 0.02;
+    SolverType solver = SolverType::Sgd;
+    LossType loss = LossType::Hinge;
+    // samples visited before training stops, 0 is max(nb_data, 10 / lambda)
+    size_t max_iterations = 0;
+    // relative to the learning rate of the model, SGD and Pegasos only
+    double bias_learning_rate = 0.01;
+
+    // pair training of MulticlassSVM:
+    // rows of a pair are weighted by nb_rows / (2 * nb_rows_of_their_label)
+    bool balance_classes = false;
+    // fraction of every label's rows a pair is trained on
+    double subsample = 1;
+    // a subsampled pair is trained again with the left out rows
+    // its first model gets wrong or puts inside the margin
+    bool remine_hard_examples = false;
+    // samples scored against the same model by one Pegasos step
+    size_t batch_size = 256;
+};
+
+// solver statistics of the last Train call
+struct TrainStatistics {
+    size_t nb_iterations = 0;
+    double objective = 0;
+    double seconds = 0;
+    // SDCA and dual coordinate descent only
+    double duality_gap = 0;
+    // dual coordinate descent only
+    std::vector<double> epoch_seconds;
+    bool max_iterations_reached = false;
+};
+
 class BinarySVM {
 public: 
     BinarySVM() {}
@@ -15,6 +80,8 @@ public:
 
     double GetBias() const;
 
+    const TrainStatistics& GetTrainStatistics() const;
+
     void Train(const std::vector<std::vector<double>> &x, 
                const std::vector<int> &y,
                double lambda = 0.01,
@@ -22,11 +89,24 @@ public:
                double bias_multiplier = 1,
                double epsilon = 0.02); 
 
-    std::vector<int> Predict(const std::vector<std::vector<double>> &x);
+    void Train(const std::vector<std::vector<double>> &x,
+               const std::vector<int> &y,
+               const TrainOptions &options);
+
+    // trains on x[rows[k]] labelled y[k], no solver copies the rows.
+    // The loss of a row is scaled by its non-negative weights[k], empty weights are all 1
+    void Train(const std::vector<std::vector<double>> &x,
+               const std::vector<size_t> &rows,
+               const std::vector<int> &y,
+               const TrainOptions &options,
+               const std::vector<double> &weights = std::vector<double>());
+
+    std::vector<int> Predict(const std::vector<std::vector<double>> &x) const;
 
 private:
     std::vector<double> model_;
     double bias_;
+    TrainStatistics statistics_;
 };
 
 } // namespace ml
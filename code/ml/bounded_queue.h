@@ -0,0 +1,109 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "dense_matrix.h"
+
+
+namespace ml {
+
+/**
+ * Bounded lock-free multi producer multi consumer queue
+ * (D. Vyukov's ring of sequenced cells). Capacity is rounded
+ * up to a power of two, push and pop never block.
+ */
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) :enqueue_pos_(0), dequeue_pos_(0) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue& operator=(const BoundedQueue &) = delete;
+
+    // value is moved from only if there was room
+    bool TryPush(T &value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool TryPop(T &value) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t GetCapacity() const {
+        return mask_ + 1;
+    }
+
+    // approximate while other threads push or pop
+    size_t GetSize() const {
+        size_t dequeue_pos = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t enqueue_pos = enqueue_pos_.load(std::memory_order_relaxed);
+        return enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    // producers and consumers don't share cache lines
+    char pad0_[CACHE_LINE_SIZE];
+    std::atomic<size_t> enqueue_pos_;
+    char pad1_[CACHE_LINE_SIZE];
+    std::atomic<size_t> dequeue_pos_;
+    char pad2_[CACHE_LINE_SIZE];
+};
+
+} // namespace ml
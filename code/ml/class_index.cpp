@@ -0,0 +1,88 @@
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "class_index.h"
+#include "exception.h"
+
+
+namespace ml {
+    ClassIndex::ClassIndex(const std::vector<int> &y)
+        :labels_(y), rows_(y.size()) {
+        std::sort(labels_.begin(), labels_.end());
+        labels_.erase(std::unique(labels_.begin(), labels_.end()), labels_.end());
+
+        // counting sort, label_ids keeps the binary searches out of the second pass
+        std::vector<size_t> label_ids(y.size());
+        offsets_.assign(labels_.size() + 1, 0);
+        for (size_t k = 0; k < y.size(); ++k) {
+            label_ids[k] = std::lower_bound(labels_.begin(), labels_.end(), y[k]) - labels_.begin();
+            ++offsets_[label_ids[k] + 1];
+        }
+        for (size_t i = 0; i < labels_.size(); ++i) {
+            offsets_[i + 1] += offsets_[i];
+        }
+
+        std::vector<size_t> next(offsets_.begin(), offsets_.end() - 1);
+        for (size_t k = 0; k < y.size(); ++k) {
+            rows_[next[label_ids[k]]++] = k;
+        }
+    }
+
+    const std::vector<int>& ClassIndex::GetLabels() const {
+        return labels_;
+    }
+
+    const std::vector<size_t>& ClassIndex::GetRows() const {
+        return rows_;
+    }
+
+    size_t ClassIndex::GetBegin(size_t label_idx) const {
+        return offsets_.at(label_idx);
+    }
+
+    size_t ClassIndex::GetEnd(size_t label_idx) const {
+        return offsets_.at(label_idx + 1);
+    }
+
+    size_t ClassIndex::GetSize(size_t label_idx) const {
+        return GetEnd(label_idx) - GetBegin(label_idx);
+    }
+
+    std::vector<size_t> ClassIndex::GetPairRows(size_t first, size_t second) const {
+        std::vector<size_t> rows;
+        rows.reserve(GetSize(first) + GetSize(second));
+        rows.insert(rows.end(), rows_.begin() + GetBegin(first), rows_.begin() + GetEnd(first));
+        rows.insert(rows.end(), rows_.begin() + GetBegin(second), rows_.begin() + GetEnd(second));
+        return rows;
+    }
+
+    bool ClassIndex::IsSorted() const {
+        for (size_t k = 0; k < rows_.size(); ++k) {
+            if (rows_[k] != k) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void SortByLabel(std::vector<std::vector<double>> &x, std::vector<int> &y) {
+        if (x.size() != y.size()) {
+            throw Exception("x y have different size");
+        }
+        ClassIndex index(y);
+        if (index.IsSorted()) {
+            return;
+        }
+
+        std::vector<std::vector<double>> sorted_x(x.size());
+        std::vector<int> sorted_y(y.size());
+        auto &rows = index.GetRows();
+        for (size_t k = 0; k < rows.size(); ++k) {
+            sorted_x[k] = std::move(x[rows[k]]);
+            sorted_y[k] = y[rows[k]];
+        }
+        x = std::move(sorted_x);
+        y = std::move(sorted_y);
+    }
+} // namespace ml
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+
+namespace ml {
+
+/**
+ * Rows of a data set bucketed by label, built once for all pair trainings.
+ * Rows of the i-th label (labels in increasing order) are
+ * GetRows()[GetBegin(i)] .. GetRows()[GetEnd(i) - 1] in their original order,
+ * so the rows of a pair are two contiguous ranges instead of a scan over y.
+ */
+class ClassIndex {
+public:
+    explicit ClassIndex(const std::vector<int> &y);
+
+    const std::vector<int>& GetLabels() const;
+    const std::vector<size_t>& GetRows() const;
+
+    size_t GetBegin(size_t label_idx) const;
+    size_t GetEnd(size_t label_idx) const;
+    size_t GetSize(size_t label_idx) const;
+
+    // rows of the first label followed by the rows of the second one
+    std::vector<size_t> GetPairRows(size_t first, size_t second) const;
+
+    // y is sorted by label, every label is a contiguous range of x itself
+    bool IsSorted() const;
+
+private:
+    std::vector<int> labels_;
+    std::vector<size_t> offsets_;
+    std::vector<size_t> rows_;
+};
+
+/**
+ * Stable reordering of x and y by label. Rows are moved, not copied,
+ * and the matrices derived from x afterwards allocate the rows of a label
+ * next to each other.
+ */
+void SortByLabel(std::vector<std::vector<double>> &x, std::vector<int> &y);
+
+} // namespace ml
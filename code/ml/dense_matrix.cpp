@@ -0,0 +1,37 @@
+#include <algorithm>
+#include <vector>
+
+#include "dense_matrix.h"
+#include "util.h"
+
+
+namespace ml {
+    const size_t DOUBLES_PER_LINE = CACHE_LINE_SIZE / sizeof(double);
+
+    DenseMatrix::DenseMatrix(size_t nb_rows, size_t nb_cols)
+        :nb_rows_(nb_rows),
+         nb_cols_(nb_cols),
+         stride_((nb_cols + DOUBLES_PER_LINE - 1) / DOUBLES_PER_LINE * DOUBLES_PER_LINE),
+         data_(nb_rows * stride_, 0) {}
+
+    DenseMatrix DenseMatrix::FromMatrix(const Matrix &x) {
+        if (x.empty()) {
+            return DenseMatrix();
+        }
+
+        DenseMatrix result(x.size(), x[0].size());
+        for (size_t i = 0; i < x.size(); ++i) {
+            ValidateDimensions(result.nb_cols_, x[i].size(), i);
+            std::copy(x[i].begin(), x[i].end(), result.Row(i));
+        }
+        return result;
+    }
+
+    Matrix DenseMatrix::ToMatrix() const {
+        Matrix x(nb_rows_);
+        for (size_t i = 0; i < nb_rows_; ++i) {
+            x[i].assign(Row(i), Row(i) + nb_cols_);
+        }
+        return x;
+    }
+} // namespace ml
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+
+namespace ml {
+
+const size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * Allocator returning memory aligned to Alignment bytes,
+ * so SIMD loads over the buffer never straddle cache lines
+ */
+template <class T, size_t Alignment = CACHE_LINE_SIZE>
+class AlignedAllocator {
+public:
+    typedef T value_type;
+
+    template <class U>
+    struct rebind {
+        typedef AlignedAllocator<U, Alignment> other;
+    };
+
+    AlignedAllocator() {}
+
+    template <class U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+    T* allocate(size_t n) {
+        void *ptr = nullptr;
+        if (posix_memalign(&ptr, Alignment, n * sizeof(T)) != 0) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T *ptr, size_t) {
+        free(ptr);
+    }
+
+    template <class U>
+    bool operator==(const AlignedAllocator<U, Alignment> &) const {
+        return true;
+    }
+
+    template <class U>
+    bool operator!=(const AlignedAllocator<U, Alignment> &) const {
+        return false;
+    }
+};
+
+typedef std::vector<double, AlignedAllocator<double>> AlignedVector;
+
+/**
+ * Row-major matrix stored in a single aligned buffer.
+ * Every row starts at a cache line boundary, padding is zero filled.
+ */
+class DenseMatrix {
+public:
+    DenseMatrix() :nb_rows_(0), nb_cols_(0), stride_(0) {}
+    DenseMatrix(size_t nb_rows, size_t nb_cols);
+
+    static DenseMatrix FromMatrix(const std::vector<std::vector<double>> &x);
+
+    std::vector<std::vector<double>> ToMatrix() const;
+
+    size_t GetRows() const { return nb_rows_; }
+    size_t GetCols() const { return nb_cols_; }
+    size_t GetStride() const { return stride_; }
+    bool Empty() const { return nb_rows_ == 0; }
+
+    double* Row(size_t i) { return data_.data() + i * stride_; }
+    const double* Row(size_t i) const { return data_.data() + i * stride_; }
+
+private:
+    size_t nb_rows_;
+    size_t nb_cols_;
+    size_t stride_;
+    AlignedVector data_;
+};
+
+} // namespace ml
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "dual_coordinate_descent.h"
+#include "kernels.h"
+#include "logger.h"
+#include "metrics.h"
+#include "parallel.h"
+
+
+namespace ml {
+    typedef std::vector<std::vector<double>> matrix;
+
+    // a block gets a block of at least this size, small problems run sequentially
+    const size_t BLOCK_MIN_SIZE = 4096;
+    // samples every block updates between two merges into the shared model
+    const size_t ROUND_SIZE = 512;
+    const size_t NORM_MIN_CHUNK_SIZE = 256;
+    const size_t MERGE_MIN_CHUNK_SIZE = 1024;
+    const size_t DEFAULT_MAX_EPOCHS = 200;
+    // liblinear tolerance on the projected gradient, below it shrunk samples come back
+    const double SHRINKING_TOLERANCE = 0.1;
+    // the duality gap costs a pass over all samples
+    const size_t GAP_FREQUENCY = 10;
+    const unsigned DCD_SEED = 0;
+
+    TrainStatistics TrainDualCoordinateDescent(const matrix &x,
+                                               const std::vector<size_t> &rows,
+                                               const std::vector<int> &y,
+                                               const std::vector<double> &weights,
+                                               const TrainOptions &options,
+                                               std::vector<double> &model,
+                                               double &bias) {
+        const size_t nb_data = rows.size();
+        const size_t nb_dim = x[rows[0]].size();
+        const double lambda = options.lambda;
+        // liblinear form: 1/2 |w|^2 + c * sum of losses
+        const double c = 1.0 / (lambda * nb_data);
+        const double bias_multiplier = options.bias_multiplier;
+        const size_t max_iterations = options.max_iterations > 0 ? options.max_iterations :
+                                      DEFAULT_MAX_EPOCHS * nb_data;
+        const double inf = std::numeric_limits<double>::infinity();
+        DotProductKernel dot = GetDotProductKernel(nb_dim);
+
+        // diagonal of the dual hessian and upper bounds of alpha
+        std::vector<double> norms(nb_data);
+        std::vector<double> bounds(nb_data);
+        ParallelFor(nb_data, NORM_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t) {
+            for (size_t k = begin; k < end; ++k) {
+                const double *sample = x[rows[k]].data();
+                norms[k] = dot(sample, sample, nb_dim) + bias_multiplier * bias_multiplier;
+                bounds[k] = weights.empty() ? c : c * weights[k];
+            }
+        });
+
+        // w = sum of alpha[k] * y[k] * x[rows[k]], w_bias is the weight of the bias feature
+        std::vector<double> alpha(nb_data, 0);
+        std::vector<double> w(nb_dim, 0);
+        double w_bias = 0;
+
+        const size_t max_blocks = GetNumChunks(nb_data, BLOCK_MIN_SIZE);
+        // model as seen by a block and the updates it made during the round
+        std::vector<std::vector<double>> local_w(max_blocks, std::vector<double>(nb_dim));
+        std::vector<double> local_bias(max_blocks);
+        std::vector<std::vector<double>> deltas(max_blocks, std::vector<double>(nb_dim, 0));
+        std::vector<double> bias_deltas(max_blocks, 0);
+        std::vector<double> block_pg_max(max_blocks);
+        std::vector<double> block_pg_min(max_blocks);
+
+        std::vector<size_t> active(nb_data);
+        std::iota(active.begin(), active.end(), 0);
+        std::vector<char> shrunk(nb_data, 0);
+        std::mt19937 random(DCD_SEED);
+        double pg_max_old = inf;
+        double pg_min_old = -inf;
+
+        auto get_gap = [&](double &objective) {
+            std::vector<double> losses(GetNumChunks(nb_data, NORM_MIN_CHUNK_SIZE), 0);
+            ParallelFor(nb_data, NORM_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t chunk) {
+                for (size_t k = begin; k < end; ++k) {
+                    double score = dot(x[rows[k]].data(), w.data(), nb_dim) + bias_multiplier * w_bias;
+                    losses[chunk] += bounds[k] * std::max(0.0, 1 - y[k] * score);
+                }
+            });
+            double loss = std::accumulate(losses.begin(), losses.end(), 0.0);
+            double norm = dot(w.data(), w.data(), nb_dim) + w_bias * w_bias;
+            double sum_alpha = std::accumulate(alpha.begin(), alpha.end(), 0.0);
+            // primal and dual of the liblinear form scaled back by lambda
+            objective = lambda * (0.5 * norm + loss);
+            return lambda * (norm + loss - sum_alpha);
+        };
+
+        TrainStatistics statistics;
+        size_t t = 0;
+        bool converged = false;
+        bool has_gap = false;
+        for (size_t epoch = 0; !converged && t < max_iterations; ++epoch) {
+            auto epoch_start = std::chrono::steady_clock::now();
+            std::shuffle(active.begin(), active.end(), random);
+
+            const size_t nb_active = active.size();
+            const size_t nb_blocks = GetNumChunks(nb_active, BLOCK_MIN_SIZE);
+            // blocks see each other's updates only after the round, sigma keeps their sum safe
+            const double sigma = nb_blocks;
+            std::fill(block_pg_max.begin(), block_pg_max.end(), -inf);
+            std::fill(block_pg_min.begin(), block_pg_min.end(), inf);
+
+            const size_t longest_block = (nb_active + nb_blocks - 1) / nb_blocks;
+            for (size_t offset = 0; offset < longest_block; offset += ROUND_SIZE) {
+                ParallelFor(nb_active, BLOCK_MIN_SIZE, [&](size_t begin, size_t end, size_t block) {
+                    // a single block updates the shared model right away
+                    double *block_w = w.data();
+                    double *block_bias = &w_bias;
+                    if (nb_blocks > 1) {
+                        std::copy(w.begin(), w.end(), local_w[block].begin());
+                        local_bias[block] = w_bias;
+                        block_w = local_w[block].data();
+                        block_bias = &local_bias[block];
+                    }
+
+                    const size_t round_end = std::min(end, begin + offset + ROUND_SIZE);
+                    for (size_t p = begin + offset; p < round_end; ++p) {
+                        const size_t k = active[p];
+                        const double *sample = x[rows[k]].data();
+                        const double gradient =
+                            y[k] * (dot(sample, block_w, nb_dim) + bias_multiplier * *block_bias) - 1;
+
+                        double projected = gradient;
+                        if (alpha[k] == 0) {
+                            if (gradient > pg_max_old) {
+                                shrunk[k] = 1;
+                                continue;
+                            }
+                            projected = std::min(gradient, 0.0);
+                        } else if (alpha[k] == bounds[k]) {
+                            if (gradient < pg_min_old) {
+                                shrunk[k] = 1;
+                                continue;
+                            }
+                            projected = std::max(gradient, 0.0);
+                        }
+                        block_pg_max[block] = std::max(block_pg_max[block], projected);
+                        block_pg_min[block] = std::min(block_pg_min[block], projected);
+                        if (projected == 0) {
+                            continue;
+                        }
+
+                        const double updated =
+                            std::min(std::max(alpha[k] - gradient / (sigma * norms[k]), 0.0), bounds[k]);
+                        const double step = (updated - alpha[k]) * y[k];
+                        alpha[k] = updated;
+                        AddScaled(sigma * step, sample, block_w, nb_dim);
+                        *block_bias += sigma * step * bias_multiplier;
+                        if (nb_blocks > 1) {
+                            AddScaled(step, sample, deltas[block].data(), nb_dim);
+                            bias_deltas[block] += step * bias_multiplier;
+                        }
+                    }
+                });
+
+                if (nb_blocks > 1) {
+                    ParallelFor(nb_dim, MERGE_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t) {
+                        for (size_t block = 0; block < nb_blocks; ++block) {
+                            for (size_t j = begin; j < end; ++j) {
+                                w[j] += deltas[block][j];
+                                deltas[block][j] = 0;
+                            }
+                        }
+                    });
+                    for (size_t block = 0; block < nb_blocks; ++block) {
+                        w_bias += bias_deltas[block];
+                        bias_deltas[block] = 0;
+                    }
+                }
+            }
+            t += nb_active;
+
+            active.erase(std::remove_if(active.begin(), active.end(),
+                                        [&](size_t k) { return shrunk[k] != 0; }),
+                         active.end());
+            double pg_max = *std::max_element(block_pg_max.begin(), block_pg_max.begin() + nb_blocks);
+            double pg_min = *std::min_element(block_pg_min.begin(), block_pg_min.begin() + nb_blocks);
+
+            bool check_gap = (epoch + 1) % GAP_FREQUENCY == 0;
+            if (pg_max - pg_min <= SHRINKING_TOLERANCE) {
+                // optimal on the active set, the gap tells whether shrunk samples are
+                check_gap = true;
+                active.resize(nb_data);
+                std::iota(active.begin(), active.end(), 0);
+                std::fill(shrunk.begin(), shrunk.end(), 0);
+                pg_max_old = inf;
+                pg_min_old = -inf;
+            } else {
+                pg_max_old = pg_max > 0 ? pg_max : inf;
+                pg_min_old = pg_min < 0 ? pg_min : -inf;
+            }
+
+            has_gap = check_gap;
+            if (check_gap) {
+                statistics.duality_gap = get_gap(statistics.objective);
+                converged = statistics.duality_gap < options.epsilon;
+            }
+
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch_start).count();
+            statistics.epoch_seconds.push_back(seconds);
+            GetMetrics().Observe("dcd_epoch_seconds", seconds);
+            Log line(LogLevel::Debug);
+            line << "dcd epoch " << epoch << " active " << nb_active << " seconds " << seconds;
+            if (check_gap) {
+                line << " duality gap " << statistics.duality_gap;
+            }
+        }
+
+        if (!has_gap) {
+            statistics.duality_gap = get_gap(statistics.objective);
+        }
+        model = std::move(w);
+        bias = bias_multiplier * w_bias;
+        statistics.nb_iterations = t;
+        statistics.max_iterations_reached = !converged;
+        return statistics;
+    }
+} // namespace ml
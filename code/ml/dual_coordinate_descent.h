@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "binary_svm.h"
+
+
+namespace ml {
+
+/**
+ * Dual coordinate descent for the hinge loss as in liblinear
+ * (Hsieh et al., A Dual Coordinate Descent Method for Large-scale Linear SVM).
+ * Every epoch the active samples are shuffled and split into one block per
+ * thread. The blocks are optimized concurrently against the shared model and
+ * their updates are added after every round (CoCoA+ with sigma = nb_blocks),
+ * so with a single block it is the sequential solver.
+ * Samples stuck at a bound are shrunk out of the active set.
+ * Training stops once the duality gap is below epsilon or after max_iterations
+ * sample updates, 0 allows 200 epochs.
+ * Trains on x[rows[k]] labelled y[k] in {-1, 1} without copying the rows,
+ * a row's weights[k] scales its upper bound as liblinear instance weights do,
+ * the bias is the weight of a constant feature equal to bias_multiplier.
+ */
+TrainStatistics TrainDualCoordinateDescent(const std::vector<std::vector<double>> &x,
+                                           const std::vector<size_t> &rows,
+                                           const std::vector<int> &y,
+                                           const std::vector<double> &weights,
+                                           const TrainOptions &options,
+                                           std::vector<double> &model,
+                                           double &bias);
+
+} // namespace ml
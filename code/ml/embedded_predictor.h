@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "kernels.h"
+#include "voting.h"
+
+
+namespace ml {
+
+namespace detail {
+
+template <class Model, bool Preprocessed>
+struct EmbeddedFeatures;
+
+// model was trained on raw pixels
+template <class Model>
+struct EmbeddedFeatures<Model, false> {
+    static void Compute(const uint8_t *pixels, double *features) {
+        for (size_t j = 0; j < Model::kInputDim; ++j) {
+            features[j] = pixels[j];
+        }
+    }
+};
+
+// normalization, PCA projection and quadratic interactions,
+// in the same order as ExpandQuadratic writes them
+template <class Model>
+struct EmbeddedFeatures<Model, true> {
+    static void Compute(const uint8_t *pixels, double *features) {
+        alignas(64) double centered[Model::kInputDim];
+        for (size_t j = 0; j < Model::kInputDim; ++j) {
+            centered[j] = (pixels[j] - Model::kMean) / Model::kStdDev - Model::kPCAMean[j];
+        }
+
+        const size_t d = Model::kProjectedDim;
+        for (size_t k = 0; k < d; ++k) {
+            features[k] = FixedDotProduct<Model::kInputDim>(Model::kPCAEigenvectors[k], centered);
+        }
+
+        double *out = features + d;
+        const size_t first = Model::kWithSquares ? 0 : 1;
+        for (size_t j = 0; j < d; ++j) {
+            for (size_t k = j + first; k < d; ++k) {
+                *out++ = features[j] * features[k];
+            }
+        }
+    }
+};
+
+} // namespace detail
+
+/**
+ * Header-only one vs one predictor over a model exported with
+ * 'main export-header'. All dimensions are compile time constants
+ * and nothing is loaded or allocated at runtime.
+ */
+template <class Model>
+class EmbeddedPredictor {
+public:
+    static int Predict(const uint8_t *pixels) {
+        alignas(64) double features[Model::kModelDim];
+        detail::EmbeddedFeatures<Model, Model::kPreprocessed>::Compute(pixels, features);
+        return PredictFeatures(features);
+    }
+
+    // features are already normalized, projected and expanded
+    static int PredictFeatures(const double *features) {
+        int votes[Model::kNbLabels] = {};
+        double margins[Model::kNbLabels] = {};
+
+        size_t idx = 0;
+        for (size_t i = 0; i < Model::kNbLabels; ++i) {
+            for (size_t j = i + 1; j < Model::kNbLabels; ++j) {
+                double score = FixedDotProduct<Model::kModelDim>(Model::kWeights[idx], features);
+                AddVote(votes, margins, i, j, score + Model::kBiases[idx]);
+                ++idx;
+            }
+        }
+        return Model::kLabels[SelectWinner(votes, margins, Model::kNbLabels)];
+    }
+};
+
+} // namespace ml
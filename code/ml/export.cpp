@@ -0,0 +1,144 @@
+#include <iomanip>
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "exception.h"
+#include "export.h"
+#include "multiclass_svm.h"
+#include "quadratic.h"
+
+
+namespace ml {
+    const size_t VALUES_PER_LINE = 8;
+
+    template <class T>
+    void WriteValues(std::ostream &output, const T *values, size_t nb_values, const std::string &indent) {
+        output << "{";
+        for (size_t i = 0; i < nb_values; ++i) {
+            if (i % VALUES_PER_LINE == 0) {
+                output << "\n" << indent;
+            }
+            output << values[i] << (i + 1 < nb_values ? ", " : "");
+        }
+        output << "\n" << indent.substr(4) << "}";
+    }
+
+    void WriteArray(std::ostream &output,
+                    const std::string &declaration,
+                    const std::vector<std::vector<double>> &rows) {
+        output << "    alignas(64) static constexpr double " << declaration << " = {";
+        for (size_t i = 0; i < rows.size(); ++i) {
+            output << "\n        ";
+            WriteValues(output, rows[i].data(), rows[i].size(), "            ");
+            output << (i + 1 < rows.size() ? "," : "");
+        }
+        output << "\n    };\n";
+    }
+
+    std::vector<std::vector<double>> MatToRows(const cv::Mat &mat) {
+        std::vector<std::vector<double>> rows(mat.rows, std::vector<double>(mat.cols));
+        for (int i = 0; i < mat.rows; ++i) {
+            for (int j = 0; j < mat.cols; ++j) {
+                rows[i][j] = mat.at<double>(i, j);
+            }
+        }
+        return rows;
+    }
+
+    void WriteModelHeader(std::ostream &output,
+                          const MulticlassSVM &svm,
+                          const cv::PCA *pca,
+                          double mean,
+                          double std_dev,
+                          const std::string &name_space) {
+        const auto &models = svm.GetModels();
+        const auto &biases = svm.GetBiases();
+        const auto &labels = svm.GetLabels();
+        if (models.empty()) {
+            throw Exception("there are no models");
+        }
+        if (models.size() != biases.size() ||
+            models.size() != labels.size() * (labels.size() - 1) / 2) {
+            throw Exception("model has inconsistent number of models, biases and labels");
+        }
+
+        size_t model_dim = models[0].size();
+        size_t input_dim = pca ? pca->mean.cols : model_dim;
+        size_t projected_dim = pca ? pca->eigenvectors.rows : 0;
+        bool with_squares = pca && model_dim == GetQuadraticDim(projected_dim, true);
+        if (pca && model_dim != GetQuadraticDim(projected_dim, with_squares)) {
+            throw Exception("model dimensionality doesn't match pca");
+        }
+
+        // round trip precision for doubles
+        output << std::setprecision(std::numeric_limits<double>::max_digits10);
+        output << "// generated by 'main export-header', do not edit\n";
+        output << "#pragma once\n\n";
+        output << "#include <cstddef>\n\n\n";
+        output << "namespace " << name_space << " {\n\n";
+        output << "template <class = void>\n";
+        output << "struct ModelData {\n";
+        output << "    static constexpr bool kPreprocessed = " << (pca ? "true" : "false") << ";\n";
+        output << "    static constexpr bool kWithSquares = " << (with_squares ? "true" : "false") << ";\n";
+        output << "    static constexpr std::size_t kNbLabels = " << labels.size() << ";\n";
+        output << "    static constexpr std::size_t kNbModels = " << models.size() << ";\n";
+        output << "    static constexpr std::size_t kInputDim = " << input_dim << ";\n";
+        if (pca) {
+            output << "    static constexpr std::size_t kProjectedDim = " << projected_dim << ";\n";
+        }
+        output << "    static constexpr std::size_t kModelDim = " << model_dim << ";\n";
+        if (pca) {
+            output << "    static constexpr double kMean = " << mean << ";\n";
+            output << "    static constexpr double kStdDev = " << std_dev << ";\n";
+        }
+        output << "\n";
+
+        output << "    alignas(64) static constexpr int kLabels[kNbLabels] = ";
+        WriteValues(output, labels.data(), labels.size(), "        ");
+        output << ";\n";
+        output << "    alignas(64) static constexpr double kBiases[kNbModels] = ";
+        WriteValues(output, biases.data(), biases.size(), "        ");
+        output << ";\n";
+        WriteArray(output, "kWeights[kNbModels][kModelDim]", models);
+
+        std::vector<std::string> arrays = {"kLabels", "kBiases", "kWeights"};
+        if (pca) {
+            auto pca_mean = MatToRows(pca->mean);
+            output << "    alignas(64) static constexpr double kPCAMean[kInputDim] = ";
+            WriteValues(output, pca_mean[0].data(), pca_mean[0].size(), "        ");
+            output << ";\n";
+            WriteArray(output, "kPCAEigenvectors[kProjectedDim][kInputDim]", MatToRows(pca->eigenvectors));
+            arrays.push_back("kPCAMean");
+            arrays.push_back("kPCAEigenvectors");
+        }
+        output << "};\n\n";
+
+        // namespace scope definitions of odr-used members, required before c++17
+        for (auto &array : arrays) {
+            output << "template <class T>\n";
+            output << "alignas(64) constexpr decltype(ModelData<T>::" << array << ") ModelData<T>::" << array << ";\n";
+        }
+        output << "\n";
+        output << "typedef ModelData<> Model;\n\n";
+        output << "} // namespace " << name_space << "\n";
+    }
+
+    void WriteModelHeader(std::ostream &output,
+                          const MulticlassSVM &svm,
+                          const std::string &name_space) {
+        WriteModelHeader(output, svm, nullptr, 0, 1, name_space);
+    }
+
+    void WriteModelHeader(std::ostream &output,
+                          const MulticlassSVM &svm,
+                          const cv::PCA &pca,
+                          double mean,
+                          double std_dev,
+                          const std::string &name_space) {
+        WriteModelHeader(output, svm, &pca, mean, std_dev, name_space);
+    }
+} // namespace ml
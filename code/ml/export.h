@@ -0,0 +1,29 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+#include "multiclass_svm.h"
+
+
+namespace ml {
+
+/**
+ * Writes the model as aligned constexpr arrays, to be compiled
+ * into a binary and used with EmbeddedPredictor<name_space::Model>.
+ */
+void WriteModelHeader(std::ostream &output,
+                      const MulticlassSVM &svm,
+                      const std::string &name_space);
+
+// same, for a model trained on preprocessed input
+void WriteModelHeader(std::ostream &output,
+                      const MulticlassSVM &svm,
+                      const cv::PCA &pca,
+                      double mean,
+                      double std_dev,
+                      const std::string &name_space);
+
+} // namespace ml
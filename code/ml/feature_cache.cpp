@@ -0,0 +1,161 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "exception.h"
+#include "feature_cache.h"
+#include "logger.h"
+#include "mapped_file.h"
+#include "util.h"
+
+
+namespace ml {
+    const char FEATURE_CACHE_MAGIC[4] = {'M', 'F', 'T', 'C'};
+    const uint32_t FEATURE_CACHE_VERSION = 1;
+
+    // features start at a cache line, the mapping itself is page aligned
+    struct FeatureCacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint64_t nb_rows;
+        uint64_t nb_cols;
+        uint64_t reserved[4];
+    };
+
+    FeatureCache::FeatureCache(std::unique_ptr<MappedFile> file, size_t nb_rows, size_t nb_cols)
+    :file_(std::move(file)), nb_rows_(nb_rows), nb_cols_(nb_cols) {}
+
+    std::unique_ptr<FeatureCache> FeatureCache::Open(const std::string &path, uint64_t key) {
+        std::unique_ptr<MappedFile> file;
+        try {
+            file.reset(new MappedFile(path));
+        } catch (const Exception &) {
+            return nullptr;
+        }
+
+        FeatureCacheHeader header;
+        if (file->GetSize() < sizeof(header)) {
+            return nullptr;
+        }
+        std::memcpy(&header, file->GetData(), sizeof(header));
+        if (!std::equal(header.magic, header.magic + sizeof(header.magic), FEATURE_CACHE_MAGIC) ||
+            header.version != FEATURE_CACHE_VERSION ||
+            header.key != key) {
+            return nullptr;
+        }
+
+        // sizes are bounded by the file before they are multiplied, a damaged header can't wrap them around
+        const size_t file_size = file->GetSize();
+        if (header.nb_rows > file_size / sizeof(uint64_t) ||
+            (header.nb_rows > 0 && header.nb_cols > file_size / (header.nb_rows * sizeof(double)))) {
+            return nullptr;
+        }
+        size_t offsets_begin = sizeof(header) + header.nb_rows * header.nb_cols * sizeof(double);
+        size_t paths_begin = offsets_begin + (header.nb_rows + 1) * sizeof(uint64_t);
+        if (file->GetSize() < paths_begin) {
+            return nullptr;
+        }
+        std::vector<uint64_t> offsets(header.nb_rows + 1);
+        std::memcpy(offsets.data(), file->GetData() + offsets_begin, offsets.size() * sizeof(uint64_t));
+        if (!IsValidOffsetTable(offsets, file->GetSize() - paths_begin)) {
+            return nullptr;
+        }
+
+        const char *paths = reinterpret_cast<const char*>(file->GetData() + paths_begin);
+        std::unique_ptr<FeatureCache> cache(new FeatureCache(std::move(file), header.nb_rows, header.nb_cols));
+        cache->image_paths_.resize(header.nb_rows);
+        for (size_t i = 0; i < header.nb_rows; ++i) {
+            cache->image_paths_[i].assign(paths + offsets[i], paths + offsets[i + 1]);
+        }
+        return cache;
+    }
+
+    void FeatureCache::Save(const std::string &path,
+                            uint64_t key,
+                            const std::vector<std::vector<double>> &features,
+                            const std::vector<std::string> &image_paths) {
+        if (features.size() != image_paths.size()) {
+            throw Exception("features and image paths have different size");
+        }
+
+        FeatureCacheHeader header = {};
+        std::copy(FEATURE_CACHE_MAGIC, FEATURE_CACHE_MAGIC + sizeof(FEATURE_CACHE_MAGIC), header.magic);
+        header.version = FEATURE_CACHE_VERSION;
+        header.key = key;
+        header.nb_rows = features.size();
+        header.nb_cols = features.empty() ? 0 : features[0].size();
+
+        std::vector<uint64_t> offsets(1, 0);
+        for (auto &image_path : image_paths) {
+            offsets.push_back(offsets.back() + image_path.size());
+        }
+
+        Log(LogLevel::Info) << "saving feature cache " << path;
+        std::string tmp_path = path + ".tmp";
+        {
+            std::ofstream output(tmp_path, std::ios::binary);
+            output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for (size_t i = 0; i < features.size(); ++i) {
+                ValidateDimensions(header.nb_cols, features[i].size(), i);
+                output.write(reinterpret_cast<const char*>(features[i].data()),
+                             features[i].size() * sizeof(double));
+            }
+            output.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+            for (auto &image_path : image_paths) {
+                output.write(image_path.data(), image_path.size());
+            }
+            if (!output) {
+                std::remove(tmp_path.c_str());
+                throw Exception("can't write feature cache " + path);
+            }
+        }
+        std::rename(tmp_path.c_str(), path.c_str());
+    }
+
+    size_t FeatureCache::GetRows() const {
+        return nb_rows_;
+    }
+
+    size_t FeatureCache::GetCols() const {
+        return nb_cols_;
+    }
+
+    const double* FeatureCache::GetData() const {
+        return reinterpret_cast<const double*>(file_->GetData() + sizeof(FeatureCacheHeader));
+    }
+
+    const std::vector<std::string>& FeatureCache::GetImagePaths() const {
+        return image_paths_;
+    }
+
+    uint64_t GetFeatureCacheKey(const std::string &data_path, const std::string &model_path) {
+        uint64_t key = HashFile(data_path);
+        // images are not read, a rewritten image is noticed by its size and modification time
+        for (auto &image_path : ReadImagePaths(data_path)) {
+            struct stat info;
+            int64_t stamp[2] = {-1, -1};
+            if (stat(image_path.c_str(), &info) == 0) {
+                stamp[0] = info.st_size;
+                stamp[1] = info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+            }
+            key = HashBytes(stamp, sizeof(stamp), key);
+        }
+        key = HashFile(model_path + ".pca", key);
+        return HashFile(model_path + ".norm", key);
+    }
+
+    std::string GetFeatureCachePath(const std::string &data_path, uint64_t key) {
+        std::ostringstream path;
+        path << data_path << "." << std::hex << key << ".features";
+        return path.str();
+    }
+
+} // namespace ml
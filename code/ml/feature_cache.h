@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+
+namespace ml {
+
+/**
+ * Memory mapped projected (normalized and PCA transformed) features
+ * of a data set, stored along with the image paths. Rows are contiguous.
+ */
+class FeatureCache {
+public:
+    // nullptr if the file is missing, damaged or was written for another key
+    static std::unique_ptr<FeatureCache> Open(const std::string &path, uint64_t key);
+
+    static void Save(const std::string &path,
+                     uint64_t key,
+                     const std::vector<std::vector<double>> &features,
+                     const std::vector<std::string> &image_paths);
+
+    size_t GetRows() const;
+    size_t GetCols() const;
+    const double* GetData() const;
+    const std::vector<std::string>& GetImagePaths() const;
+
+private:
+    FeatureCache(std::unique_ptr<MappedFile> file, size_t nb_rows, size_t nb_cols);
+
+    std::unique_ptr<MappedFile> file_;
+    size_t nb_rows_;
+    size_t nb_cols_;
+    std::vector<std::string> image_paths_;
+};
+
+// hash of the description file, the size and modification time of its images
+// and of model_path.pca and model_path.norm
+uint64_t GetFeatureCacheKey(const std::string &data_path, const std::string &model_path);
+
+// features for different models are kept side by side
+std::string GetFeatureCachePath(const std::string &data_path, uint64_t key);
+
+} // namespace ml
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "kernels.h"
+
+
+namespace ml {
+    // dimensions specialized in every build: raw images
+    // and quadratic expansions of usual PCA sizes
+    KernelRegistrar<MNIST_DIM> registrar_mnist;
+    KernelRegistrar<QuadraticDim(40)> registrar_quadratic_40;
+    KernelRegistrar<QuadraticDim(50)> registrar_quadratic_50;
+    KernelRegistrar<QuadraticDim(60)> registrar_quadratic_60;
+    KernelRegistrar<QuadraticDim(80)> registrar_quadratic_80;
+
+    struct KernelRegistry {
+        std::mutex mutex;
+        std::map<size_t, DotProductKernel> kernels;
+        std::atomic<size_t> version{0};
+    };
+
+    KernelRegistry& GetKernelRegistry() {
+        // function local, safe to use from static initializers of other units
+        static KernelRegistry registry;
+        return registry;
+    }
+
+    double GenericDotProduct(const double *v1, const double *v2, size_t nb_dim) {
+        double acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+        size_t i = 0;
+        for (; i + 4 <= nb_dim; i += 4) {
+            acc0 += v1[i] * v2[i];
+            acc1 += v1[i + 1] * v2[i + 1];
+            acc2 += v1[i + 2] * v2[i + 2];
+            acc3 += v1[i + 3] * v2[i + 3];
+        }
+        for (; i < nb_dim; ++i) {
+            acc0 += v1[i] * v2[i];
+        }
+        return (acc0 + acc1) + (acc2 + acc3);
+    }
+
+    void AddScaled(double alpha, const double *x, double *y, size_t nb_dim) {
+        size_t i = 0;
+        for (; i + 4 <= nb_dim; i += 4) {
+            y[i] += alpha * x[i];
+            y[i + 1] += alpha * x[i + 1];
+            y[i + 2] += alpha * x[i + 2];
+            y[i + 3] += alpha * x[i + 3];
+        }
+        for (; i < nb_dim; ++i) {
+            y[i] += alpha * x[i];
+        }
+    }
+
+    void RegisterDotProductKernel(size_t nb_dim, DotProductKernel kernel) {
+        auto &registry = GetKernelRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.kernels[nb_dim] = kernel;
+        ++registry.version;
+    }
+
+    void UnregisterDotProductKernel(size_t nb_dim) {
+        auto &registry = GetKernelRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.kernels.erase(nb_dim);
+        ++registry.version;
+    }
+
+    size_t GetKernelRegistryVersion() {
+        return GetKernelRegistry().version.load();
+    }
+
+    DotProductKernel GetDotProductKernel(size_t nb_dim) {
+        auto &registry = GetKernelRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        auto it = registry.kernels.find(nb_dim);
+        return it == registry.kernels.end() ? &GenericDotProduct : it->second;
+    }
+
+    bool HasSpecializedKernel(size_t nb_dim) {
+        return GetDotProductKernel(nb_dim) != &GenericDotProduct;
+    }
+
+    void WriteSpecializedKernels(std::ostream &output,
+                                 const std::vector<size_t> &dims,
+                                 const std::string &description) {
+        std::vector<size_t> unique_dims(dims);
+        std::sort(unique_dims.begin(), unique_dims.end());
+        unique_dims.erase(std::unique(unique_dims.begin(), unique_dims.end()), unique_dims.end());
+
+        output << "// generated by 'main gen-kernels' for " << description << "\n";
+        output << "// add to MNIST_SVM_GENERATED_KERNELS to build it in, do not edit\n";
+        output << "\n";
+        output << "#include \"kernels.h\"\n";
+        output << "\n";
+        output << "\n";
+        output << "namespace {\n";
+        for (auto nb_dim : unique_dims) {
+            output << "    ml::KernelRegistrar<" << nb_dim << "> registrar_" << nb_dim << ";\n";
+        }
+        output << "} // namespace\n";
+    }
+} // namespace ml
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace ml {
+
+typedef double (*DotProductKernel)(const double *v1, const double *v2, size_t nb_dim);
+
+constexpr size_t QuadraticDim(size_t nb_dim) {
+    return nb_dim + nb_dim * (nb_dim - 1) / 2;
+}
+
+// raw MNIST images
+const size_t MNIST_DIM = 28 * 28;
+
+double GenericDotProduct(const double *v1, const double *v2, size_t nb_dim);
+
+// y += alpha * x, the update step of the gradient solvers
+void AddScaled(double alpha, const double *x, double *y, size_t nb_dim);
+
+namespace detail {
+
+const size_t UNROLL = 8;
+
+// acc[k] += v1[k] * v2[k] for k < Count, expanded at compile time
+template <size_t Count>
+struct Accumulate {
+    static inline void Run(double *acc, const double *v1, const double *v2) {
+        Accumulate<Count - 1>::Run(acc, v1, v2);
+        acc[Count - 1] += v1[Count - 1] * v2[Count - 1];
+    }
+};
+
+template <>
+struct Accumulate<0> {
+    static inline void Run(double *, const double *, const double *) {}
+};
+
+} // namespace detail
+
+/**
+ * Dot product over N values known at compile time.
+ * Blocks of 8 values go to 8 independent accumulators, which the compiler
+ * maps onto vector registers; trip count and tail are resolved statically.
+ */
+template <size_t N>
+inline double FixedDotProduct(const double *v1, const double *v2) {
+    const size_t nb_blocks = N / detail::UNROLL;
+    double acc[detail::UNROLL] = {0, 0, 0, 0, 0, 0, 0, 0};
+    for (size_t b = 0; b < nb_blocks; ++b) {
+        detail::Accumulate<detail::UNROLL>::Run(
+            acc, v1 + b * detail::UNROLL, v2 + b * detail::UNROLL);
+    }
+    detail::Accumulate<N % detail::UNROLL>::Run(
+        acc, v1 + nb_blocks * detail::UNROLL, v2 + nb_blocks * detail::UNROLL);
+    return ((acc[0] + acc[4]) + (acc[1] + acc[5])) + ((acc[2] + acc[6]) + (acc[3] + acc[7]));
+}
+
+template <size_t N>
+double SpecializedDotProduct(const double *v1, const double *v2, size_t) {
+    return FixedDotProduct<N>(v1, v2);
+}
+
+void RegisterDotProductKernel(size_t nb_dim, DotProductKernel kernel);
+
+// nb_dim falls back to GenericDotProduct
+void UnregisterDotProductKernel(size_t nb_dim);
+
+// changes on every registration, lets callers caching a kernel notice it
+size_t GetKernelRegistryVersion();
+
+// specialized kernel for nb_dim if there is one, GenericDotProduct otherwise
+DotProductKernel GetDotProductKernel(size_t nb_dim);
+
+bool HasSpecializedKernel(size_t nb_dim);
+
+/**
+ * Registers SpecializedDotProduct<N> during static initialization,
+ * used by the translation units emitted by WriteSpecializedKernels
+ */
+template <size_t N>
+struct KernelRegistrar {
+    KernelRegistrar() {
+        RegisterDotProductKernel(N, &SpecializedDotProduct<N>);
+    }
+};
+
+/**
+ * Emits C++ source of a translation unit which specializes
+ * the scoring kernels for given dimensions.
+ */
+void WriteSpecializedKernels(std::ostream &output,
+                             const std::vector<size_t> &dims,
+                             const std::string &description);
+
+} // namespace ml
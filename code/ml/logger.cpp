@@ -0,0 +1,178 @@
+#include <iostream>
+#include <string>
+#include <utility>
+
+#include "exception.h"
+#include "logger.h"
+
+
+namespace ml {
+    // longest time a line waits in the ring when nobody flushes
+    const std::chrono::milliseconds DRAIN_INTERVAL(10);
+
+    LogLevel ParseLogLevel(const std::string &name) {
+        if (name == "debug") {
+            return LogLevel::Debug;
+        }
+        if (name == "info") {
+            return LogLevel::Info;
+        }
+        if (name == "warning") {
+            return LogLevel::Warning;
+        }
+        if (name == "error") {
+            return LogLevel::Error;
+        }
+        if (name == "off") {
+            return LogLevel::Off;
+        }
+        throw Exception("unknown log level " + name);
+    }
+
+    Logger::Logger(std::ostream &output, size_t capacity)
+        :lines_(capacity),
+         level_(static_cast<int>(LogLevel::Info)),
+         nb_pushed_(0),
+         nb_dropped_(0),
+         output_(&output),
+         nb_written_(0),
+         flush_(false),
+         stop_(false) {
+        thread_ = std::thread([this]() { DrainLoop(); });
+    }
+
+    Logger::~Logger() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        flush_requested_.notify_one();
+        thread_.join();
+    }
+
+    void Logger::SetLevel(LogLevel level) {
+        level_.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    LogLevel Logger::GetLevel() const {
+        return static_cast<LogLevel>(level_.load(std::memory_order_relaxed));
+    }
+
+    bool Logger::IsEnabled(LogLevel level) const {
+        return level != LogLevel::Off &&
+               static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+    }
+
+    void Logger::SetOutput(std::ostream &output) {
+        Flush();
+        std::lock_guard<std::mutex> lock(mutex_);
+        output_ = &output;
+    }
+
+    void Logger::Log(LogLevel level, std::string line) {
+        if (!IsEnabled(level)) {
+            return;
+        }
+        if (lines_.TryPush(line)) {
+            nb_pushed_.fetch_add(1, std::memory_order_release);
+        } else {
+            nb_dropped_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void Logger::Flush() {
+        size_t target = nb_pushed_.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (nb_written_ < target && !stop_) {
+            flush_ = true;
+            flush_requested_.notify_one();
+            drained_.wait(lock);
+        }
+    }
+
+    size_t Logger::GetNumDropped() const {
+        return nb_dropped_.load(std::memory_order_relaxed);
+    }
+
+    size_t Logger::Drain() {
+        size_t nb_lines = 0;
+        std::string line;
+        while (lines_.TryPop(line)) {
+            *output_ << line << '\n';
+            ++nb_lines;
+        }
+        if (nb_lines > 0) {
+            output_->flush();
+        }
+        return nb_lines;
+    }
+
+    void Logger::DrainLoop() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            flush_requested_.wait_for(lock, DRAIN_INTERVAL, [this]() { return flush_ || stop_; });
+            // producers never take the mutex, holding it only keeps the output stable
+            nb_written_ += Drain();
+            flush_ = false;
+            drained_.notify_all();
+            if (stop_) {
+                break;
+            }
+        }
+
+        size_t nb_dropped = GetNumDropped();
+        if (nb_dropped > 0) {
+            *output_ << nb_dropped << " log lines were dropped" << std::endl;
+        }
+    }
+
+    Logger& GetLogger() {
+        static Logger logger(std::cout);
+        return logger;
+    }
+
+    Log::Log(LogLevel level, Logger &logger)
+        :logger_(logger), level_(level), enabled_(logger.IsEnabled(level)) {}
+
+    Log::~Log() {
+        if (enabled_) {
+            logger_.Log(level_, stream_.str());
+        }
+    }
+
+    ScopedLogLevel::ScopedLogLevel(LogLevel level, Logger &logger)
+        :logger_(logger), saved_(logger.GetLevel()) {
+        logger.SetLevel(level);
+    }
+
+    ScopedLogLevel::~ScopedLogLevel() {
+        logger_.SetLevel(saved_);
+    }
+
+    ProgressReporter::ProgressReporter(const std::string &what,
+                                       size_t nb_total,
+                                       std::chrono::milliseconds interval,
+                                       Logger &logger)
+        :what_(what),
+         nb_total_(nb_total),
+         interval_(interval),
+         logger_(logger),
+         last_report_(std::chrono::steady_clock::now()) {}
+
+    void ProgressReporter::Update(size_t nb_done) {
+        if (!logger_.IsEnabled(LogLevel::Info)) {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_report_ < interval_) {
+            return;
+        }
+        last_report_ = now;
+
+        Log line(LogLevel::Info, logger_);
+        line << what_ << " " << nb_done;
+        if (nb_total_ > 0) {
+            line << " of " << nb_total_;
+        }
+    }
+} // namespace ml
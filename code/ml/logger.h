@@ -0,0 +1,145 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "bounded_queue.h"
+
+
+namespace ml {
+
+enum class LogLevel {
+    Debug,
+    Info,
+    Warning,
+    Error,
+    // nothing is logged
+    Off
+};
+
+// debug, info, warning, error or off
+LogLevel ParseLogLevel(const std::string &name);
+
+/**
+ * Asynchronous leveled logger. Callers push formatted lines into
+ * a bounded lock-free ring and a background thread writes them out,
+ * flushing the output once per drained batch instead of once per line.
+ * A caller never waits for the output, lines are dropped and counted
+ * when the ring is full.
+ */
+class Logger {
+public:
+    explicit Logger(std::ostream &output, size_t capacity = 4096);
+    ~Logger();
+
+    Logger(const Logger &) = delete;
+    Logger& operator=(const Logger &) = delete;
+
+    void SetLevel(LogLevel level);
+    LogLevel GetLevel() const;
+    bool IsEnabled(LogLevel level) const;
+
+    // lines already queued go to the previous output
+    void SetOutput(std::ostream &output);
+
+    void Log(LogLevel level, std::string line);
+
+    // blocks until every line queued before the call is written
+    void Flush();
+
+    size_t GetNumDropped() const;
+
+private:
+    void DrainLoop();
+    // returns the number of written lines
+    size_t Drain();
+
+    BoundedQueue<std::string> lines_;
+    std::atomic<int> level_;
+    std::atomic<size_t> nb_pushed_;
+    std::atomic<size_t> nb_dropped_;
+
+    std::mutex mutex_;
+    std::condition_variable drained_;
+    std::condition_variable flush_requested_;
+    std::ostream *output_;
+    size_t nb_written_;
+    bool flush_;
+    bool stop_;
+    std::thread thread_;
+};
+
+// logger of the library, writes to std::cout at info level
+Logger& GetLogger();
+
+/**
+ * One line of the log, written when the object is destroyed:
+ * Log(LogLevel::Info) << "loaded " << nb_images << " images";
+ * Nothing is formatted if the level is disabled.
+ */
+class Log {
+public:
+    explicit Log(LogLevel level, Logger &logger = GetLogger());
+    ~Log();
+
+    Log(const Log &) = delete;
+    Log& operator=(const Log &) = delete;
+
+    template <class T>
+    Log& operator<<(const T &value) {
+        if (enabled_) {
+            stream_ << value;
+        }
+        return *this;
+    }
+
+private:
+    Logger &logger_;
+    LogLevel level_;
+    bool enabled_;
+    std::ostringstream stream_;
+};
+
+// changes the level for the lifetime of the scope, e.g. to silence benchmarks
+class ScopedLogLevel {
+public:
+    explicit ScopedLogLevel(LogLevel level, Logger &logger = GetLogger());
+    ~ScopedLogLevel();
+
+    ScopedLogLevel(const ScopedLogLevel &) = delete;
+    ScopedLogLevel& operator=(const ScopedLogLevel &) = delete;
+
+private:
+    Logger &logger_;
+    LogLevel saved_;
+};
+
+/**
+ * Progress of a long loop logged at most once per interval.
+ * Update is cheap enough to be called for every item.
+ */
+class ProgressReporter {
+public:
+    ProgressReporter(const std::string &what,
+                     size_t nb_total = 0,
+                     std::chrono::milliseconds interval = std::chrono::milliseconds(1000),
+                     Logger &logger = GetLogger());
+
+    void Update(size_t nb_done);
+
+private:
+    std::string what_;
+    size_t nb_total_;
+    std::chrono::steady_clock::duration interval_;
+    Logger &logger_;
+    std::chrono::steady_clock::time_point last_report_;
+};
+
+} // namespace ml
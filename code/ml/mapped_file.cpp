@@ -0,0 +1,52 @@
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "exception.h"
+#include "mapped_file.h"
+
+
+namespace ml {
+    MappedFile::MappedFile(const std::string &path) :data_(nullptr), size_(0) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw Exception("can't open " + path);
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            throw Exception("can't stat " + path);
+        }
+
+        size_ = info.st_size;
+        if (size_ > 0) {
+            void *data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                close(fd);
+                throw Exception("can't map " + path);
+            }
+            data_ = static_cast<const uint8_t*>(data);
+        }
+        // the mapping stays valid after the descriptor is closed
+        close(fd);
+    }
+
+    MappedFile::~MappedFile() {
+        if (data_) {
+            munmap(const_cast<uint8_t*>(data_), size_);
+        }
+    }
+
+    const uint8_t* MappedFile::GetData() const {
+        return data_;
+    }
+
+    size_t MappedFile::GetSize() const {
+        return size_;
+    }
+
+} // namespace ml
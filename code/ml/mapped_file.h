@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+
+namespace ml {
+
+/**
+ * Read-only memory mapping of a whole file. Pages are loaded
+ * on first access, repeated reads come from the page cache.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile& operator=(const MappedFile &) = delete;
+
+    const uint8_t* GetData() const;
+    size_t GetSize() const;
+
+private:
+    const uint8_t *data_;
+    size_t size_;
+};
+
+} // namespace ml
@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <malloc.h>
+
+#include "exception.h"
+#include "memory.h"
+#include "metrics.h"
+
+
+namespace ml {
+    const double MEGABYTE = 1024.0 * 1024.0;
+
+    std::string FormatMegabytes(size_t bytes) {
+        std::ostringstream output;
+        output << std::fixed << std::setprecision(1) << bytes / MEGABYTE << " MB";
+        return output.str();
+    }
+
+    MemoryUsage GetMemoryUsage() {
+        MemoryUsage usage;
+        std::ifstream input("/proc/self/status");
+        std::string line;
+        while (std::getline(input, line)) {
+            std::istringstream iss(line);
+            std::string key;
+            size_t kilobytes = 0;
+            if (!(iss >> key >> kilobytes)) {
+                continue;
+            }
+            if (key == "VmRSS:") {
+                usage.rss_bytes = kilobytes * 1024;
+            } else if (key == "VmHWM:") {
+                usage.peak_rss_bytes = kilobytes * 1024;
+            }
+        }
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        struct mallinfo2 info = mallinfo2();
+        usage.heap_bytes = info.uordblks + info.hblkhd;
+#endif
+        return usage;
+    }
+
+    size_t EstimateMatrixBytes(size_t nb_rows, size_t nb_cols) {
+        return nb_rows * (sizeof(std::vector<double>) + nb_cols * sizeof(double));
+    }
+
+    size_t GetMatrixBytes(const std::vector<std::vector<double>> &x) {
+        size_t bytes = x.capacity() * sizeof(std::vector<double>);
+        for (auto &row : x) {
+            bytes += row.capacity() * sizeof(double);
+        }
+        return bytes;
+    }
+
+    MemoryTracker::MemoryTracker()
+        :budget_(0), next_id_(0), tracked_bytes_(0), peak_tracked_bytes_(0) {}
+
+    void MemoryTracker::SetBudget(size_t budget_bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        budget_ = budget_bytes;
+    }
+
+    size_t MemoryTracker::GetBudget() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return budget_;
+    }
+
+    void MemoryTracker::CheckBudget(const std::string &stage, size_t estimated_bytes) const {
+        size_t budget = GetBudget();
+        if (budget == 0) {
+            return;
+        }
+
+        size_t rss = GetMemoryUsage().rss_bytes;
+        if (rss + estimated_bytes > budget) {
+            throw Exception(
+                "stage " + stage + " needs about " + FormatMegabytes(estimated_bytes) +
+                " on top of " + FormatMegabytes(rss) + " resident, memory budget is " +
+                FormatMegabytes(budget)
+            );
+        }
+    }
+
+    size_t MemoryTracker::Track(const std::string &name, size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_t id = next_id_++;
+        buffers_.push_back({id, name, bytes});
+        tracked_bytes_ += bytes;
+        UpdatePeak();
+        return id;
+    }
+
+    void MemoryTracker::Update(size_t id, size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &buffer : buffers_) {
+            if (buffer.id == id) {
+                tracked_bytes_ = tracked_bytes_ - buffer.bytes + bytes;
+                buffer.bytes = bytes;
+                UpdatePeak();
+                return;
+            }
+        }
+    }
+
+    void MemoryTracker::Release(size_t id) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = buffers_.begin(); it != buffers_.end(); ++it) {
+            if (it->id == id) {
+                tracked_bytes_ -= it->bytes;
+                buffers_.erase(it);
+                return;
+            }
+        }
+    }
+
+    void MemoryTracker::UpdatePeak() {
+        if (tracked_bytes_ > peak_tracked_bytes_) {
+            peak_tracked_bytes_ = tracked_bytes_;
+            peak_buffers_ = buffers_;
+        }
+    }
+
+    size_t MemoryTracker::GetTrackedBytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return tracked_bytes_;
+    }
+
+    size_t MemoryTracker::GetPeakTrackedBytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return peak_tracked_bytes_;
+    }
+
+    template <class Buffers>
+    std::vector<std::pair<std::string, size_t>> SortBySize(const Buffers &buffers) {
+        std::vector<std::pair<std::string, size_t>> result;
+        for (auto &buffer : buffers) {
+            result.emplace_back(buffer.name, buffer.bytes);
+        }
+        std::stable_sort(result.begin(), result.end(), [](const std::pair<std::string, size_t> &a,
+                                                          const std::pair<std::string, size_t> &b) {
+            return a.second > b.second;
+        });
+        return result;
+    }
+
+    std::vector<std::pair<std::string, size_t>> MemoryTracker::GetLiveBuffers() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return SortBySize(buffers_);
+    }
+
+    std::vector<std::pair<std::string, size_t>> MemoryTracker::GetPeakBuffers() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return SortBySize(peak_buffers_);
+    }
+
+    void MemoryTracker::AddStage(const StageMemory &stage) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stages_.push_back(stage);
+    }
+
+    std::vector<StageMemory> MemoryTracker::GetStages() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stages_;
+    }
+
+    void MemoryTracker::Reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        next_id_ = 0;
+        tracked_bytes_ = 0;
+        peak_tracked_bytes_ = 0;
+        buffers_.clear();
+        peak_buffers_.clear();
+        stages_.clear();
+    }
+
+    void MemoryTracker::WriteReport(std::ostream &output, size_t nb_buffers) const {
+        auto stages = GetStages();
+        output << "memory by stage (rss after, peak rss, heap change, estimate):" << std::endl;
+        for (auto &stage : stages) {
+            double heap_change = (double(stage.after.heap_bytes) - double(stage.before.heap_bytes)) / MEGABYTE;
+            output << "  " << std::left << std::setw(24) << stage.name << std::right;
+            output << " " << std::setw(12) << FormatMegabytes(stage.after.rss_bytes);
+            output << " " << std::setw(12) << FormatMegabytes(stage.after.peak_rss_bytes);
+            output << " " << std::setw(10) << std::fixed << std::setprecision(1) << heap_change << " MB";
+            output << " " << std::setw(12) << FormatMegabytes(stage.estimated_bytes) << std::endl;
+        }
+        output.unsetf(std::ios::floatfield);
+
+        auto buffers = GetPeakBuffers();
+        output << "largest live buffers at the tracked peak of ";
+        output << FormatMegabytes(GetPeakTrackedBytes()) << ":" << std::endl;
+        for (size_t i = 0; i < std::min(nb_buffers, buffers.size()); ++i) {
+            output << "  " << std::left << std::setw(24) << buffers[i].first << std::right;
+            output << " " << std::setw(12) << FormatMegabytes(buffers[i].second) << std::endl;
+        }
+
+        auto usage = GetMemoryUsage();
+        output << "resident " << FormatMegabytes(usage.rss_bytes) << ", peak resident ";
+        output << FormatMegabytes(usage.peak_rss_bytes) << std::endl;
+    }
+
+    MemoryTracker& GetMemoryTracker() {
+        static MemoryTracker tracker;
+        return tracker;
+    }
+
+    TrackedBuffer::TrackedBuffer(const std::string &name, size_t bytes, MemoryTracker &tracker)
+        :tracker_(tracker), id_(tracker.Track(name, bytes)) {}
+
+    TrackedBuffer::~TrackedBuffer() {
+        tracker_.Release(id_);
+    }
+
+    void TrackedBuffer::Update(size_t bytes) {
+        tracker_.Update(id_, bytes);
+    }
+
+    MemoryStage::MemoryStage(const std::string &name, size_t estimated_bytes, MemoryTracker &tracker)
+        :tracker_(tracker) {
+        tracker.CheckBudget(name, estimated_bytes);
+        stage_.name = name;
+        stage_.estimated_bytes = estimated_bytes;
+        stage_.before = GetMemoryUsage();
+    }
+
+    MemoryStage::~MemoryStage() {
+        stage_.after = GetMemoryUsage();
+        tracker_.AddStage(stage_);
+
+        std::string label = "{stage=\"" + stage_.name + "\"}";
+        Metrics &metrics = GetMetrics();
+        metrics.SetGauge("memory_rss_bytes" + label, stage_.after.rss_bytes);
+        metrics.SetGauge("memory_peak_rss_bytes" + label, stage_.after.peak_rss_bytes);
+        metrics.SetGauge("memory_heap_change_bytes" + label,
+                         double(stage_.after.heap_bytes) - double(stage_.before.heap_bytes));
+        metrics.SetGauge("memory_estimated_bytes" + label, stage_.estimated_bytes);
+    }
+} // namespace ml
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+
+namespace ml {
+
+struct MemoryUsage {
+    // VmRSS and VmHWM of the process, zero where /proc is not available
+    size_t rss_bytes = 0;
+    size_t peak_rss_bytes = 0;
+    // bytes handed out by malloc and not freed yet
+    size_t heap_bytes = 0;
+};
+
+MemoryUsage GetMemoryUsage();
+
+// footprint of a std::vector<std::vector<double>> with nb_rows rows of nb_cols values
+size_t EstimateMatrixBytes(size_t nb_rows, size_t nb_cols);
+
+size_t GetMatrixBytes(const std::vector<std::vector<double>> &x);
+
+struct StageMemory {
+    std::string name;
+    size_t estimated_bytes = 0;
+    MemoryUsage before;
+    MemoryUsage after;
+};
+
+/**
+ * Memory accounting of a run: usage sampled at stage boundaries,
+ * sizes of large named buffers and an optional budget. The buffers
+ * live at the moment their total peaked are kept for the report.
+ */
+class MemoryTracker {
+public:
+    MemoryTracker();
+
+    // 0 disables the budget
+    void SetBudget(size_t budget_bytes);
+    size_t GetBudget() const;
+
+    // throws if resident memory plus estimated_bytes would exceed the budget
+    void CheckBudget(const std::string &stage, size_t estimated_bytes) const;
+
+    // returns an id for Update and Release
+    size_t Track(const std::string &name, size_t bytes);
+    void Update(size_t id, size_t bytes);
+    void Release(size_t id);
+
+    size_t GetTrackedBytes() const;
+    size_t GetPeakTrackedBytes() const;
+
+    // largest first
+    std::vector<std::pair<std::string, size_t>> GetLiveBuffers() const;
+    std::vector<std::pair<std::string, size_t>> GetPeakBuffers() const;
+
+    void AddStage(const StageMemory &stage);
+    std::vector<StageMemory> GetStages() const;
+
+    void Reset();
+
+    void WriteReport(std::ostream &output, size_t nb_buffers = 10) const;
+
+private:
+    struct Buffer {
+        size_t id;
+        std::string name;
+        size_t bytes;
+    };
+
+    void UpdatePeak();
+
+    mutable std::mutex mutex_;
+    size_t budget_;
+    size_t next_id_;
+    size_t tracked_bytes_;
+    size_t peak_tracked_bytes_;
+    std::vector<Buffer> buffers_;
+    std::vector<Buffer> peak_buffers_;
+    std::vector<StageMemory> stages_;
+};
+
+MemoryTracker& GetMemoryTracker();
+
+/**
+ * Named buffer registered with the memory tracker for its lifetime
+ */
+class TrackedBuffer {
+public:
+    TrackedBuffer(const std::string &name, size_t bytes, MemoryTracker &tracker = GetMemoryTracker());
+    ~TrackedBuffer();
+
+    TrackedBuffer(const TrackedBuffer &) = delete;
+    TrackedBuffer& operator=(const TrackedBuffer &) = delete;
+
+    void Update(size_t bytes);
+
+private:
+    MemoryTracker &tracker_;
+    size_t id_;
+};
+
+/**
+ * Checks the budget against the estimate when a stage starts and
+ * samples memory usage at both of its ends. Usage is recorded with the
+ * tracker and as memory_* gauges labelled by stage in the metrics.
+ */
+class MemoryStage {
+public:
+    explicit MemoryStage(const std::string &name,
+                         size_t estimated_bytes = 0,
+                         MemoryTracker &tracker = GetMemoryTracker());
+    ~MemoryStage();
+
+    MemoryStage(const MemoryStage &) = delete;
+    MemoryStage& operator=(const MemoryStage &) = delete;
+
+private:
+    MemoryTracker &tracker_;
+    StageMemory stage_;
+};
+
+} // namespace ml
@@ -0,0 +1,237 @@
+#include <algorithm>
+#include <limits>
+#include <set>
+
+#include "metrics.h"
+
+
+namespace ml {
+    const char *const PROMETHEUS_PREFIX = "mnist_svm_";
+
+    Histogram::Histogram()
+        :counts_(GetBounds().size() + 1, 0),
+         count_(0),
+         sum_(0),
+         min_(std::numeric_limits<double>::infinity()),
+         max_(-std::numeric_limits<double>::infinity()) {}
+
+    const std::vector<double>& Histogram::GetBounds() {
+        // covers microseconds to days and single to millions of iterations
+        static const std::vector<double> bounds = {
+            1e-6, 1e-5, 1e-4, 1e-3, 1e-2, 1e-1, 1, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6
+        };
+        return bounds;
+    }
+
+    void Histogram::Observe(double value) {
+        auto &bounds = GetBounds();
+        size_t bucket = std::lower_bound(bounds.begin(), bounds.end(), value) - bounds.begin();
+        ++counts_[bucket];
+        ++count_;
+        sum_ += value;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    size_t Histogram::GetCount() const {
+        return count_;
+    }
+
+    double Histogram::GetSum() const {
+        return sum_;
+    }
+
+    double Histogram::GetMin() const {
+        return count_ == 0 ? 0 : min_;
+    }
+
+    double Histogram::GetMax() const {
+        return count_ == 0 ? 0 : max_;
+    }
+
+    double Histogram::GetMean() const {
+        return count_ == 0 ? 0 : sum_ / count_;
+    }
+
+    std::vector<size_t> Histogram::GetCumulativeCounts() const {
+        std::vector<size_t> result(counts_.size());
+        size_t total = 0;
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            total += counts_[i];
+            result[i] = total;
+        }
+        return result;
+    }
+
+    void Metrics::Increment(const std::string &name, double value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        counters_[name] += value;
+    }
+
+    void Metrics::SetGauge(const std::string &name, double value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        gauges_[name] = value;
+    }
+
+    void Metrics::Observe(const std::string &name, double value) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        histograms_[name].Observe(value);
+    }
+
+    double Metrics::GetCounter(const std::string &name) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = counters_.find(name);
+        return it == counters_.end() ? 0 : it->second;
+    }
+
+    double Metrics::GetGauge(const std::string &name) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = gauges_.find(name);
+        return it == gauges_.end() ? 0 : it->second;
+    }
+
+    Histogram Metrics::GetHistogram(const std::string &name) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = histograms_.find(name);
+        return it == histograms_.end() ? Histogram() : it->second;
+    }
+
+    void Metrics::Reset() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        counters_.clear();
+        gauges_.clear();
+        histograms_.clear();
+    }
+
+    std::string EscapeJson(const std::string &value) {
+        std::string result;
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result;
+    }
+
+    void WriteJsonValues(std::ostream &output, const std::map<std::string, double> &values) {
+        output << "{";
+        const char *separator = "\n";
+        for (auto &value : values) {
+            output << separator << "    \"" << EscapeJson(value.first) << "\": " << value.second;
+            separator = ",\n";
+        }
+        output << (values.empty() ? "}" : "\n  }");
+    }
+
+    void Metrics::WriteJson(std::ostream &output) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto precision = output.precision(9);
+
+        output << "{\n  \"counters\": ";
+        WriteJsonValues(output, counters_);
+        output << ",\n  \"gauges\": ";
+        WriteJsonValues(output, gauges_);
+
+        output << ",\n  \"histograms\": {";
+        const char *separator = "\n";
+        for (auto &item : histograms_) {
+            auto &histogram = item.second;
+            output << separator << "    \"" << EscapeJson(item.first) << "\": {";
+            output << "\"count\": " << histogram.GetCount();
+            output << ", \"sum\": " << histogram.GetSum();
+            output << ", \"min\": " << histogram.GetMin();
+            output << ", \"max\": " << histogram.GetMax();
+            output << ", \"mean\": " << histogram.GetMean() << "}";
+            separator = ",\n";
+        }
+        output << (histograms_.empty() ? "}" : "\n  }");
+
+        // items per second of every timed phase that counted its items
+        std::map<std::string, double> throughput;
+        const std::string suffix = "_items";
+        for (auto &counter : counters_) {
+            auto &name = counter.first;
+            if (name.size() <= suffix.size() ||
+                name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+                continue;
+            }
+            std::string phase = name.substr(0, name.size() - suffix.size());
+            auto it = histograms_.find(phase + "_seconds");
+            if (it != histograms_.end() && it->second.GetSum() > 0) {
+                throughput[phase + "_items_per_second"] = counter.second / it->second.GetSum();
+            }
+        }
+        output << ",\n  \"throughput\": ";
+        WriteJsonValues(output, throughput);
+        output << "\n}\n";
+
+        output.precision(precision);
+    }
+
+    // name without its label set
+    std::string GetBaseName(const std::string &name) {
+        return name.substr(0, name.find('{'));
+    }
+
+    void Metrics::WritePrometheus(std::ostream &output) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto precision = output.precision(9);
+
+        for (auto &counter : counters_) {
+            std::string name = PROMETHEUS_PREFIX + counter.first + "_total";
+            output << "# TYPE " << name << " counter\n";
+            output << name << " " << counter.second << "\n";
+        }
+
+        std::set<std::string> typed;
+        for (auto &gauge : gauges_) {
+            std::string base = GetBaseName(gauge.first);
+            if (typed.insert(base).second) {
+                output << "# TYPE " << PROMETHEUS_PREFIX << base << " gauge\n";
+            }
+            output << PROMETHEUS_PREFIX << gauge.first << " " << gauge.second << "\n";
+        }
+
+        auto &bounds = Histogram::GetBounds();
+        for (auto &item : histograms_) {
+            std::string name = PROMETHEUS_PREFIX + item.first;
+            auto counts = item.second.GetCumulativeCounts();
+            output << "# TYPE " << name << " histogram\n";
+            for (size_t i = 0; i < bounds.size(); ++i) {
+                output << name << "_bucket{le=\"" << bounds[i] << "\"} " << counts[i] << "\n";
+            }
+            output << name << "_bucket{le=\"+Inf\"} " << counts.back() << "\n";
+            output << name << "_sum " << item.second.GetSum() << "\n";
+            output << name << "_count " << item.second.GetCount() << "\n";
+        }
+
+        output.precision(precision);
+    }
+
+    Metrics& GetMetrics() {
+        static Metrics metrics;
+        return metrics;
+    }
+
+    ScopedTimer::ScopedTimer(const std::string &name, Metrics &metrics)
+        :name_(name),
+         metrics_(metrics),
+         start_(std::chrono::steady_clock::now()),
+         nb_items_(0) {}
+
+    ScopedTimer::~ScopedTimer() {
+        metrics_.Observe(name_ + "_seconds", GetSeconds());
+        if (nb_items_ > 0) {
+            metrics_.Increment(name_ + "_items", nb_items_);
+        }
+    }
+
+    void ScopedTimer::SetNumItems(size_t nb_items) {
+        nb_items_ = nb_items;
+    }
+
+    double ScopedTimer::GetSeconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+} // namespace ml
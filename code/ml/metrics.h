@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace ml {
+
+/**
+ * Count, sum and extremes of observed values together with cumulative
+ * counts over power of ten buckets, the layout of a Prometheus histogram.
+ */
+class Histogram {
+public:
+    Histogram();
+
+    void Observe(double value);
+
+    size_t GetCount() const;
+    double GetSum() const;
+    double GetMin() const;
+    double GetMax() const;
+    double GetMean() const;
+
+    // upper bounds, the last bucket is unbounded
+    static const std::vector<double>& GetBounds();
+    // number of observations not greater than the bound of every bucket
+    std::vector<size_t> GetCumulativeCounts() const;
+
+private:
+    std::vector<size_t> counts_;
+    size_t count_;
+    double sum_;
+    double min_;
+    double max_;
+};
+
+/**
+ * Thread safe registry of named counters, gauges and histograms.
+ * Meant for phase level events, not for per sample hot loops.
+ * Gauge names may carry Prometheus labels, e.g. name{first="1",second="7"}.
+ */
+class Metrics {
+public:
+    void Increment(const std::string &name, double value = 1);
+    void SetGauge(const std::string &name, double value);
+    void Observe(const std::string &name, double value);
+
+    double GetCounter(const std::string &name) const;
+    double GetGauge(const std::string &name) const;
+    // empty histogram if nothing was observed under name
+    Histogram GetHistogram(const std::string &name) const;
+
+    void Reset();
+
+    void WriteJson(std::ostream &output) const;
+    // text exposition format, every name is prefixed with mnist_svm_
+    void WritePrometheus(std::ostream &output) const;
+
+private:
+    mutable std::mutex mutex_;
+    std::map<std::string, double> counters_;
+    std::map<std::string, double> gauges_;
+    std::map<std::string, Histogram> histograms_;
+};
+
+// registry all library phases report to
+Metrics& GetMetrics();
+
+/**
+ * Observes the lifetime of the scope in seconds under name_seconds
+ * and, if nb_items is set, counts processed items under name_items.
+ */
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const std::string &name, Metrics &metrics = GetMetrics());
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer& operator=(const ScopedTimer &) = delete;
+
+    void SetNumItems(size_t nb_items);
+
+    double GetSeconds() const;
+
+private:
+    std::string name_;
+    Metrics &metrics_;
+    std::chrono::steady_clock::time_point start_;
+    size_t nb_items_;
+};
+
+} // namespace ml
@@ -0,0 +1,195 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "exception.h"
+#include "metrics.h"
+#include "model_watcher.h"
+#include "predictor.h"
+
+
+namespace ml {
+    const uint8_t WARM_UP_PIXELS[] = {0, 128, 255};
+
+    std::vector<std::string> GetModelPaths(const std::string &model_path, bool preprocessed) {
+        std::vector<std::string> paths = {model_path + ".svm"};
+        if (preprocessed) {
+            paths.push_back(model_path + ".pca");
+            paths.push_back(model_path + ".norm");
+        }
+        return paths;
+    }
+
+    // scores a few constant images, touching every weight once
+    void WarmUp(const Predictor &predictor) {
+        const auto &labels = predictor.GetLabels();
+        std::vector<uint8_t> image(predictor.GetInputDim());
+        for (uint8_t pixel : WARM_UP_PIXELS) {
+            std::fill(image.begin(), image.end(), pixel);
+            int label = predictor.PredictOne(image.data());
+            if (std::find(labels.begin(), labels.end(), label) == labels.end()) {
+                throw Exception("warm-up prediction " + std::to_string(label) + " is not a model label");
+            }
+        }
+    }
+
+    ModelWatcher::ModelWatcher(const std::string &model_path,
+                               bool preprocessed,
+                               std::chrono::milliseconds poll_interval)
+    :ModelWatcher(GetModelPaths(model_path, preprocessed),
+                  [model_path, preprocessed]() { return LoadPredictor(model_path, preprocessed); },
+                  poll_interval) {}
+
+    ModelWatcher::ModelWatcher(const std::vector<std::string> &watched_paths,
+                               const Loader &loader,
+                               std::chrono::milliseconds poll_interval)
+    :watched_paths_(watched_paths), loader_(loader), poll_interval_(poll_interval), stop_(true) {
+        // there is nothing to fall back to, so the first load has to succeed
+        if (!ReadSignature(signature_)) {
+            throw Exception("model files are missing");
+        }
+        Reload(signature_);
+        if (!predictor_) {
+            throw Exception("can't load model: " + stats_.last_error);
+        }
+    }
+
+    ModelWatcher::~ModelWatcher() {
+        Stop();
+    }
+
+    SharedPredictor ModelWatcher::Get() const {
+        return std::atomic_load(&predictor_);
+    }
+
+    bool ModelWatcher::ReadSignature(Signature &signature) const {
+        signature.clear();
+        for (auto &path : watched_paths_) {
+            struct stat info;
+            if (stat(path.c_str(), &info) != 0) {
+                return false;
+            }
+            long long mtime = info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+            signature.emplace_back(mtime, info.st_size);
+        }
+        return true;
+    }
+
+    void ModelWatcher::Reload(const Signature &signature) {
+        auto start = std::chrono::steady_clock::now();
+        SharedPredictor current = Get();
+        SharedPredictor loaded;
+        std::string error;
+        try {
+            loaded = loader_();
+            if (!loaded) {
+                throw Exception("loader returned no model");
+            }
+            if (current && current->GetInputDim() != loaded->GetInputDim()) {
+                throw Exception(
+                    "input dimensionality changed from " + std::to_string(current->GetInputDim()) +
+                    " to " + std::to_string(loaded->GetInputDim())
+                );
+            }
+            WarmUp(*loaded);
+
+            // files were rewritten while loading, the next poll picks them up
+            Signature after;
+            if (!ReadSignature(after) || after != signature) {
+                throw Exception("model files changed during reload");
+            }
+        } catch (const std::exception &e) {
+            loaded.reset();
+            error = e.what();
+        }
+        double ms = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+
+        // in-flight callers keep their reference to the previous model
+        if (loaded) {
+            std::atomic_store(&predictor_, loaded);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        signature_ = signature;
+        Metrics &metrics = GetMetrics();
+        if (loaded) {
+            metrics.Increment("model_reloads");
+            metrics.Observe("model_reload_seconds", ms / 1000);
+            ++stats_.nb_reloads;
+            stats_.last_reload_ms = ms;
+        } else {
+            metrics.Increment("model_failed_reloads");
+            ++stats_.nb_failed_reloads;
+            stats_.last_error = error;
+        }
+    }
+
+    bool ModelWatcher::Poll() {
+        std::lock_guard<std::mutex> poll_lock(poll_mutex_);
+        Signature signature;
+        if (!ReadSignature(signature)) {
+            // a file is being replaced right now
+            return false;
+        }
+
+        size_t nb_reloads = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (signature == signature_) {
+                return false;
+            }
+            nb_reloads = stats_.nb_reloads;
+        }
+
+        Reload(signature);
+        return GetStats().nb_reloads > nb_reloads;
+    }
+
+    void ModelWatcher::Start() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!stop_) {
+            return;
+        }
+        stop_ = false;
+        thread_ = std::thread(&ModelWatcher::WatchLoop, this);
+    }
+
+    void ModelWatcher::Stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        stop_requested_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    void ModelWatcher::WatchLoop() {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                stop_requested_.wait_for(lock, poll_interval_, [this]() { return stop_; });
+                if (stop_) {
+                    return;
+                }
+            }
+            Poll();
+        }
+    }
+
+    ReloadStats ModelWatcher::GetStats() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+} // namespace ml
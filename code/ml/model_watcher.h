@@ -0,0 +1,83 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "predictor.h"
+
+
+namespace ml {
+
+struct ReloadStats {
+    size_t nb_reloads = 0;
+    size_t nb_failed_reloads = 0;
+    // load, validation and warm-up of the last swapped in model
+    double last_reload_ms = 0;
+    std::string last_error;
+};
+
+/**
+ * Keeps the current predictor of a long running process and replaces it
+ * when the model files change on disk. New models are loaded, validated
+ * and warmed up on the watcher thread, then swapped in atomically.
+ * Callers holding a predictor returned by Get keep using it until they
+ * drop it, a failed reload leaves the current model in place.
+ */
+class ModelWatcher {
+public:
+    typedef std::function<SharedPredictor()> Loader;
+
+    // watches model_path.svm and, for preprocessed models, .pca and .norm
+    ModelWatcher(const std::string &model_path,
+                 bool preprocessed,
+                 std::chrono::milliseconds poll_interval = std::chrono::milliseconds(1000));
+
+    ModelWatcher(const std::vector<std::string> &watched_paths,
+                 const Loader &loader,
+                 std::chrono::milliseconds poll_interval = std::chrono::milliseconds(1000));
+
+    ~ModelWatcher();
+
+    ModelWatcher(const ModelWatcher &) = delete;
+    ModelWatcher& operator=(const ModelWatcher &) = delete;
+
+    SharedPredictor Get() const;
+
+    // checks the files once, returns true if a new model was swapped in
+    bool Poll();
+
+    // polls on a background thread until Stop or destruction
+    void Start();
+    void Stop();
+
+    ReloadStats GetStats() const;
+
+private:
+    typedef std::vector<std::pair<long long, long long>> Signature;
+
+    bool ReadSignature(Signature &signature) const;
+    void Reload(const Signature &signature);
+    void WatchLoop();
+
+    std::vector<std::string> watched_paths_;
+    Loader loader_;
+    std::chrono::milliseconds poll_interval_;
+
+    SharedPredictor predictor_;
+    Signature signature_;
+
+    std::mutex poll_mutex_;
+    mutable std::mutex mutex_;
+    std::condition_variable stop_requested_;
+    bool stop_;
+    std::thread thread_;
+    ReloadStats stats_;
+};
+
+} // namespace ml
@@ -1,24 +1,32 @@
 #include <vector>
 #include <algorithm>
-#include <unordered_map>
-#include <iostream>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <random>
+#include <string>
 
 #include "multiclass_svm.h"
 #include "exception.h"
 #include "binary_svm.h"
+#include "class_index.h"
+#include "parallel.h"
 #include "util.h"
+#include "kernels.h"
+#include "logger.h"
+#include "memory.h"
+#include "metrics.h"
+#include "voting.h"
 
 
 namespace ml {
     typedef std::vector<std::vector<double>> matrix;
 
-    std::vector<int> GetUniqueLabels(const std::vector<int> &y) {
-        std::vector<int> labels(y);
-        std::sort(labels.begin(), labels.end());
-        auto it = std::unique(labels.begin(), labels.end());
-        labels.resize(std::distance(labels.begin(), it));
-        return labels;
-    }
+    const size_t VOTING_MIN_CHUNK_SIZE = 256;
+    const size_t VOTING_BLOCK_SIZE = 16;
+    const size_t HARD_EXAMPLES_MIN_CHUNK_SIZE = 256;
+    // pair k is subsampled with seed SUBSAMPLE_SEED + k
+    const unsigned SUBSAMPLE_SEED = 0;
 
     MulticlassSVM:: MulticlassSVM(const matrix &models, 
                                   const std::vector<double> &biases,
@@ -49,43 +57,195 @@ namespace ml {
                               double lambda,
                               double bias_multiplier,
                               double epsilon) {
+        TrainOptions options;
+        options.lambda = lambda;
+        options.bias_multiplier = bias_multiplier;
+        options.epsilon = epsilon;
+        Train(x, y, options);
+    }
+
+    std::vector<size_t> StratifiedSample(const std::vector<int> &y, double fraction, unsigned seed) {
+        std::map<int, std::vector<size_t>> positions;
+        for (size_t k = 0; k < y.size(); ++k) {
+            positions[y[k]].push_back(k);
+        }
+
+        std::mt19937 random(seed);
+        std::vector<size_t> sample;
+        for (auto &label : positions) {
+            auto &candidates = label.second;
+            size_t nb_taken = std::round(fraction * candidates.size());
+            nb_taken = std::min(std::max<size_t>(nb_taken, 1), candidates.size());
+            // first nb_taken steps of a Fisher-Yates shuffle
+            for (size_t k = 0; k < nb_taken; ++k) {
+                std::uniform_int_distribution<size_t> pick(k, candidates.size() - 1);
+                std::swap(candidates[k], candidates[pick(random)]);
+            }
+            sample.insert(sample.end(), candidates.begin(), candidates.begin() + nb_taken);
+        }
+        std::sort(sample.begin(), sample.end());
+        return sample;
+    }
+
+    // weights of the pair rows, empty if they are all 1
+    std::vector<double> GetPairWeights(const std::vector<size_t> &rows,
+                                       const std::vector<int> &sub_y,
+                                       const std::vector<double> &weights,
+                                       bool balance_classes) {
+        if (weights.empty() && !balance_classes) {
+            return {};
+        }
+
+        size_t nb_positive = std::count(sub_y.begin(), sub_y.end(), 1);
+        size_t nb_negative = sub_y.size() - nb_positive;
+        std::vector<double> pair_weights(rows.size(), 1);
+        for (size_t k = 0; k < rows.size(); ++k) {
+            if (balance_classes) {
+                size_t nb_label = sub_y[k] == 1 ? nb_positive : nb_negative;
+                pair_weights[k] = static_cast<double>(rows.size()) / (2 * nb_label);
+            }
+            if (!weights.empty()) {
+                pair_weights[k] *= weights[rows[k]];
+            }
+        }
+        return pair_weights;
+    }
+
+    // at most nb_max positions outside of the sample which the model gets wrong
+    // or puts inside the margin, lowest margins first
+    std::vector<size_t> FindHardExamples(const matrix &x,
+                                         const std::vector<size_t> &rows,
+                                         const std::vector<int> &sub_y,
+                                         const std::vector<size_t> &sample,
+                                         const BinarySVM &svm,
+                                         size_t nb_max) {
+        const double inf = std::numeric_limits<double>::infinity();
+        std::vector<double> margins(rows.size(), 0);
+        for (auto k : sample) {
+            margins[k] = inf;
+        }
+
+        auto &model = svm.GetModel();
+        const size_t nb_dim = model.size();
+        DotProductKernel dot = GetDotProductKernel(nb_dim);
+        ParallelFor(rows.size(), HARD_EXAMPLES_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t) {
+            for (size_t k = begin; k < end; ++k) {
+                if (margins[k] != inf) {
+                    double score = dot(x[rows[k]].data(), model.data(), nb_dim) + svm.GetBias();
+                    margins[k] = sub_y[k] * score;
+                }
+            }
+        });
+
+        std::vector<size_t> hard;
+        for (size_t k = 0; k < rows.size(); ++k) {
+            if (margins[k] < 1) {
+                hard.push_back(k);
+            }
+        }
+        if (hard.size() > nb_max) {
+            std::nth_element(hard.begin(), hard.begin() + nb_max, hard.end(),
+                             [&](size_t a, size_t b) { return margins[a] < margins[b]; });
+            hard.resize(nb_max);
+        }
+        std::sort(hard.begin(), hard.end());
+        return hard;
+    }
+
+    void MulticlassSVM::Train(const matrix &x,
+                              const std::vector<int> &y,
+                              const TrainOptions &options,
+                              const std::vector<double> &weights) {
         ValidateTrainData(x, y, false);
+        if (!weights.empty() && weights.size() != x.size()) {
+            throw Exception("x weights have different size");
+        }
+        if (!(options.subsample > 0 && options.subsample <= 1)) {
+            throw Exception("subsample has to be in (0, 1]");
+        }
 
         // clear data
         models_.clear();
         biases_.clear();
-        labels_ = GetUniqueLabels(y);
-        std::cout << "number of unqiue labels " << labels_.size() << std::endl;
+        // every pair takes the rows of its two labels from the index instead of scanning y
+        ClassIndex index(y);
+        labels_ = index.GetLabels();
+        Log(LogLevel::Info) << "number of unqiue labels " << labels_.size();
 
+        size_t pair_index = 0;
         for (size_t i = 0; i < labels_.size(); ++i) {
-            for (size_t j = i + 1; j < labels_.size(); ++j) {
-                // info
-                std::cout << "start svm training one vs one for labels "; 
-                std::cout << labels_[i] << " " << labels_[j] << std::endl;
-
-                matrix sub_x;
-                std::vector<int> sub_y;
-                for (size_t k = 0; k < x.size(); ++k) {
-                    if (y[k] == labels_[i]) {
-                        sub_x.push_back(x[k]);
-                        sub_y.push_back(-1);
+            for (size_t j = i + 1; j < labels_.size(); ++j, ++pair_index) {
+                Log(LogLevel::Info) << "start svm training one vs one for labels "
+                                    << labels_[i] << " " << labels_[j];
+
+                // rows of the first label are -1, rows of the second one 1
+                std::vector<size_t> rows = index.GetPairRows(i, j);
+                std::vector<int> sub_y(rows.size(), 1);
+                std::fill(sub_y.begin(), sub_y.begin() + index.GetSize(i), -1);
+                auto sub_weights = GetPairWeights(rows, sub_y, weights, options.balance_classes);
+
+                BinarySVM svm;
+                // a sampled row stands for 1 / subsample rows of its label, a hard example for itself,
+                // scale brings the weights back to an average of about 1 over the trained rows
+                auto train_on = [&](const std::vector<size_t> &sample, const std::vector<size_t> &hard) {
+                    std::vector<size_t> positions(sample);
+                    positions.insert(positions.end(), hard.begin(), hard.end());
+                    double scale = static_cast<double>(positions.size()) / rows.size();
+
+                    std::vector<size_t> sample_rows;
+                    std::vector<int> sample_y;
+                    std::vector<double> sample_weights;
+                    for (size_t p = 0; p < positions.size(); ++p) {
+                        size_t k = positions[p];
+                        sample_rows.push_back(rows[k]);
+                        sample_y.push_back(sub_y[k]);
+                        double weight = sub_weights.empty() ? 1 : sub_weights[k];
+                        sample_weights.push_back(scale * weight / (p < sample.size() ? options.subsample : 1));
                     }
+                    svm.Train(x, sample_rows, sample_y, options, sample_weights);
+                };
 
-                    if (y[k] == labels_[j]) {
-                        sub_x.push_back(x[k]);
-                        sub_y.push_back(1);
+                size_t nb_rows = rows.size();
+                size_t nb_hard = 0;
+                if (options.subsample < 1) {
+                    auto sample = StratifiedSample(sub_y, options.subsample, SUBSAMPLE_SEED + pair_index);
+                    train_on(sample, {});
+                    if (options.remine_hard_examples) {
+                        // no more hard examples than sampled rows, the sample keeps its share
+                        auto hard = FindHardExamples(x, rows, sub_y, sample, svm, sample.size());
+                        nb_hard = hard.size();
+                        if (!hard.empty()) {
+                            train_on(sample, hard);
+                        }
                     }
+                    nb_rows = sample.size() + nb_hard;
+                    Log(LogLevel::Info) << "trained on " << nb_rows << " of " << rows.size()
+                                        << " rows, " << nb_hard << " hard examples";
+                } else {
+                    svm.Train(x, rows, sub_y, options, sub_weights);
                 }
 
-                BinarySVM svm;
-                svm.Train(sub_x, sub_y, lambda, bias_multiplier, epsilon);
+                auto &statistics = svm.GetTrainStatistics();
+                std::string pair = "{first=\"" + std::to_string(labels_[i]) +
+                                   "\",second=\"" + std::to_string(labels_[j]) + "\"}";
+                Metrics &metrics = GetMetrics();
+                metrics.SetGauge("svm_pair_train_seconds" + pair, statistics.seconds);
+                metrics.SetGauge("svm_pair_iterations" + pair, statistics.nb_iterations);
+                metrics.SetGauge("svm_pair_objective" + pair, statistics.objective);
+                metrics.SetGauge("svm_pair_rows" + pair, nb_rows);
+                if (options.remine_hard_examples) {
+                    metrics.SetGauge("svm_pair_hard_examples" + pair, nb_hard);
+                }
+                if (options.solver == SolverType::Sdca || options.solver == SolverType::Dcd) {
+                    metrics.SetGauge("svm_pair_duality_gap" + pair, statistics.duality_gap);
+                }
                 models_.push_back(svm.GetModel());
                 biases_.push_back(svm.GetBias());
             }
         }
     }
 
-    std::vector<int> MulticlassSVM::Predict(const matrix &x) {
+    std::vector<int> MulticlassSVM::Predict(const matrix &x) const {
         if (x.empty()) {
             return {};
         }
@@ -93,37 +253,46 @@ namespace ml {
         if (models_.empty()) {
             throw Exception("there are no models");
         }
+        ScopedTimer timer("multiclass_svm_predict");
+        timer.SetNumItems(x.size());
 
-        // using majority voting 
-        size_t idx = 0;
-        std::vector<std::vector<int>> raw_predictions;
-        for (size_t i = 0; i < labels_.size(); ++i) {
-            for (size_t j = i + 1; j < labels_.size(); ++j) {
-                BinarySVM svm(models_[idx], biases_[idx]);
-                std::vector<int> sub_predictions = svm.Predict(x);
-                std::vector<int> raw_prediction;
-                for (auto prediction : sub_predictions) {
-                    raw_prediction.push_back(prediction == -1 ? labels_[i] : labels_[j]);
+        const size_t nb_dim = models_[0].size();
+        const size_t nb_models = models_.size();
+        DotProductKernel dot = GetDotProductKernel(nb_dim);
+
+        // samples are scored in small blocks so every model row is reused
+        // from cache, then voted on right away
+        std::vector<int> predictions(x.size());
+        ParallelFor(x.size(), VOTING_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t) {
+            std::vector<double> scores(VOTING_BLOCK_SIZE * nb_models);
+            VoteAccumulator votes(labels_.size());
+            for (size_t block = begin; block < end; block += VOTING_BLOCK_SIZE) {
+                size_t block_end = std::min(end, block + VOTING_BLOCK_SIZE);
+                for (size_t k = block; k < block_end; ++k) {
+                    ValidateDimensions(nb_dim, x[k].size(), k);
                 }
-                raw_predictions.push_back(raw_prediction);
-                ++idx;
-            }
-        }
 
-        std::vector<int> predictions;
-        for (size_t i = 0; i < x.size(); ++i) {
-            std::unordered_map<int, int> dict;
-            int commonest;
-            int maxcount = 0;
-            for (auto &raw_prediction : raw_predictions) {
-                if (++dict[raw_prediction[i]] > maxcount) {
-                    commonest = raw_prediction[i];
-                    maxcount = dict[raw_prediction[i]];
+                for (size_t idx = 0; idx < nb_models; ++idx) {
+                    const double *model = models_[idx].data();
+                    for (size_t k = block; k < block_end; ++k) {
+                        scores[(k - block) * nb_models + idx] =
+                            dot(model, x[k].data(), nb_dim) + biases_[idx];
+                    }
                 }
-            }
 
-            predictions.push_back(commonest);
-        }
+                for (size_t k = block; k < block_end; ++k) {
+                    const double *score = &scores[(k - block) * nb_models];
+                    votes.Reset();
+                    size_t idx = 0;
+                    for (size_t i = 0; i < labels_.size(); ++i) {
+                        for (size_t j = i + 1; j < labels_.size(); ++j) {
+                            votes.Add(i, j, score[idx++]);
+                        }
+                    }
+                    predictions[k] = labels_[votes.GetWinner()];
+                }
+            }
+        });
 
         return predictions;
     }
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <cstddef>
 #include <vector>
 
+#include "binary_svm.h"
+
 
 namespace ml {
 
@@ -25,7 +28,14 @@ public:
                double bias_multiplier = 1,
                double epsilon = 0.02); 
 
-    std::vector<int> Predict(const std::vector<std::vector<double>> &x);
+    // rows are weighted by weights unless they are empty, see TrainOptions for pair sampling
+    void Train(const std::vector<std::vector<double>> &x,
+               const std::vector<int> &y,
+               const TrainOptions &options,
+               const std::vector<double> &weights = std::vector<double>());
+
+    // majority voting, ties go to the label with the largest sum of margins
+    std::vector<int> Predict(const std::vector<std::vector<double>> &x) const;
 
 private:
     std::vector<std::vector<double>> models_;
@@ -33,5 +43,8 @@ private:
     std::vector<int> labels_;
 };
 
+// random fraction of the positions of every label, at least one per label, in increasing order
+std::vector<size_t> StratifiedSample(const std::vector<int> &y, double fraction, unsigned seed);
+
 } // namespace ml
 
@@ -0,0 +1,47 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "parallel.h"
+#include "thread_pool.h"
+
+
+namespace ml {
+    std::atomic<size_t> nb_threads_override(0);
+
+    size_t GetNumThreads() {
+        size_t nb_threads = nb_threads_override.load();
+        if (nb_threads == 0) {
+            nb_threads = std::thread::hardware_concurrency();
+        }
+        return std::max<size_t>(nb_threads, 1);
+    }
+
+    void SetNumThreads(size_t nb_threads) {
+        nb_threads_override.store(nb_threads);
+    }
+
+    size_t GetNumChunks(size_t nb_items, size_t min_chunk_size) {
+        min_chunk_size = std::max<size_t>(min_chunk_size, 1);
+        size_t max_chunks = (nb_items + min_chunk_size - 1) / min_chunk_size;
+        return std::max<size_t>(std::min(GetNumThreads(), max_chunks), 1);
+    }
+
+    void ParallelFor(size_t nb_items,
+                     size_t min_chunk_size,
+                     const std::function<void(size_t, size_t, size_t)> &fn) {
+        size_t nb_chunks = GetNumChunks(nb_items, min_chunk_size);
+        size_t chunk_size = nb_items / nb_chunks;
+        size_t remainder = nb_items % nb_chunks;
+
+        auto chunk_begin = [&](size_t chunk) {
+            return chunk * chunk_size + std::min(chunk, remainder);
+        };
+
+        // chunks run on the shared pool, the calling thread takes part
+        GetSharedThreadPool().Run(nb_chunks, [&](size_t chunk) {
+            fn(chunk_begin(chunk), chunk_begin(chunk + 1), chunk);
+        });
+    }
+} // namespace ml
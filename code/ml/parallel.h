@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+
+namespace ml {
+
+    /**
+     * Number of worker threads used by parallel algorithms,
+     * defaults to the number of hardware threads.
+     */
+    size_t GetNumThreads();
+
+    // 0 restores the default
+    void SetNumThreads(size_t nb_threads);
+
+    // number of chunks ParallelFor will split nb_items into
+    size_t GetNumChunks(size_t nb_items, size_t min_chunk_size = 1);
+
+    /**
+     * Splits [0, nb_items) into GetNumChunks contiguous chunks and calls
+     * fn(begin, end, chunk_idx) for each of them concurrently on the shared pool.
+     * Chunk boundaries only depend on nb_items and the number of threads,
+     * so reductions over per-chunk results are deterministic.
+     */
+    void ParallelFor(size_t nb_items,
+                     size_t min_chunk_size,
+                     const std::function<void(size_t, size_t, size_t)> &fn);
+
+} // namespace ml
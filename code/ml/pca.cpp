@@ -0,0 +1,456 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "exception.h"
+#include "metrics.h"
+#include "parallel.h"
+#include "pca.h"
+#include "util.h"
+
+
+namespace ml {
+    typedef std::vector<std::vector<double>> matrix;
+
+    // rows are packed into blocks of this size before updating covariance,
+    // so the d x d accumulator is streamed once per block instead of once per row
+    const size_t PCA_BLOCK_SIZE = 64;
+    const size_t PCA_MIN_CHUNK_SIZE = 256;
+
+    CovarianceAccumulator::CovarianceAccumulator(size_t nb_dim)
+        :nb_dim_(nb_dim), count_(0), mean_(nb_dim, 0), m2_(nb_dim * nb_dim, 0) {}
+
+    size_t CovarianceAccumulator::GetCount() const {
+        return count_;
+    }
+
+    size_t CovarianceAccumulator::GetDim() const {
+        return nb_dim_;
+    }
+
+    const std::vector<double>& CovarianceAccumulator::GetMean() const {
+        return mean_;
+    }
+
+    void CovarianceAccumulator::Add(const double *rows, size_t nb_rows) {
+        if (nb_rows == 0) {
+            return;
+        }
+
+        const size_t d = nb_dim_;
+        std::vector<double> block_mean(d, 0);
+        for (size_t r = 0; r < nb_rows; ++r) {
+            const double *row = rows + r * d;
+            for (size_t j = 0; j < d; ++j) {
+                block_mean[j] += row[j];
+            }
+        }
+        for (size_t j = 0; j < d; ++j) {
+            block_mean[j] /= nb_rows;
+        }
+
+        std::vector<double> centered(nb_rows * d);
+        for (size_t r = 0; r < nb_rows; ++r) {
+            for (size_t j = 0; j < d; ++j) {
+                centered[r * d + j] = rows[r * d + j] - block_mean[j];
+            }
+        }
+
+        // pairwise update of Chan et al.: M2 = M2a + M2b + delta delta^T na nb / n
+        double na = count_;
+        double nb = nb_rows;
+        double coef = na * nb / (na + nb);
+        std::vector<double> delta(d);
+        for (size_t j = 0; j < d; ++j) {
+            delta[j] = block_mean[j] - mean_[j];
+        }
+
+        for (size_t j = 0; j < d; ++j) {
+            double *m2_row = &m2_[j * d];
+            for (size_t r = 0; r < nb_rows; ++r) {
+                const double *c = &centered[r * d];
+                const double cj = c[j];
+                for (size_t k = j; k < d; ++k) {
+                    m2_row[k] += cj * c[k];
+                }
+            }
+
+            const double dj = delta[j] * coef;
+            for (size_t k = j; k < d; ++k) {
+                m2_row[k] += dj * delta[k];
+            }
+        }
+
+        for (size_t j = 0; j < d; ++j) {
+            mean_[j] += delta[j] * nb / (na + nb);
+        }
+        count_ += nb_rows;
+    }
+
+    void CovarianceAccumulator::Add(const matrix &x, size_t begin, size_t end) {
+        std::vector<double> block(PCA_BLOCK_SIZE * nb_dim_);
+        for (size_t i = begin; i < end; i += PCA_BLOCK_SIZE) {
+            size_t nb_rows = std::min(PCA_BLOCK_SIZE, end - i);
+            for (size_t r = 0; r < nb_rows; ++r) {
+                ValidateDimensions(nb_dim_, x[i + r].size(), i + r);
+                std::copy(x[i + r].begin(), x[i + r].end(), block.begin() + r * nb_dim_);
+            }
+            Add(block.data(), nb_rows);
+        }
+    }
+
+    void CovarianceAccumulator::Merge(const CovarianceAccumulator &other) {
+        if (other.count_ == 0) {
+            return;
+        }
+
+        if (count_ == 0) {
+            *this = other;
+            return;
+        }
+
+        ValidateDimensions(nb_dim_, other.nb_dim_);
+
+        const size_t d = nb_dim_;
+        double na = count_;
+        double nb = other.count_;
+        double coef = na * nb / (na + nb);
+        for (size_t j = 0; j < d; ++j) {
+            const double dj = other.mean_[j] - mean_[j];
+            for (size_t k = j; k < d; ++k) {
+                const double dk = other.mean_[k] - mean_[k];
+                m2_[j * d + k] += other.m2_[j * d + k] + dj * dk * coef;
+            }
+        }
+
+        for (size_t j = 0; j < d; ++j) {
+            mean_[j] += (other.mean_[j] - mean_[j]) * nb / (na + nb);
+        }
+        count_ += other.count_;
+    }
+
+    cv::Mat CovarianceAccumulator::GetCovariance() const {
+        cv::Mat covariance(nb_dim_, nb_dim_, CV_64FC1);
+        double scale = count_ > 0 ? 1.0 / count_ : 0;
+        for (size_t j = 0; j < nb_dim_; ++j) {
+            for (size_t k = j; k < nb_dim_; ++k) {
+                double value = m2_[j * nb_dim_ + k] * scale;
+                covariance.at<double>(j, k) = value;
+                covariance.at<double>(k, j) = value;
+            }
+        }
+        return covariance;
+    }
+
+    size_t GetNumComponents(const std::vector<double> &eigenvalues,
+                            double total_variance,
+                            double retain_variance) {
+        double cumulative = 0;
+        size_t nb_components = 0;
+        for (; nb_components < eigenvalues.size(); ++nb_components) {
+            cumulative += eigenvalues[nb_components];
+            if (cumulative / total_variance > retain_variance) {
+                break;
+            }
+        }
+        nb_components = std::max<size_t>(nb_components, 2);
+        return std::min(nb_components, eigenvalues.size());
+    }
+
+    CovarianceAccumulator AccumulateCovariance(const matrix &x) {
+        if (x.empty()) {
+            throw Exception("x is empty");
+        }
+
+        size_t nb_dim = x[0].size();
+        size_t nb_chunks = GetNumChunks(x.size(), PCA_MIN_CHUNK_SIZE);
+        std::vector<CovarianceAccumulator> partial(nb_chunks, CovarianceAccumulator(nb_dim));
+
+        ParallelFor(x.size(), PCA_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t chunk) {
+            partial[chunk].Add(x, begin, end);
+        });
+
+        // merged in chunk order, so result doesn't depend on scheduling
+        for (size_t chunk = 1; chunk < nb_chunks; ++chunk) {
+            partial[0].Merge(partial[chunk]);
+        }
+        return partial[0];
+    }
+
+    cv::PCA MakePCA(const std::vector<double> &mean,
+                    const std::vector<double> &eigenvalues,
+                    const std::vector<std::vector<double>> &eigenvectors,
+                    size_t nb_components) {
+        size_t nb_dim = mean.size();
+        cv::PCA pca;
+        pca.mean = cv::Mat(1, nb_dim, CV_64FC1);
+        for (size_t j = 0; j < nb_dim; ++j) {
+            pca.mean.at<double>(0, j) = mean[j];
+        }
+
+        pca.eigenvalues = cv::Mat(nb_components, 1, CV_64FC1);
+        pca.eigenvectors = cv::Mat(nb_components, nb_dim, CV_64FC1);
+        for (size_t i = 0; i < nb_components; ++i) {
+            pca.eigenvalues.at<double>(i, 0) = eigenvalues[i];
+            for (size_t j = 0; j < nb_dim; ++j) {
+                pca.eigenvectors.at<double>(i, j) = eigenvectors[i][j];
+            }
+        }
+        return pca;
+    }
+
+    cv::PCA PCAFromCovariance(const std::vector<double> &mean,
+                              const cv::Mat &covariance,
+                              double retain_variance) {
+        // only a d x d matrix is decomposed, data itself never reaches opencv
+        cv::Mat values, vectors;
+        cv::eigen(covariance, values, vectors);
+
+        std::vector<double> eigenvalues(values.rows);
+        double total_variance = 0;
+        for (int i = 0; i < values.rows; ++i) {
+            eigenvalues[i] = std::max(values.at<double>(i, 0), 0.0);
+            total_variance += eigenvalues[i];
+        }
+
+        std::vector<std::vector<double>> eigenvectors(
+            vectors.rows, std::vector<double>(vectors.cols));
+        for (int i = 0; i < vectors.rows; ++i) {
+            for (int j = 0; j < vectors.cols; ++j) {
+                eigenvectors[i][j] = vectors.at<double>(i, j);
+            }
+        }
+
+        size_t nb_components = GetNumComponents(eigenvalues, total_variance, retain_variance);
+        return MakePCA(mean, eigenvalues, eigenvectors, nb_components);
+    }
+
+    cv::PCA PCAFromScaledCovariance(const CovarianceAccumulator &accumulator,
+                                    double shift,
+                                    double scale,
+                                    double retain_variance) {
+        if (accumulator.GetCount() == 0) {
+            throw Exception("x is empty");
+        }
+        if (scale == 0) {
+            throw Exception("scale is zero");
+        }
+        ScopedTimer timer("pca_fit");
+        timer.SetNumItems(accumulator.GetCount());
+
+        // eigenvectors don't change, eigenvalues shrink by scale^2
+        std::vector<double> mean(accumulator.GetMean());
+        for (auto &value : mean) {
+            value = (value - shift) / scale;
+        }
+        cv::Mat covariance = accumulator.GetCovariance();
+        for (int j = 0; j < covariance.rows; ++j) {
+            for (int k = 0; k < covariance.cols; ++k) {
+                covariance.at<double>(j, k) /= scale * scale;
+            }
+        }
+        return PCAFromCovariance(mean, covariance, retain_variance);
+    }
+
+    cv::PCA CreateCovariancePCA(const matrix &x, double retain_variance) {
+        auto accumulator = AccumulateCovariance(x);
+        return PCAFromCovariance(accumulator.GetMean(),
+                                 accumulator.GetCovariance(),
+                                 retain_variance);
+    }
+
+    // mean and total variance (trace of covariance) in a single pass
+    void ComputeMeanAndTotalVariance(const matrix &x,
+                                     std::vector<double> &mean,
+                                     double &total_variance) {
+        size_t nb_dim = x[0].size();
+        size_t nb_chunks = GetNumChunks(x.size(), PCA_MIN_CHUNK_SIZE);
+        std::vector<std::vector<double>> sums(nb_chunks, std::vector<double>(nb_dim, 0));
+        std::vector<std::vector<double>> squares(nb_chunks, std::vector<double>(nb_dim, 0));
+
+        // shifted by the first row to keep the sums well conditioned
+        const std::vector<double> &shift = x[0];
+        ParallelFor(x.size(), PCA_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t chunk) {
+            for (size_t i = begin; i < end; ++i) {
+                ValidateDimensions(nb_dim, x[i].size(), i);
+                for (size_t j = 0; j < nb_dim; ++j) {
+                    double value = x[i][j] - shift[j];
+                    sums[chunk][j] += value;
+                    squares[chunk][j] += value * value;
+                }
+            }
+        });
+
+        double nb_data = x.size();
+        mean.assign(nb_dim, 0);
+        total_variance = 0;
+        for (size_t j = 0; j < nb_dim; ++j) {
+            double sum = 0;
+            double square = 0;
+            for (size_t chunk = 0; chunk < nb_chunks; ++chunk) {
+                sum += sums[chunk][j];
+                square += squares[chunk][j];
+            }
+            double shifted_mean = sum / nb_data;
+            mean[j] = shift[j] + shifted_mean;
+            total_variance += std::max(square / nb_data - shifted_mean * shifted_mean, 0.0);
+        }
+    }
+
+    // result = C * basis, C being covariance of x, basis is nb_dim x rank row-major
+    std::vector<double> MultiplyCovariance(const matrix &x,
+                                           const std::vector<double> &mean,
+                                           const std::vector<double> &basis,
+                                           size_t rank) {
+        size_t nb_dim = mean.size();
+        size_t nb_chunks = GetNumChunks(x.size(), PCA_MIN_CHUNK_SIZE);
+        std::vector<std::vector<double>> partial(nb_chunks, std::vector<double>(nb_dim * rank, 0));
+
+        ParallelFor(x.size(), PCA_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t chunk) {
+            std::vector<double> centered(nb_dim);
+            std::vector<double> z(rank);
+            double *out = partial[chunk].data();
+            for (size_t i = begin; i < end; ++i) {
+                for (size_t j = 0; j < nb_dim; ++j) {
+                    centered[j] = x[i][j] - mean[j];
+                }
+
+                std::fill(z.begin(), z.end(), 0);
+                for (size_t j = 0; j < nb_dim; ++j) {
+                    const double cj = centered[j];
+                    const double *b = &basis[j * rank];
+                    for (size_t l = 0; l < rank; ++l) {
+                        z[l] += cj * b[l];
+                    }
+                }
+
+                for (size_t j = 0; j < nb_dim; ++j) {
+                    const double cj = centered[j];
+                    double *o = out + j * rank;
+                    for (size_t l = 0; l < rank; ++l) {
+                        o[l] += cj * z[l];
+                    }
+                }
+            }
+        });
+
+        for (size_t chunk = 1; chunk < nb_chunks; ++chunk) {
+            for (size_t i = 0; i < partial[0].size(); ++i) {
+                partial[0][i] += partial[chunk][i];
+            }
+        }
+        for (auto &value : partial[0]) {
+            value /= x.size();
+        }
+        return partial[0];
+    }
+
+    // modified Gram-Schmidt over columns of nb_dim x rank row-major matrix
+    void Orthonormalize(std::vector<double> &basis, size_t nb_dim, size_t rank) {
+        for (size_t l = 0; l < rank; ++l) {
+            for (size_t p = 0; p < l; ++p) {
+                double dot = 0;
+                for (size_t j = 0; j < nb_dim; ++j) {
+                    dot += basis[j * rank + l] * basis[j * rank + p];
+                }
+                for (size_t j = 0; j < nb_dim; ++j) {
+                    basis[j * rank + l] -= dot * basis[j * rank + p];
+                }
+            }
+
+            double norm = 0;
+            for (size_t j = 0; j < nb_dim; ++j) {
+                norm += basis[j * rank + l] * basis[j * rank + l];
+            }
+            norm = std::sqrt(norm);
+            // rank deficient data, direction carries no variance
+            double scale = norm > 1e-12 ? 1.0 / norm : 0;
+            for (size_t j = 0; j < nb_dim; ++j) {
+                basis[j * rank + l] *= scale;
+            }
+        }
+    }
+
+    cv::PCA CreateRandomizedPCA(const matrix &x,
+                                double retain_variance,
+                                const RandomizedPCAParams &params) {
+        if (x.empty()) {
+            throw Exception("x is empty");
+        }
+
+        std::vector<double> mean;
+        double total_variance = 0;
+        ComputeMeanAndTotalVariance(x, mean, total_variance);
+
+        size_t nb_dim = mean.size();
+        size_t rank = std::min(nb_dim, params.initial_rank + params.oversampling);
+        std::mt19937 generator(params.seed);
+        std::normal_distribution<double> normal(0, 1);
+
+        while (true) {
+            std::vector<double> basis(nb_dim * rank);
+            for (auto &value : basis) {
+                value = normal(generator);
+            }
+
+            // range finder with power iterations: basis ~ C^q * omega
+            basis = MultiplyCovariance(x, mean, basis, rank);
+            for (size_t q = 0; q < params.nb_power_iterations; ++q) {
+                Orthonormalize(basis, nb_dim, rank);
+                basis = MultiplyCovariance(x, mean, basis, rank);
+            }
+            Orthonormalize(basis, nb_dim, rank);
+
+            // small rank x rank problem: Q^T C Q
+            std::vector<double> cq = MultiplyCovariance(x, mean, basis, rank);
+            cv::Mat projected(rank, rank, CV_64FC1);
+            for (size_t a = 0; a < rank; ++a) {
+                for (size_t b = 0; b < rank; ++b) {
+                    double value = 0;
+                    for (size_t j = 0; j < nb_dim; ++j) {
+                        value += basis[j * rank + a] * cq[j * rank + b];
+                    }
+                    projected.at<double>(a, b) = value;
+                }
+            }
+            // enforce symmetry lost to rounding
+            for (size_t a = 0; a < rank; ++a) {
+                for (size_t b = a + 1; b < rank; ++b) {
+                    double value = 0.5 * (projected.at<double>(a, b) + projected.at<double>(b, a));
+                    projected.at<double>(a, b) = value;
+                    projected.at<double>(b, a) = value;
+                }
+            }
+
+            cv::Mat values, vectors;
+            cv::eigen(projected, values, vectors);
+
+            std::vector<double> eigenvalues(rank);
+            for (size_t i = 0; i < rank; ++i) {
+                eigenvalues[i] = std::max(values.at<double>(i, 0), 0.0);
+            }
+
+            size_t nb_components = GetNumComponents(eigenvalues, total_variance, retain_variance);
+            bool is_sketch_enough = nb_components + params.oversampling <= rank;
+            if (is_sketch_enough || rank == nb_dim) {
+                std::vector<std::vector<double>> eigenvectors(
+                    nb_components, std::vector<double>(nb_dim, 0));
+                for (size_t i = 0; i < nb_components; ++i) {
+                    for (size_t j = 0; j < nb_dim; ++j) {
+                        double value = 0;
+                        for (size_t l = 0; l < rank; ++l) {
+                            value += basis[j * rank + l] * vectors.at<double>(i, l);
+                        }
+                        eigenvectors[i][j] = value;
+                    }
+                }
+                return MakePCA(mean, eigenvalues, eigenvectors, nb_components);
+            }
+
+            rank = std::min(nb_dim, rank * 2);
+        }
+    }
+} // namespace ml
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+
+namespace ml {
+
+enum class PCAMethod {
+    // exact eigendecomposition of the streamed covariance matrix
+    Covariance,
+    // randomized range finder over the implicit covariance matrix
+    Randomized
+};
+
+/**
+ * Streaming accumulator of mean and covariance.
+ * Rows are added in blocks and partial accumulators can be merged,
+ * so the data never has to be materialized as a single cv::Mat.
+ */
+class CovarianceAccumulator {
+public:
+    explicit CovarianceAccumulator(size_t nb_dim = 0);
+
+    // adds nb_rows contiguous rows of nb_dim values
+    void Add(const double *rows, size_t nb_rows);
+
+    void Add(const std::vector<std::vector<double>> &x, size_t begin, size_t end);
+
+    void Merge(const CovarianceAccumulator &other);
+
+    size_t GetCount() const;
+    size_t GetDim() const;
+    const std::vector<double>& GetMean() const;
+
+    // population covariance, nb_dim x nb_dim
+    cv::Mat GetCovariance() const;
+
+private:
+    size_t nb_dim_;
+    size_t count_;
+    std::vector<double> mean_;
+    // sum of centered outer products, only upper triangle is kept
+    std::vector<double> m2_;
+};
+
+struct RandomizedPCAParams {
+    // number of components sketched in the first attempt
+    size_t initial_rank = 32;
+    size_t oversampling = 10;
+    size_t nb_power_iterations = 2;
+    unsigned seed = 42;
+};
+
+/**
+ * Number of leading components needed to retain given share of variance,
+ * chosen in the same way as cv::PCA does it.
+ */
+size_t GetNumComponents(const std::vector<double> &eigenvalues,
+                        double total_variance,
+                        double retain_variance);
+
+CovarianceAccumulator AccumulateCovariance(const std::vector<std::vector<double>> &x);
+
+cv::PCA PCAFromCovariance(const std::vector<double> &mean,
+                          const cv::Mat &covariance,
+                          double retain_variance);
+
+// pca of (x - shift) / scale from the statistics accumulated over raw x
+cv::PCA PCAFromScaledCovariance(const CovarianceAccumulator &accumulator,
+                                double shift,
+                                double scale,
+                                double retain_variance);
+
+cv::PCA CreateCovariancePCA(const std::vector<std::vector<double>> &x,
+                            double retain_variance = 0.95);
+
+cv::PCA CreateRandomizedPCA(const std::vector<std::vector<double>> &x,
+                            double retain_variance = 0.95,
+                            const RandomizedPCAParams &params = RandomizedPCAParams());
+
+} // namespace ml
@@ -0,0 +1,193 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "vl/svm.h"
+
+#include "kernels.h"
+#include "logger.h"
+#include "parallel.h"
+#include "pegasos.h"
+
+
+namespace ml {
+    typedef std::vector<std::vector<double>> matrix;
+
+    // the factor is folded into the model before it underflows
+    const double MIN_MODEL_FACTOR = 1e-6;
+    const size_t SCORE_MIN_CHUNK_SIZE = 64;
+    const size_t UPDATE_MIN_CHUNK_SIZE = 1024;
+    const unsigned PEGASOS_SEED = 0;
+
+    // vlfeat losses and their derivatives, called as f(score, label)
+    struct Loss {
+        VlSvmLossFunction value;
+        VlSvmLossFunction derivative;
+    };
+
+    Loss GetLoss(LossType type) {
+        switch (type) {
+            case LossType::Hinge2:
+                return {&vl_svm_hinge2_loss, &vl_svm_hinge2_loss_derivative};
+            case LossType::L1:
+                return {&vl_svm_l1_loss, &vl_svm_l1_loss_derivative};
+            case LossType::L2:
+                return {&vl_svm_l2_loss, &vl_svm_l2_loss_derivative};
+            case LossType::Logistic:
+                return {&vl_svm_logistic_loss, &vl_svm_logistic_loss_derivative};
+            default:
+                return {&vl_svm_hinge_loss, &vl_svm_hinge_loss_derivative};
+        }
+    }
+
+    double GetObjective(const matrix &x,
+                        const std::vector<size_t> &rows,
+                        const std::vector<int> &y,
+                        const std::vector<double> &weights,
+                        const std::vector<double> &model,
+                        double bias,
+                        double lambda,
+                        const Loss &loss) {
+        const size_t nb_dim = model.size();
+        DotProductKernel dot = GetDotProductKernel(nb_dim);
+        std::vector<double> losses(GetNumChunks(rows.size(), SCORE_MIN_CHUNK_SIZE), 0);
+        ParallelFor(rows.size(), SCORE_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t chunk) {
+            for (size_t i = begin; i < end; ++i) {
+                double score = dot(x[rows[i]].data(), model.data(), nb_dim) + bias;
+                losses[chunk] += (weights.empty() ? 1 : weights[i]) * loss.value(score, y[i]);
+            }
+        });
+
+        double total = std::accumulate(losses.begin(), losses.end(), 0.0);
+        double norm = dot(model.data(), model.data(), nb_dim);
+        return 0.5 * lambda * norm + total / rows.size();
+    }
+
+    TrainStatistics TrainPegasos(const matrix &x,
+                                 const std::vector<size_t> &rows,
+                                 const std::vector<int> &y,
+                                 const std::vector<double> &weights,
+                                 const TrainOptions &options,
+                                 std::vector<double> &model,
+                                 double &bias) {
+        const size_t nb_data = rows.size();
+        const size_t nb_dim = x[rows[0]].size();
+        const double lambda = options.lambda;
+        const double bias_multiplier = options.bias_multiplier;
+        const size_t batch_size = std::max<size_t>(options.batch_size, 1);
+        // same limits and step offset as vlfeat
+        const size_t max_iterations = options.max_iterations > 0 ? options.max_iterations :
+                                      std::max<size_t>(nb_data, std::ceil(10.0 / lambda));
+        const size_t t0 = std::max<size_t>(2, std::ceil(1.0 / lambda));
+        const Loss loss = GetLoss(options.loss);
+        DotProductKernel dot = GetDotProductKernel(nb_dim);
+
+        // the model is factor * w and the bias is bias_factor * bias_multiplier * b
+        std::vector<double> w(nb_dim, 0);
+        double b = 0;
+        double factor = 1;
+        double bias_factor = 1;
+
+        std::vector<size_t> permutation(nb_data);
+        std::iota(permutation.begin(), permutation.end(), 0);
+        std::mt19937 random(PEGASOS_SEED);
+
+        std::vector<double> scores(nb_data, 0);
+        std::vector<double> previous_scores(nb_data, 0);
+        std::vector<double> batch_scores(batch_size);
+        std::vector<size_t> violators(batch_size);
+        std::vector<double> coefficients(batch_size);
+
+        auto fold_factor = [&]() {
+            for (auto &value : w) {
+                value *= factor;
+            }
+            b *= bias_factor;
+            factor = 1;
+            bias_factor = 1;
+        };
+
+        TrainStatistics statistics;
+        size_t t = 0;
+        size_t step = 0;
+        bool converged = false;
+        for (size_t epoch = 0; !converged && t < max_iterations; ++epoch) {
+            std::shuffle(permutation.begin(), permutation.end(), random);
+
+            for (size_t begin = 0; begin < nb_data && t < max_iterations; begin += batch_size) {
+                const size_t nb_batch = std::min(std::min(batch_size, nb_data - begin), max_iterations - t);
+
+                // the model doesn't change while the batch is scored
+                ParallelFor(nb_batch, SCORE_MIN_CHUNK_SIZE, [&](size_t first, size_t last, size_t) {
+                    for (size_t k = first; k < last; ++k) {
+                        const double *sample = x[rows[permutation[begin + k]]].data();
+                        batch_scores[k] = factor * dot(sample, w.data(), nb_dim) +
+                                          bias_factor * bias_multiplier * b;
+                    }
+                });
+
+                // one step per batch along the averaged gradient
+                const double rate = 1.0 / (lambda * (step + t0));
+                const double bias_rate = rate * options.bias_learning_rate;
+                factor *= 1 - lambda * rate;
+                bias_factor *= 1 - lambda * bias_rate;
+                ++step;
+
+                size_t nb_violators = 0;
+                for (size_t k = 0; k < nb_batch; ++k, ++t) {
+                    const size_t i = permutation[begin + k];
+                    scores[i] = batch_scores[k];
+
+                    // e.g. the hinge loss has gradient -y inside the margin and none outside
+                    const double gradient = (weights.empty() ? 1 : weights[i]) *
+                                            loss.derivative(batch_scores[k], y[i]);
+                    if (gradient != 0) {
+                        violators[nb_violators] = i;
+                        coefficients[nb_violators] = -gradient * rate / (nb_batch * factor);
+                        ++nb_violators;
+                        b -= bias_multiplier * gradient * bias_rate / (nb_batch * bias_factor);
+                    }
+                }
+
+                // every chunk owns a range of dimensions, no reduction buffers are needed
+                if (nb_violators > 0) {
+                    ParallelFor(nb_dim, UPDATE_MIN_CHUNK_SIZE, [&](size_t first, size_t last, size_t) {
+                        for (size_t k = 0; k < nb_violators; ++k) {
+                            AddScaled(coefficients[k], x[rows[violators[k]]].data() + first,
+                                      w.data() + first, last - first);
+                        }
+                    });
+                }
+
+                if (factor < MIN_MODEL_FACTOR || bias_factor < MIN_MODEL_FACTOR) {
+                    fold_factor();
+                }
+            }
+
+            // scores of the first epoch have nothing to be compared with
+            if (epoch > 0) {
+                double variation = 0;
+                for (size_t i = 0; i < nb_data; ++i) {
+                    double delta = scores[i] - previous_scores[i];
+                    variation += delta * delta;
+                }
+                variation = std::sqrt(variation) / nb_data;
+                converged = variation < options.epsilon;
+                Log(LogLevel::Debug) << "pegasos epoch " << epoch << " score variation " << variation;
+            }
+            std::swap(scores, previous_scores);
+        }
+
+        fold_factor();
+        model = std::move(w);
+        bias = bias_multiplier * b;
+
+        statistics.nb_iterations = t;
+        statistics.objective = GetObjective(x, rows, y, weights, model, bias, lambda, loss);
+        statistics.max_iterations_reached = !converged;
+        return statistics;
+    }
+} // namespace ml
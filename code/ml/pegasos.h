@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "binary_svm.h"
+
+
+namespace ml {
+
+/**
+ * Mini-batch Pegasos with the losses and the learning rate schedule
+ * of vlfeat's SGD solver, so batch_size 1 is the vlfeat solver.
+ * The model is kept as factor * w, the decay of a step only changes
+ * the factor instead of rescaling all of w. Samples of a batch are scored
+ * in parallel against the model of the batch start and their updates are
+ * added in parallel over ranges of dimensions.
+ * Like vlfeat it stops once the scores of an epoch change by less than epsilon.
+ * Trains on x[rows[k]] labelled y[k] in {-1, 1} without copying the rows,
+ * the loss of a row is scaled by weights[k] unless weights are empty.
+ * Model and bias are overwritten.
+ * The bias is learnt at bias_learning_rate times the rate of the model.
+ */
+TrainStatistics TrainPegasos(const std::vector<std::vector<double>> &x,
+                             const std::vector<size_t> &rows,
+                             const std::vector<int> &y,
+                             const std::vector<double> &weights,
+                             const TrainOptions &options,
+                             std::vector<double> &model,
+                             double &bias);
+
+} // namespace ml
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "metrics.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "util.h"
+
+
+namespace ml {
+    struct DecodedImage {
+        size_t index;
+        std::vector<uint8_t> pixels;
+    };
+
+    struct Prediction {
+        size_t index;
+        int label;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    double SecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    class ClassifyJob {
+    public:
+        ClassifyJob(const Predictor &predictor,
+                    const std::vector<std::string> &image_paths,
+                    size_t queue_capacity)
+        :predictor_(predictor), image_paths_(image_paths),
+         decoded_(queue_capacity), predicted_(queue_capacity),
+         next_decode_(0), nb_popped_(0), failed_(false),
+         decode_ns_(0), predict_ns_(0) {}
+
+        void Work() {
+            PredictorScratch scratch;
+            predictor_.Reserve(scratch);
+            try {
+                while (!failed_.load(std::memory_order_relaxed)) {
+                    // score while decoded images pile up, decode otherwise
+                    bool prefer_predict = decoded_.GetSize() * 2 >= decoded_.GetCapacity();
+                    if (prefer_predict && TryPredict(scratch)) {
+                        continue;
+                    }
+                    if (TryDecode(scratch)) {
+                        continue;
+                    }
+                    if (TryPredict(scratch)) {
+                        continue;
+                    }
+                    if (nb_popped_.load() >= image_paths_.size()) {
+                        return;
+                    }
+                    std::this_thread::yield();
+                }
+            } catch (...) {
+                Fail(std::current_exception());
+            }
+        }
+
+        // called by the writer, false once everything is predicted or the job failed
+        bool PopPrediction(Prediction &prediction) {
+            while (!predicted_.TryPop(prediction)) {
+                if (failed_.load()) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            return true;
+        }
+
+        void SampleOccupancy(double &decoded, double &predicted) const {
+            decoded += static_cast<double>(decoded_.GetSize()) / decoded_.GetCapacity();
+            predicted += static_cast<double>(predicted_.GetSize()) / predicted_.GetCapacity();
+        }
+
+        void Fail(std::exception_ptr error) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_) {
+                error_ = error;
+            }
+            failed_ = true;
+        }
+
+        void RethrowError() {
+            if (error_) {
+                std::rethrow_exception(error_);
+            }
+        }
+
+        double GetDecodeSeconds() const { return decode_ns_.load() * 1e-9; }
+        double GetPredictSeconds() const { return predict_ns_.load() * 1e-9; }
+
+    private:
+        bool TryDecode(PredictorScratch &scratch) {
+            size_t index = next_decode_.fetch_add(1);
+            if (index >= image_paths_.size()) {
+                return false;
+            }
+
+            auto start = Clock::now();
+            DecodedImage image = {index, ReadImage(image_paths_[index])};
+            ValidateDimensions(predictor_.GetInputDim(), image.pixels.size(), index);
+            AddTime(decode_ns_, start);
+
+            // the queue is full, help scoring until there is room
+            while (!decoded_.TryPush(image)) {
+                if (failed_.load()) {
+                    return true;
+                }
+                if (!TryPredict(scratch)) {
+                    std::this_thread::yield();
+                }
+            }
+            return true;
+        }
+
+        bool TryPredict(PredictorScratch &scratch) {
+            DecodedImage image;
+            if (!decoded_.TryPop(image)) {
+                return false;
+            }
+            nb_popped_.fetch_add(1);
+
+            auto start = Clock::now();
+            Prediction prediction = {image.index, predictor_.PredictOne(image.pixels.data(), scratch)};
+            AddTime(predict_ns_, start);
+
+            while (!predicted_.TryPush(prediction)) {
+                if (failed_.load()) {
+                    return true;
+                }
+                std::this_thread::yield();
+            }
+            return true;
+        }
+
+        static void AddTime(std::atomic<int64_t> &total, Clock::time_point start) {
+            total.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                Clock::now() - start).count());
+        }
+
+        const Predictor &predictor_;
+        const std::vector<std::string> &image_paths_;
+        BoundedQueue<DecodedImage> decoded_;
+        BoundedQueue<Prediction> predicted_;
+        std::atomic<size_t> next_decode_;
+        std::atomic<size_t> nb_popped_;
+        std::atomic<bool> failed_;
+        std::atomic<int64_t> decode_ns_;
+        std::atomic<int64_t> predict_ns_;
+        std::mutex mutex_;
+        std::exception_ptr error_;
+    };
+
+    PipelineStats ClassifyPipelined(const Predictor &predictor,
+                                    const std::vector<std::string> &image_paths,
+                                    std::ostream &output,
+                                    const PipelineOptions &options) {
+        auto start = Clock::now();
+        PipelineStats stats;
+        stats.nb_images = image_paths.size();
+        stats.nb_workers = std::max<size_t>(1, options.nb_workers ? options.nb_workers : GetNumThreads());
+
+        ClassifyJob job(predictor, image_paths, options.queue_capacity);
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < stats.nb_workers; ++i) {
+            workers.emplace_back(&ClassifyJob::Work, &job);
+        }
+
+        // the calling thread writes, predictions arriving early wait for their turn
+        std::vector<int> labels(image_paths.size());
+        std::vector<char> ready(image_paths.size(), 0);
+        size_t next_write = 0;
+        double write_seconds = 0;
+        try {
+            for (size_t i = 0; i < image_paths.size(); ++i) {
+                Prediction prediction;
+                if (!job.PopPrediction(prediction)) {
+                    break;
+                }
+                job.SampleOccupancy(stats.decoded_occupancy, stats.predicted_occupancy);
+
+                auto write_start = Clock::now();
+                labels[prediction.index] = prediction.label;
+                ready[prediction.index] = 1;
+                while (next_write < image_paths.size() && ready[next_write]) {
+                    output << image_paths[next_write] << " " << labels[next_write] << "\n";
+                    ++next_write;
+                }
+                write_seconds += SecondsSince(write_start);
+            }
+        } catch (...) {
+            job.Fail(std::current_exception());
+        }
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        job.RethrowError();
+
+        if (stats.nb_images > 0) {
+            stats.decoded_occupancy /= stats.nb_images;
+            stats.predicted_occupancy /= stats.nb_images;
+        }
+        stats.seconds = SecondsSince(start);
+        stats.decode_seconds = job.GetDecodeSeconds();
+        stats.predict_seconds = job.GetPredictSeconds();
+        stats.write_seconds = write_seconds;
+
+        Metrics &metrics = GetMetrics();
+        metrics.Observe("pipeline_seconds", stats.seconds);
+        metrics.Increment("pipeline_items", stats.nb_images);
+        metrics.SetGauge("pipeline_workers", stats.nb_workers);
+        metrics.SetGauge("pipeline_decode_seconds", stats.decode_seconds);
+        metrics.SetGauge("pipeline_predict_seconds", stats.predict_seconds);
+        metrics.SetGauge("pipeline_write_seconds", stats.write_seconds);
+        metrics.SetGauge("pipeline_decoded_occupancy", stats.decoded_occupancy);
+        metrics.SetGauge("pipeline_predicted_occupancy", stats.predicted_occupancy);
+        return stats;
+    }
+
+} // namespace ml
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "predictor.h"
+
+
+namespace ml {
+
+struct PipelineOptions {
+    // 0 means GetNumThreads()
+    size_t nb_workers = 0;
+    size_t queue_capacity = 256;
+};
+
+struct PipelineStats {
+    size_t nb_images = 0;
+    size_t nb_workers = 0;
+    double seconds = 0;
+    // time workers spent in every stage, summed over workers
+    double decode_seconds = 0;
+    double predict_seconds = 0;
+    double write_seconds = 0;
+    // average share of the queue capacity in use
+    double decoded_occupancy = 0;
+    double predicted_occupancy = 0;
+};
+
+/**
+ * Classifies images with concurrent decode, predict (preprocessing and
+ * scoring) and write stages connected by bounded lock-free queues.
+ * Workers are not bound to a stage, they score while decoded images pile
+ * up and decode otherwise, so the slower stage gets more of them.
+ * Predictions are written in input order as "<path> <label>" lines.
+ */
+PipelineStats ClassifyPipelined(const Predictor &predictor,
+                                const std::vector<std::string> &image_paths,
+                                std::ostream &output,
+                                const PipelineOptions &options = PipelineOptions());
+
+} // namespace ml
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "exception.h"
+#include "metrics.h"
+#include "parallel.h"
+#include "predictor.h"
+#include "quadratic.h"
+#include "util.h"
+#include "voting.h"
+
+
+namespace ml {
+    const size_t PREDICTOR_MIN_CHUNK_SIZE = 64;
+
+    template <class Vector>
+    void GrowTo(Vector &buffer, size_t size) {
+        if (buffer.size() < size) {
+            buffer.resize(size);
+        }
+    }
+
+    DenseMatrix PackModels(const MulticlassSVM &svm) {
+        if (svm.GetModels().empty()) {
+            throw Exception("there are no models");
+        }
+        const auto &models = svm.GetModels();
+        const size_t nb_labels = svm.GetLabels().size();
+        // scoring walks the pairs of labels, one model and bias each
+        if (models.size() != svm.GetBiases().size() ||
+            models.size() != nb_labels * (nb_labels - 1) / 2) {
+            throw Exception("model has inconsistent number of models, biases and labels");
+        }
+        size_t nb_dim = models[0].size();
+        for (size_t i = 0; i < models.size(); ++i) {
+            ValidateDimensions(nb_dim, models[i].size(), i);
+        }
+        return DenseMatrix::FromMatrix(models);
+    }
+
+    Predictor::Predictor(const MulticlassSVM &svm)
+    :weights_(PackModels(svm)), biases_(svm.GetBiases()), labels_(svm.GetLabels()) {
+        model_dim_ = weights_.GetCols();
+        input_dim_ = model_dim_;
+        model_dot_ = GetDotProductKernel(model_dim_);
+    }
+
+    Predictor::Predictor(const MulticlassSVM &svm, const cv::PCA &pca, double mean, double std_dev)
+    :Predictor(svm) {
+        if (pca.eigenvectors.empty() || pca.mean.cols != pca.eigenvectors.cols) {
+            throw Exception("pca is empty or inconsistent");
+        }
+        if (std_dev == 0) {
+            throw Exception("standard deviation of normalization is zero");
+        }
+
+        preprocessed_ = true;
+        mean_ = mean;
+        std_dev_ = std_dev;
+        input_dim_ = pca.eigenvectors.cols;
+        projected_dim_ = pca.eigenvectors.rows;
+
+        if (model_dim_ == GetQuadraticDim(projected_dim_, true)) {
+            with_squares_ = true;
+        } else if (model_dim_ != GetQuadraticDim(projected_dim_, false)) {
+            throw Exception(
+                "model dimensionality " + std::to_string(model_dim_) +
+                " does not match pca with " + std::to_string(projected_dim_) + " components"
+            );
+        }
+
+        pca_mean_.assign(input_dim_, 0);
+        eigenvectors_ = DenseMatrix(projected_dim_, input_dim_);
+        for (size_t j = 0; j < input_dim_; ++j) {
+            pca_mean_[j] = pca.mean.at<double>(0, j);
+        }
+        for (size_t k = 0; k < projected_dim_; ++k) {
+            for (size_t j = 0; j < input_dim_; ++j) {
+                eigenvectors_.Row(k)[j] = pca.eigenvectors.at<double>(k, j);
+            }
+        }
+        input_dot_ = GetDotProductKernel(input_dim_);
+    }
+
+    bool Predictor::IsPreprocessed() const {
+        return preprocessed_;
+    }
+
+    bool Predictor::HasSquares() const {
+        return with_squares_;
+    }
+
+    size_t Predictor::GetInputDim() const {
+        return input_dim_;
+    }
+
+    size_t Predictor::GetProjectedDim() const {
+        return projected_dim_;
+    }
+
+    size_t Predictor::GetModelDim() const {
+        return model_dim_;
+    }
+
+    const std::vector<int>& Predictor::GetLabels() const {
+        return labels_;
+    }
+
+    void Predictor::Reserve(PredictorScratch &scratch) const {
+        GrowTo(scratch.centered, input_dim_);
+        GrowTo(scratch.features, model_dim_);
+        GrowTo(scratch.votes, labels_.size());
+        GrowTo(scratch.margins, labels_.size());
+    }
+
+    template <class Pixel>
+    void Predictor::ComputeFeatures(const Pixel *pixels, PredictorScratch &scratch) const {
+        double *features = scratch.features.data();
+        if (!preprocessed_) {
+            for (size_t j = 0; j < input_dim_; ++j) {
+                features[j] = pixels[j];
+            }
+            return;
+        }
+
+        double *centered = scratch.centered.data();
+        for (size_t j = 0; j < input_dim_; ++j) {
+            centered[j] = (pixels[j] - mean_) / std_dev_ - pca_mean_[j];
+        }
+
+        // projection goes to the head of the features, products follow it
+        double *projected = centered + input_dim_ - projected_dim_;
+        for (size_t k = 0; k < projected_dim_; ++k) {
+            features[k] = input_dot_(eigenvectors_.Row(k), centered, input_dim_);
+        }
+        std::copy(features, features + projected_dim_, projected);
+        ExpandQuadratic(projected, projected_dim_, features, with_squares_);
+    }
+
+    int Predictor::PredictOne(const uint8_t *pixels, PredictorScratch &scratch) const {
+        if (labels_.empty()) {
+            throw Exception("there are no models");
+        }
+        Reserve(scratch);
+        ComputeFeatures(pixels, scratch);
+        return PredictFeatures(scratch.features.data(), scratch);
+    }
+
+    int Predictor::PredictOne(const uint8_t *pixels) const {
+        thread_local PredictorScratch scratch;
+        return PredictOne(pixels, scratch);
+    }
+
+    int Predictor::PredictFeatures(const double *features, PredictorScratch &scratch) const {
+        if (labels_.empty()) {
+            throw Exception("there are no models");
+        }
+        Reserve(scratch);
+
+        const size_t nb_labels = labels_.size();
+        int *votes = scratch.votes.data();
+        double *margins = scratch.margins.data();
+        std::fill(votes, votes + nb_labels, 0);
+        std::fill(margins, margins + nb_labels, 0);
+
+        size_t idx = 0;
+        for (size_t i = 0; i < nb_labels; ++i) {
+            for (size_t j = i + 1; j < nb_labels; ++j) {
+                double score = model_dot_(weights_.Row(idx), features, model_dim_) + biases_[idx];
+                AddVote(votes, margins, i, j, score);
+                ++idx;
+            }
+        }
+        return labels_[SelectWinner(votes, margins, nb_labels)];
+    }
+
+    std::vector<int> Predictor::Predict(const std::vector<std::vector<double>> &pixels) const {
+        if (pixels.empty()) {
+            return {};
+        }
+
+        if (labels_.empty()) {
+            throw Exception("there are no models");
+        }
+        ScopedTimer timer("predictor_predict");
+        timer.SetNumItems(pixels.size());
+
+        std::vector<int> predictions(pixels.size());
+        ParallelFor(pixels.size(), PREDICTOR_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t) {
+            PredictorScratch scratch;
+            Reserve(scratch);
+            for (size_t i = begin; i < end; ++i) {
+                ValidateDimensions(input_dim_, pixels[i].size(), i);
+                ComputeFeatures(pixels[i].data(), scratch);
+                predictions[i] = PredictFeatures(scratch.features.data(), scratch);
+            }
+        });
+
+        return predictions;
+    }
+
+    std::vector<int> Predictor::PredictProjected(const double *projected, size_t nb_rows) const {
+        if (!preprocessed_) {
+            throw Exception("model is not preprocessed, there are no projected features");
+        }
+        ScopedTimer timer("predictor_predict_projected");
+        timer.SetNumItems(nb_rows);
+
+        std::vector<int> predictions(nb_rows);
+        ParallelFor(nb_rows, PREDICTOR_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t) {
+            PredictorScratch scratch;
+            Reserve(scratch);
+            for (size_t i = begin; i < end; ++i) {
+                double *features = scratch.features.data();
+                ExpandQuadratic(projected + i * projected_dim_, projected_dim_, features, with_squares_);
+                predictions[i] = PredictFeatures(features, scratch);
+            }
+        });
+
+        return predictions;
+    }
+
+    SharedPredictor LoadPredictor(const std::string &model_path, bool preprocessed) {
+        auto svm = ReadModel(model_path + ".svm");
+        if (!preprocessed) {
+            return std::make_shared<const Predictor>(svm);
+        }
+
+        auto norm = LoadNormalizationParams(model_path + ".norm");
+        auto pca = LoadPCA(model_path + ".pca");
+        return std::make_shared<const Predictor>(svm, pca, std::get<0>(norm), std::get<1>(norm));
+    }
+
+} // namespace ml
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "dense_matrix.h"
+#include "kernels.h"
+#include "multiclass_svm.h"
+
+
+namespace ml {
+
+/**
+ * Buffers used by a single Predictor::PredictOne call.
+ * They grow on the first call and are reused afterwards,
+ * so keep one scratch per thread.
+ */
+struct PredictorScratch {
+    AlignedVector centered;
+    AlignedVector features;
+    std::vector<int> votes;
+    std::vector<double> margins;
+};
+
+/**
+ * Immutable "one vs one" predictor holding packed pair models together
+ * with the preprocessing they were trained with. Normalization, PCA
+ * projection, quadratic interactions and scoring of a single image run
+ * over preallocated buffers without touching the heap. All methods are
+ * const and keep no state, so one instance can be shared by any number
+ * of threads. Training stays in MulticlassSVM.
+ */
+class Predictor {
+public:
+    // model trained on raw pixels
+    explicit Predictor(const MulticlassSVM &svm);
+
+    // model trained on normalized, projected and expanded pixels
+    Predictor(const MulticlassSVM &svm, const cv::PCA &pca, double mean, double std_dev);
+
+    bool IsPreprocessed() const;
+    bool HasSquares() const;
+    size_t GetInputDim() const;
+    size_t GetProjectedDim() const;
+    size_t GetModelDim() const;
+    const std::vector<int>& GetLabels() const;
+
+    // sizes the buffers so following calls do not allocate
+    void Reserve(PredictorScratch &scratch) const;
+
+    int PredictOne(const uint8_t *pixels, PredictorScratch &scratch) const;
+
+    // uses thread local scratch
+    int PredictOne(const uint8_t *pixels) const;
+
+    // features are already normalized, projected and expanded
+    int PredictFeatures(const double *features, PredictorScratch &scratch) const;
+
+    // batch of raw pixel rows as read by ReadData, scored in parallel
+    std::vector<int> Predict(const std::vector<std::vector<double>> &pixels) const;
+
+    // contiguous rows already normalized and projected, only expansion and scoring are left
+    std::vector<int> PredictProjected(const double *projected, size_t nb_rows) const;
+
+private:
+    template <class Pixel>
+    void ComputeFeatures(const Pixel *pixels, PredictorScratch &scratch) const;
+
+    bool preprocessed_ = false;
+    bool with_squares_ = false;
+    size_t input_dim_ = 0;
+    size_t projected_dim_ = 0;
+    size_t model_dim_ = 0;
+    double mean_ = 0;
+    double std_dev_ = 1;
+    AlignedVector pca_mean_;
+    DenseMatrix eigenvectors_;
+    DenseMatrix weights_;
+    std::vector<double> biases_;
+    std::vector<int> labels_;
+    DotProductKernel input_dot_ = &GenericDotProduct;
+    DotProductKernel model_dot_ = &GenericDotProduct;
+};
+
+typedef std::shared_ptr<const Predictor> SharedPredictor;
+
+// reads model_path.svm and, for preprocessed models, model_path.pca and model_path.norm
+SharedPredictor LoadPredictor(const std::string &model_path, bool preprocessed);
+
+} // namespace ml
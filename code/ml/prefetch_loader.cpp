@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "exception.h"
+#include "logger.h"
+#include "metrics.h"
+#include "parallel.h"
+#include "pca.h"
+#include "prefetch_loader.h"
+#include "util.h"
+
+
+namespace ml {
+    PrefetchLoader::PrefetchLoader(const std::string &data_path,
+                                   bool load_label,
+                                   size_t batch_size,
+                                   size_t nb_batches_ahead,
+                                   size_t nb_decoders,
+                                   bool accumulate_statistics)
+    :batch_size_(std::max<size_t>(1, batch_size)),
+     nb_batches_ahead_(std::max<size_t>(1, nb_batches_ahead)),
+     accumulate_statistics_(accumulate_statistics),
+     ready_(nb_batches_ahead_),
+     next_batch_(0), nb_consumed_(0), stop_(false) {
+        ReadDescription(data_path, load_label, image_paths_, labels_);
+        nb_batches_ = (image_paths_.size() + batch_size_ - 1) / batch_size_;
+
+        nb_decoders = std::max<size_t>(1, nb_decoders ? nb_decoders : GetNumThreads());
+        for (size_t i = 0; i < nb_decoders; ++i) {
+            decoders_.emplace_back(&PrefetchLoader::DecodeLoop, this);
+        }
+    }
+
+    PrefetchLoader::~PrefetchLoader() {
+        Stop();
+    }
+
+    void PrefetchLoader::Stop() {
+        stop_ = true;
+        for (auto &decoder : decoders_) {
+            decoder.join();
+        }
+        decoders_.clear();
+    }
+
+    size_t PrefetchLoader::GetNumImages() const {
+        return image_paths_.size();
+    }
+
+    const std::vector<std::string>& PrefetchLoader::GetImagePaths() const {
+        return image_paths_;
+    }
+
+    void PrefetchLoader::DecodeLoop() {
+        while (!stop_.load()) {
+            size_t index = next_batch_.fetch_add(1);
+            if (index >= nb_batches_) {
+                return;
+            }
+            // at most nb_batches_ahead_ are in flight, so the queue always has room
+            while (index >= nb_consumed_.load() + nb_batches_ahead_) {
+                if (stop_.load()) {
+                    return;
+                }
+                std::this_thread::yield();
+            }
+
+            ImageBatch batch;
+            batch.begin = index * batch_size_;
+            size_t end = std::min(image_paths_.size(), batch.begin + batch_size_);
+            try {
+                for (size_t i = batch.begin; i < end; ++i) {
+                    auto pixels = ReadImage(image_paths_[i]);
+                    batch.x.emplace_back(pixels.begin(), pixels.end());
+                    batch.y.push_back(labels_[i]);
+                }
+                if (accumulate_statistics_ && !batch.x.empty()) {
+                    batch.covariance = CovarianceAccumulator(batch.x[0].size());
+                    batch.covariance.Add(batch.x, 0, batch.x.size());
+                    for (auto &row : batch.x) {
+                        for (auto value : row) {
+                            batch.sum += value;
+                            batch.sum_of_squares += value * value;
+                        }
+                    }
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+                stop_ = true;
+                return;
+            }
+
+            while (!ready_.TryPush(batch)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool PrefetchLoader::Next(ImageBatch &batch) {
+        size_t index = nb_consumed_.load();
+        if (index >= nb_batches_) {
+            return false;
+        }
+
+        size_t begin = index * batch_size_;
+        while (pending_.count(begin) == 0) {
+            ImageBatch arrived;
+            if (ready_.TryPop(arrived)) {
+                pending_[arrived.begin] = std::move(arrived);
+                continue;
+            }
+            if (stop_.load()) {
+                Stop();
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (error_) {
+                    std::rethrow_exception(error_);
+                }
+                throw Exception("loader is stopped");
+            }
+            std::this_thread::yield();
+        }
+
+        batch = std::move(pending_[begin]);
+        pending_.erase(begin);
+        nb_consumed_.fetch_add(1);
+        return true;
+    }
+
+    Data ReadDataWithStatistics(const std::string &data_path, PixelStatistics &statistics) {
+        ScopedTimer timer("read_data");
+        PrefetchLoader loader(data_path, true, 256, 8, 0, true);
+        size_t nb_images = loader.GetNumImages();
+        if (nb_images == 0) {
+            throw Exception("there are no images in " + data_path);
+        }
+        timer.SetNumItems(nb_images);
+
+        Matrix x(nb_images);
+        std::vector<int> y(nb_images);
+        double sum = 0;
+        double sum_of_squares = 0;
+        double nb_values = 0;
+
+        ImageBatch batch;
+        while (loader.Next(batch)) {
+            if (batch.begin == 0) {
+                statistics.covariance = CovarianceAccumulator(batch.covariance.GetDim());
+            }
+            ValidateDimensions(statistics.covariance.GetDim(), batch.covariance.GetDim(), batch.begin);
+
+            // batches come in data set order, so merging them is deterministic
+            statistics.covariance.Merge(batch.covariance);
+            sum += batch.sum;
+            sum_of_squares += batch.sum_of_squares;
+            for (size_t i = 0; i < batch.x.size(); ++i) {
+                nb_values += batch.x[i].size();
+                x[batch.begin + i] = std::move(batch.x[i]);
+                y[batch.begin + i] = batch.y[i];
+            }
+        }
+
+        statistics.mean = sum / nb_values;
+        statistics.std_dev = std::sqrt(sum_of_squares / nb_values - statistics.mean * statistics.mean);
+
+        Log(LogLevel::Info) << "upload all images from " << data_path;
+        Log(LogLevel::Info) << "number of images " << x.size();
+        Log(LogLevel::Info) << "dimensionality " << x.at(0).size();
+        return std::make_tuple(std::move(x), std::move(y), loader.GetImagePaths());
+    }
+
+} // namespace ml
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounded_queue.h"
+#include "pca.h"
+#include "util.h"
+
+
+namespace ml {
+
+struct ImageBatch {
+    // index of the first image of the batch in the data set
+    size_t begin = 0;
+    Matrix x;
+    std::vector<int> y;
+    // of this batch alone, filled by the decoder when the loader accumulates statistics
+    CovarianceAccumulator covariance;
+    double sum = 0;
+    double sum_of_squares = 0;
+};
+
+/**
+ * Decodes the images of a description file on background threads into a
+ * ring of batches, at most nb_batches_ahead ahead of the consumer.
+ * Batches are handed out in data set order, so work done on them
+ * overlaps with decoding of the following ones.
+ * With accumulate_statistics every decoder also sums the pixels and
+ * accumulates the covariance of the batches it decodes.
+ */
+class PrefetchLoader {
+public:
+    // nb_decoders = 0 means GetNumThreads()
+    PrefetchLoader(const std::string &data_path,
+                   bool load_label = true,
+                   size_t batch_size = 256,
+                   size_t nb_batches_ahead = 8,
+                   size_t nb_decoders = 0,
+                   bool accumulate_statistics = false);
+    ~PrefetchLoader();
+
+    PrefetchLoader(const PrefetchLoader &) = delete;
+    PrefetchLoader& operator=(const PrefetchLoader &) = delete;
+
+    size_t GetNumImages() const;
+    const std::vector<std::string>& GetImagePaths() const;
+
+    // waits for the next batch, false after the last one; rethrows decoding errors
+    bool Next(ImageBatch &batch);
+
+private:
+    void DecodeLoop();
+    void Stop();
+
+    std::vector<std::string> image_paths_;
+    std::vector<int> labels_;
+    size_t batch_size_;
+    size_t nb_batches_;
+    size_t nb_batches_ahead_;
+    bool accumulate_statistics_;
+
+    BoundedQueue<ImageBatch> ready_;
+    // batches which arrived before their predecessors
+    std::map<size_t, ImageBatch> pending_;
+    std::atomic<size_t> next_batch_;
+    std::atomic<size_t> nb_consumed_;
+    std::atomic<bool> stop_;
+    std::mutex mutex_;
+    std::exception_ptr error_;
+    std::vector<std::thread> decoders_;
+};
+
+struct PixelStatistics {
+    // over all pixels of all images, as Normalize computes them
+    double mean = 0;
+    double std_dev = 0;
+    // of raw images
+    CovarianceAccumulator covariance;
+};
+
+/**
+ * Reads the data set through PrefetchLoader, pixel mean, deviation and
+ * covariance are accumulated by the decoders and merged in batch order,
+ * so the result doesn't depend on the number of decoders.
+ */
+Data ReadDataWithStatistics(const std::string &data_path, PixelStatistics &statistics);
+
+} // namespace ml
@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <vector>
+
+#include "dense_matrix.h"
+#include "metrics.h"
+#include "parallel.h"
+#include "quadratic.h"
+#include "util.h"
+
+
+namespace ml {
+    const size_t QUADRATIC_MIN_CHUNK_SIZE = 64;
+
+    size_t GetQuadraticDim(size_t nb_dim, bool with_squares) {
+        size_t nb_pairs = with_squares ? nb_dim * (nb_dim + 1) / 2 : nb_dim * (nb_dim - 1) / 2;
+        return nb_dim + nb_pairs;
+    }
+
+    void ExpandQuadratic(const double * __restrict x,
+                         size_t nb_dim,
+                         double * __restrict out,
+                         bool with_squares) {
+        std::copy(x, x + nb_dim, out);
+        out += nb_dim;
+
+        const size_t first = with_squares ? 0 : 1;
+        for (size_t j = 0; j < nb_dim; ++j) {
+            const double xj = x[j];
+            const double * __restrict xk = x + j + first;
+            const size_t nb_products = nb_dim - j - first;
+            // contiguous in k, vectorized by the compiler
+            for (size_t k = 0; k < nb_products; ++k) {
+                out[k] = xj * xk[k];
+            }
+            out += nb_products;
+        }
+    }
+
+    DenseMatrix ExpandQuadratic(const Matrix &x, bool with_squares) {
+        if (x.empty()) {
+            return DenseMatrix();
+        }
+
+        ScopedTimer timer("quadratic_expansion");
+        timer.SetNumItems(x.size());
+        const size_t nb_dim = x[0].size();
+        DenseMatrix result(x.size(), GetQuadraticDim(nb_dim, with_squares));
+
+        ParallelFor(x.size(), QUADRATIC_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t) {
+            for (size_t i = begin; i < end; ++i) {
+                ValidateDimensions(nb_dim, x[i].size(), i);
+                ExpandQuadratic(x[i].data(), nb_dim, result.Row(i), with_squares);
+            }
+        });
+        return result;
+    }
+
+    DenseMatrix ExpandQuadratic(const DenseMatrix &x, bool with_squares) {
+        ScopedTimer timer("quadratic_expansion");
+        timer.SetNumItems(x.GetRows());
+        const size_t nb_dim = x.GetCols();
+        DenseMatrix result(x.GetRows(), GetQuadraticDim(nb_dim, with_squares));
+
+        ParallelFor(x.GetRows(), QUADRATIC_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t) {
+            for (size_t i = begin; i < end; ++i) {
+                ExpandQuadratic(x.Row(i), nb_dim, result.Row(i), with_squares);
+            }
+        });
+        return result;
+    }
+} // namespace ml
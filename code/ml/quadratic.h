@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "dense_matrix.h"
+
+
+namespace ml {
+
+// number of features produced by ExpandQuadratic from nb_dim inputs
+size_t GetQuadraticDim(size_t nb_dim, bool with_squares = false);
+
+/**
+ * Writes x followed by the pairwise products x_j * x_k in packed
+ * upper triangular order (k > j, or k >= j with squared terms).
+ * out must hold GetQuadraticDim(nb_dim, with_squares) values.
+ */
+void ExpandQuadratic(const double *x, size_t nb_dim, double *out, bool with_squares = false);
+
+// expands every row, rows are processed in parallel
+DenseMatrix ExpandQuadratic(const std::vector<std::vector<double>> &x, bool with_squares = false);
+
+DenseMatrix ExpandQuadratic(const DenseMatrix &x, bool with_squares = false);
+
+} // namespace ml
@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX512VNNI__) || defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "exception.h"
+#include "multiclass_svm.h"
+#include "parallel.h"
+#include "quantization.h"
+#include "util.h"
+#include "voting.h"
+
+
+namespace ml {
+    typedef std::vector<std::vector<double>> matrix;
+
+    const int INT8_LEVELS = 127;
+    const size_t PREDICT_MIN_CHUNK_SIZE = 64;
+
+    double QuantizeValues(const double *values, size_t nb_dim, int8_t *out) {
+        double max_abs = 0;
+        for (size_t i = 0; i < nb_dim; ++i) {
+            max_abs = std::max(max_abs, std::fabs(values[i]));
+        }
+
+        if (max_abs == 0) {
+            std::fill(out, out + nb_dim, 0);
+            return 0;
+        }
+
+        double scale = max_abs / INT8_LEVELS;
+        for (size_t i = 0; i < nb_dim; ++i) {
+            long level = std::lround(values[i] / scale);
+            out[i] = static_cast<int8_t>(std::max<long>(-INT8_LEVELS, std::min<long>(INT8_LEVELS, level)));
+        }
+        return scale;
+    }
+
+#if defined(__AVX512VNNI__) && defined(__AVX512BW__)
+    const char* GetInt8KernelName() {
+        return "avx512-vnni";
+    }
+
+    int32_t Int8DotProduct(const int8_t *v1, const int8_t *v2, size_t nb_dim) {
+        // vpdpbusd multiplies unsigned by signed bytes: v1 is shifted by 128
+        // and 128 * sum(v2) is subtracted afterwards
+        const __m512i offset = _mm512_set1_epi8(static_cast<char>(0x80));
+        __m512i acc = _mm512_setzero_si512();
+        __m512i correction = _mm512_setzero_si512();
+        size_t i = 0;
+        for (; i + 64 <= nb_dim; i += 64) {
+            __m512i a = _mm512_loadu_si512(v1 + i);
+            __m512i b = _mm512_loadu_si512(v2 + i);
+            acc = _mm512_dpbusd_epi32(acc, _mm512_xor_si512(a, offset), b);
+            correction = _mm512_dpbusd_epi32(correction, offset, b);
+        }
+        int32_t result = _mm512_reduce_add_epi32(_mm512_sub_epi32(acc, correction));
+        for (; i < nb_dim; ++i) {
+            result += int32_t(v1[i]) * v2[i];
+        }
+        return result;
+    }
+#elif defined(__AVX2__)
+    const char* GetInt8KernelName() {
+        return "avx2";
+    }
+
+    int32_t Int8DotProduct(const int8_t *v1, const int8_t *v2, size_t nb_dim) {
+        __m256i acc = _mm256_setzero_si256();
+        size_t i = 0;
+        for (; i + 16 <= nb_dim; i += 16) {
+            __m256i a = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v1 + i)));
+            __m256i b = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(v2 + i)));
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(a, b));
+        }
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        int32_t result = _mm_cvtsi128_si32(sum);
+        for (; i < nb_dim; ++i) {
+            result += int32_t(v1[i]) * v2[i];
+        }
+        return result;
+    }
+#elif defined(__SSE2__)
+    const char* GetInt8KernelName() {
+        return "sse2";
+    }
+
+    // sign extension of the low or high 8 bytes to int16
+    inline __m128i WidenLow(__m128i v) {
+        return _mm_unpacklo_epi8(v, _mm_cmpgt_epi8(_mm_setzero_si128(), v));
+    }
+
+    inline __m128i WidenHigh(__m128i v) {
+        return _mm_unpackhi_epi8(v, _mm_cmpgt_epi8(_mm_setzero_si128(), v));
+    }
+
+    int32_t Int8DotProduct(const int8_t *v1, const int8_t *v2, size_t nb_dim) {
+        __m128i acc = _mm_setzero_si128();
+        size_t i = 0;
+        for (; i + 16 <= nb_dim; i += 16) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v1 + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v2 + i));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(WidenLow(a), WidenLow(b)));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(WidenHigh(a), WidenHigh(b)));
+        }
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+        int32_t result = _mm_cvtsi128_si32(acc);
+        for (; i < nb_dim; ++i) {
+            result += int32_t(v1[i]) * v2[i];
+        }
+        return result;
+    }
+#else
+    const char* GetInt8KernelName() {
+        return "scalar";
+    }
+
+    int32_t Int8DotProduct(const int8_t *v1, const int8_t *v2, size_t nb_dim) {
+        int32_t result = 0;
+        for (size_t i = 0; i < nb_dim; ++i) {
+            result += int32_t(v1[i]) * v2[i];
+        }
+        return result;
+    }
+#endif
+
+    double MixedDotProduct(const int8_t *v1, const double *v2, size_t nb_dim) {
+        double acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+        size_t i = 0;
+        for (; i + 4 <= nb_dim; i += 4) {
+            acc0 += v1[i] * v2[i];
+            acc1 += v1[i + 1] * v2[i + 1];
+            acc2 += v1[i + 2] * v2[i + 2];
+            acc3 += v1[i + 3] * v2[i + 3];
+        }
+        for (; i < nb_dim; ++i) {
+            acc0 += v1[i] * v2[i];
+        }
+        return (acc0 + acc1) + (acc2 + acc3);
+    }
+
+    QuantizedMulticlassSVM::QuantizedMulticlassSVM(const std::vector<QuantizedModel> &models,
+                                                   const std::vector<int> &labels)
+    :models_(models), labels_(labels) {
+        if (models_.size() != labels_.size() * (labels_.size() - 1) / 2) {
+            throw Exception("number of models doesn't match number of labels");
+        }
+        for (size_t i = 0; i < models_.size(); ++i) {
+            ValidateDimensions(GetDim(), models_[i].weights.size(), i);
+        }
+    }
+
+    QuantizedMulticlassSVM QuantizedMulticlassSVM::Quantize(const MulticlassSVM &svm) {
+        const auto &models = svm.GetModels();
+        const auto &biases = svm.GetBiases();
+        if (models.empty()) {
+            throw Exception("there are no models");
+        }
+
+        std::vector<QuantizedModel> quantized(models.size());
+        for (size_t i = 0; i < models.size(); ++i) {
+            quantized[i].weights.resize(models[i].size());
+            quantized[i].scale = QuantizeValues(models[i].data(), models[i].size(),
+                                                quantized[i].weights.data());
+            quantized[i].bias = biases.at(i);
+        }
+        return QuantizedMulticlassSVM(quantized, svm.GetLabels());
+    }
+
+    const std::vector<QuantizedModel>& QuantizedMulticlassSVM::GetModels() const {
+        return models_;
+    }
+
+    const std::vector<int>& QuantizedMulticlassSVM::GetLabels() const {
+        return labels_;
+    }
+
+    size_t QuantizedMulticlassSVM::GetDim() const {
+        return models_.empty() ? 0 : models_[0].weights.size();
+    }
+
+    std::vector<int> QuantizedMulticlassSVM::Predict(const matrix &x, bool quantize_inputs) const {
+        if (x.empty()) {
+            return {};
+        }
+
+        if (models_.empty()) {
+            throw Exception("there are no models");
+        }
+
+        const size_t nb_dim = GetDim();
+        const size_t nb_labels = labels_.size();
+        std::vector<int> predictions(x.size());
+
+        ParallelFor(x.size(), PREDICT_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t) {
+            std::vector<int8_t> input(nb_dim);
+            VoteAccumulator votes(nb_labels);
+            for (size_t k = begin; k < end; ++k) {
+                ValidateDimensions(nb_dim, x[k].size(), k);
+                double input_scale = quantize_inputs ?
+                    QuantizeValues(x[k].data(), nb_dim, input.data()) : 1;
+
+                votes.Reset();
+                size_t idx = 0;
+                for (size_t i = 0; i < nb_labels; ++i) {
+                    for (size_t j = i + 1; j < nb_labels; ++j) {
+                        const QuantizedModel &model = models_[idx++];
+                        double dot_product = quantize_inputs ?
+                            Int8DotProduct(model.weights.data(), input.data(), nb_dim) :
+                            MixedDotProduct(model.weights.data(), x[k].data(), nb_dim);
+                        votes.Add(i, j, dot_product * model.scale * input_scale + model.bias);
+                    }
+                }
+                predictions[k] = labels_[votes.GetWinner()];
+            }
+        });
+
+        return predictions;
+    }
+} // namespace ml
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "multiclass_svm.h"
+
+
+namespace ml {
+
+/**
+ * Binary model with weights quantized symmetrically to int8,
+ * weight i is approximately scale * weights[i]
+ */
+struct QuantizedModel {
+    std::vector<int8_t> weights;
+    double scale = 0;
+    double bias = 0;
+};
+
+/**
+ * Post-training int8 quantization of a "one vs one" MulticlassSVM,
+ * one scale per binary model.
+ */
+class QuantizedMulticlassSVM {
+public:
+    QuantizedMulticlassSVM() {}
+    QuantizedMulticlassSVM(const std::vector<QuantizedModel> &models,
+                           const std::vector<int> &labels);
+
+    static QuantizedMulticlassSVM Quantize(const MulticlassSVM &svm);
+
+    const std::vector<QuantizedModel>& GetModels() const;
+    const std::vector<int>& GetLabels() const;
+    size_t GetDim() const;
+
+    /**
+     * With quantize_inputs every sample is quantized to int8 with its own
+     * scale and scored with the integer kernel, otherwise weights are
+     * applied to the double inputs directly.
+     */
+    std::vector<int> Predict(const std::vector<std::vector<double>> &x,
+                             bool quantize_inputs = true) const;
+
+private:
+    std::vector<QuantizedModel> models_;
+    std::vector<int> labels_;
+};
+
+// symmetric quantization of nb_dim values, returns the scale
+double QuantizeValues(const double *values, size_t nb_dim, int8_t *out);
+
+/**
+ * Exact integer dot product, VNNI, AVX2 or SSE2 depending on the build.
+ * int32 accumulators limit nb_dim to about 130000.
+ */
+int32_t Int8DotProduct(const int8_t *v1, const int8_t *v2, size_t nb_dim);
+
+double MixedDotProduct(const int8_t *v1, const double *v2, size_t nb_dim);
+
+// instruction set Int8DotProduct was compiled for
+const char* GetInt8KernelName();
+
+} // namespace ml
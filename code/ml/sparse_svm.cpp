@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "exception.h"
+#include "logger.h"
+#include "multiclass_svm.h"
+#include "parallel.h"
+#include "sparse_svm.h"
+#include "util.h"
+#include "voting.h"
+
+
+namespace ml {
+    typedef std::vector<std::vector<double>> matrix;
+
+    const size_t SPARSE_PREDICT_MIN_CHUNK_SIZE = 64;
+    // bisection steps over sparsity in PruneToAccuracy
+    const int PRUNE_SEARCH_STEPS = 10;
+    const double MAX_SPARSITY = 0.999;
+
+    double GatherDotProduct(const uint32_t *indices,
+                            const double *values,
+                            size_t nb_values,
+                            const double *x) {
+        size_t i = 0;
+        double result = 0;
+#if defined(__AVX2__)
+        __m256d acc0 = _mm256_setzero_pd();
+        __m256d acc1 = _mm256_setzero_pd();
+        for (; i + 8 <= nb_values; i += 8) {
+            __m128i idx0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+            __m128i idx1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i + 4));
+            __m256d x0 = _mm256_i32gather_pd(x, idx0, 8);
+            __m256d x1 = _mm256_i32gather_pd(x, idx1, 8);
+            acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(x0, _mm256_loadu_pd(values + i)));
+            acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(x1, _mm256_loadu_pd(values + i + 4)));
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, _mm256_add_pd(acc0, acc1));
+        result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+        double acc0 = 0, acc1 = 0, acc2 = 0, acc3 = 0;
+        for (; i + 4 <= nb_values; i += 4) {
+            acc0 += values[i] * x[indices[i]];
+            acc1 += values[i + 1] * x[indices[i + 1]];
+            acc2 += values[i + 2] * x[indices[i + 2]];
+            acc3 += values[i + 3] * x[indices[i + 3]];
+        }
+        result = (acc0 + acc1) + (acc2 + acc3);
+#endif
+        for (; i < nb_values; ++i) {
+            result += values[i] * x[indices[i]];
+        }
+        return result;
+    }
+
+    SparseMulticlassSVM::SparseMulticlassSVM(const std::vector<SparseModel> &models,
+                                             const std::vector<int> &labels,
+                                             size_t nb_dim)
+    :models_(models), labels_(labels), nb_dim_(nb_dim) {
+        if (models_.size() != labels_.size() * (labels_.size() - 1) / 2) {
+            throw Exception("number of models doesn't match number of labels");
+        }
+        for (auto &model : models_) {
+            if (model.indices.size() != model.values.size()) {
+                throw Exception("sparse model has different number of indices and values");
+            }
+            for (auto index : model.indices) {
+                if (index >= nb_dim_) {
+                    throw Exception("sparse model index " + std::to_string(index) + " is out of range");
+                }
+            }
+        }
+    }
+
+    SparseModel PruneModel(const std::vector<double> &weights, double bias, double sparsity) {
+        size_t nb_kept = weights.size() - static_cast<size_t>(std::floor(sparsity * weights.size()));
+
+        std::vector<uint32_t> order(weights.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::nth_element(order.begin(), order.begin() + nb_kept, order.end(),
+                         [&](uint32_t a, uint32_t b) {
+                             return std::fabs(weights[a]) > std::fabs(weights[b]);
+                         });
+        order.resize(nb_kept);
+        // ascending indices keep gathers close to sequential
+        std::sort(order.begin(), order.end());
+
+        SparseModel model;
+        model.bias = bias;
+        for (auto index : order) {
+            if (weights[index] != 0) {
+                model.indices.push_back(index);
+                model.values.push_back(weights[index]);
+            }
+        }
+        return model;
+    }
+
+    SparseMulticlassSVM SparseMulticlassSVM::Prune(const MulticlassSVM &svm, double sparsity) {
+        const auto &models = svm.GetModels();
+        const auto &biases = svm.GetBiases();
+        if (models.empty()) {
+            throw Exception("there are no models");
+        }
+        if (sparsity < 0 || sparsity >= 1) {
+            throw Exception("sparsity must be in [0, 1), got " + std::to_string(sparsity));
+        }
+
+        std::vector<SparseModel> sparse_models(models.size());
+        for (size_t i = 0; i < models.size(); ++i) {
+            sparse_models[i] = PruneModel(models[i], biases.at(i), sparsity);
+        }
+        return SparseMulticlassSVM(sparse_models, svm.GetLabels(), models[0].size());
+    }
+
+    SparseMulticlassSVM SparseMulticlassSVM::PruneToAccuracy(const MulticlassSVM &svm,
+                                                             const matrix &x,
+                                                             const std::vector<int> &y,
+                                                             double max_accuracy_drop) {
+        if (x.size() != y.size()) {
+            throw Exception("x y have different size");
+        }
+
+        double target = Accuracy(svm.Predict(x), y) - max_accuracy_drop;
+
+        // accuracy is assumed to decrease with sparsity
+        double low = 0;
+        double high = MAX_SPARSITY;
+        SparseMulticlassSVM best = Prune(svm, low);
+        for (int step = 0; step < PRUNE_SEARCH_STEPS; ++step) {
+            double sparsity = 0.5 * (low + high);
+            SparseMulticlassSVM candidate = Prune(svm, sparsity);
+            double accuracy = Accuracy(candidate.Predict(x), y);
+            Log(LogLevel::Info) << "sparsity " << sparsity << ", accuracy " << accuracy;
+            if (accuracy >= target) {
+                best = candidate;
+                low = sparsity;
+            } else {
+                high = sparsity;
+            }
+        }
+        return best;
+    }
+
+    const std::vector<SparseModel>& SparseMulticlassSVM::GetModels() const {
+        return models_;
+    }
+
+    const std::vector<int>& SparseMulticlassSVM::GetLabels() const {
+        return labels_;
+    }
+
+    size_t SparseMulticlassSVM::GetDim() const {
+        return nb_dim_;
+    }
+
+    size_t SparseMulticlassSVM::GetNbNonZero() const {
+        size_t nb_non_zero = 0;
+        for (auto &model : models_) {
+            nb_non_zero += model.values.size();
+        }
+        return nb_non_zero;
+    }
+
+    std::vector<int> SparseMulticlassSVM::Predict(const matrix &x) const {
+        if (x.empty()) {
+            return {};
+        }
+
+        if (models_.empty()) {
+            throw Exception("there are no models");
+        }
+
+        const size_t nb_labels = labels_.size();
+        std::vector<int> predictions(x.size());
+
+        ParallelFor(x.size(), SPARSE_PREDICT_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t) {
+            VoteAccumulator votes(nb_labels);
+            for (size_t k = begin; k < end; ++k) {
+                ValidateDimensions(nb_dim_, x[k].size(), k);
+
+                votes.Reset();
+                size_t idx = 0;
+                for (size_t i = 0; i < nb_labels; ++i) {
+                    for (size_t j = i + 1; j < nb_labels; ++j) {
+                        const SparseModel &model = models_[idx++];
+                        double score = GatherDotProduct(model.indices.data(), model.values.data(),
+                                                        model.values.size(), x[k].data());
+                        votes.Add(i, j, score + model.bias);
+                    }
+                }
+                predictions[k] = labels_[votes.GetWinner()];
+            }
+        });
+
+        return predictions;
+    }
+} // namespace ml
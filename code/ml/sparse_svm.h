@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "multiclass_svm.h"
+
+
+namespace ml {
+
+// binary model keeping only non zero weights, indices are sorted
+struct SparseModel {
+    std::vector<uint32_t> indices;
+    std::vector<double> values;
+    double bias = 0;
+};
+
+/**
+ * "one vs one" MulticlassSVM with magnitude pruned binary models,
+ * scored with a gather based kernel.
+ */
+class SparseMulticlassSVM {
+public:
+    SparseMulticlassSVM() :nb_dim_(0) {}
+    SparseMulticlassSVM(const std::vector<SparseModel> &models,
+                        const std::vector<int> &labels,
+                        size_t nb_dim);
+
+    /**
+     * Keeps the largest (by magnitude) weights of every binary model,
+     * sparsity is the share of weights which are dropped.
+     */
+    static SparseMulticlassSVM Prune(const MulticlassSVM &svm, double sparsity);
+
+    /**
+     * Highest sparsity whose accuracy on (x, y) is at most
+     * max_accuracy_drop below the dense model.
+     */
+    static SparseMulticlassSVM PruneToAccuracy(const MulticlassSVM &svm,
+                                               const std::vector<std::vector<double>> &x,
+                                               const std::vector<int> &y,
+                                               double max_accuracy_drop);
+
+    const std::vector<SparseModel>& GetModels() const;
+    const std::vector<int>& GetLabels() const;
+    size_t GetDim() const;
+    size_t GetNbNonZero() const;
+
+    std::vector<int> Predict(const std::vector<std::vector<double>> &x) const;
+
+private:
+    std::vector<SparseModel> models_;
+    std::vector<int> labels_;
+    size_t nb_dim_;
+};
+
+// sum of values[i] * x[indices[i]], AVX2 gathers when available
+double GatherDotProduct(const uint32_t *indices,
+                        const double *values,
+                        size_t nb_values,
+                        const double *x);
+
+} // namespace ml
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.h"
+
+
+namespace ml {
+    struct ThreadPool::Batch {
+        const std::function<void(size_t)> *fn;
+        size_t nb_tasks;
+        std::atomic<size_t> next;
+
+        std::mutex mutex;
+        std::condition_variable finished;
+        size_t nb_done;
+        std::exception_ptr error;
+    };
+
+    ThreadPool::ThreadPool(size_t nb_workers) :stop_(false) {
+        for (size_t i = 0; i < nb_workers; ++i) {
+            workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        has_work_.notify_all();
+        for (auto &worker : workers_) {
+            worker.join();
+        }
+    }
+
+    size_t ThreadPool::GetNumWorkers() const {
+        return workers_.size();
+    }
+
+    bool ThreadPool::RunOne(Batch &batch) {
+        size_t task = batch.next.fetch_add(1);
+        if (task >= batch.nb_tasks) {
+            return false;
+        }
+
+        std::exception_ptr error;
+        try {
+            (*batch.fn)(task);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(batch.mutex);
+        if (error && !batch.error) {
+            batch.error = error;
+        }
+        if (++batch.nb_done == batch.nb_tasks) {
+            batch.finished.notify_all();
+        }
+        return true;
+    }
+
+    void ThreadPool::Run(size_t nb_tasks, const std::function<void(size_t)> &fn) {
+        if (nb_tasks == 0) {
+            return;
+        }
+
+        if (nb_tasks == 1 || workers_.empty()) {
+            for (size_t task = 0; task < nb_tasks; ++task) {
+                fn(task);
+            }
+            return;
+        }
+
+        auto batch = std::make_shared<Batch>();
+        batch->fn = &fn;
+        batch->nb_tasks = nb_tasks;
+        batch->next.store(0);
+        batch->nb_done = 0;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batches_.push_back(batch);
+        }
+        has_work_.notify_all();
+
+        // calling thread takes tasks of its own batch until none are left
+        while (RunOne(*batch)) {}
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = std::find(batches_.begin(), batches_.end(), batch);
+            if (it != batches_.end()) {
+                batches_.erase(it);
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(batch->mutex);
+        batch->finished.wait(lock, [&]() { return batch->nb_done == batch->nb_tasks; });
+        if (batch->error) {
+            std::rethrow_exception(batch->error);
+        }
+    }
+
+    void ThreadPool::WorkerLoop() {
+        while (true) {
+            std::shared_ptr<Batch> batch;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                has_work_.wait(lock, [&]() { return stop_ || !batches_.empty(); });
+                if (batches_.empty()) {
+                    return;
+                }
+                batch = batches_.front();
+            }
+
+            if (!RunOne(*batch)) {
+                // every task is taken, batch leaves the queue
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!batches_.empty() && batches_.front() == batch) {
+                    batches_.pop_front();
+                }
+            }
+        }
+    }
+
+    ThreadPool& GetSharedThreadPool() {
+        static ThreadPool pool(std::max<unsigned>(std::thread::hardware_concurrency(), 1) - 1);
+        return pool;
+    }
+} // namespace ml
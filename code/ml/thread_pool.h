@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace ml {
+
+/**
+ * Fixed set of worker threads executing batches of indexed tasks.
+ * The thread calling Run works on its own batch too, so nested
+ * Run calls from inside a task can't deadlock.
+ */
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t nb_workers);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool& operator=(const ThreadPool &) = delete;
+
+    size_t GetNumWorkers() const;
+
+    /**
+     * Calls fn(i) for every i in [0, nb_tasks) and returns once all of them
+     * are finished. First exception thrown by a task is rethrown.
+     */
+    void Run(size_t nb_tasks, const std::function<void(size_t)> &fn);
+
+private:
+    struct Batch;
+
+    static bool RunOne(Batch &batch);
+    void WorkerLoop();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::shared_ptr<Batch>> batches_;
+    std::mutex mutex_;
+    std::condition_variable has_work_;
+    bool stop_;
+};
+
+// pool shared by all parallel algorithms, one worker less than hardware threads
+ThreadPool& GetSharedThreadPool();
+
+} // namespace ml
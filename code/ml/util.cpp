@@ -1,23 +1,35 @@
 #include <fstream>
-#include <iostream>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <utility>
 #include <vector>
 #include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/core.hpp>
 
+#include <sys/stat.h>
+
 #include "exception.h"
+#include "kernels.h"
+#include "logger.h"
+#include "mapped_file.h"
+#include "memory.h"
+#include "metrics.h"
 #include "multiclass_svm.h"
+#include "parallel.h"
+#include "pca.h"
+#include "quadratic.h"
+#include "quantization.h"
+#include "sparse_svm.h"
 #include "util.h"
 
 
 namespace ml {
-    const size_t REPORT_THRESHOLD = 1000;
-
     void ValidateBinaryLabels(const std::vector<int> &y) {
         for (size_t i = 0; i < y.size(); ++i) {
             if (y[i] != 1 && y[i] != -1) {
@@ -60,15 +72,22 @@ namespace ml {
         }
     }
 
-    double DotProduct(const std::vector<double> v1, const std::vector<double> v2) {
-        double dot_product = 0;
-        for (size_t i = 0; i < v1.size(); ++i) {
-            dot_product += v1[i] * v2[i];
+    double DotProduct(const std::vector<double> &v1, const std::vector<double> &v2) {
+        // kernel lookup is cached, consecutive calls share the dimensionality,
+        // a registration after the lookup changes the version and is picked up
+        thread_local size_t cached_dim = 0;
+        thread_local size_t cached_version = 0;
+        thread_local DotProductKernel cached_kernel = &GenericDotProduct;
+        size_t version = GetKernelRegistryVersion();
+        if (cached_dim != v1.size() || cached_version != version) {
+            cached_dim = v1.size();
+            cached_version = version;
+            cached_kernel = GetDotProductKernel(cached_dim);
         }
-        return dot_product;
+        return cached_kernel(v1.data(), v2.data(), v1.size());
     }
 
-    Data ReadData(const std::string &data_path, bool load_label) {
+    Data ReadImages(const std::string &data_path, bool load_label) {
         std::ifstream infile(data_path);  
         std::string image_path, line;
         int label = -1;
@@ -76,6 +95,7 @@ namespace ml {
         std::vector<int> y;
         std::vector<std::string> image_paths;
         size_t counter = 0;
+        ProgressReporter progress("loaded images");
 
         while (std::getline(infile, line)) {
             std::istringstream iss(line);
@@ -85,9 +105,7 @@ namespace ml {
                 iss >> label;
             }
 
-            if (counter % REPORT_THRESHOLD == 0) {
-                std::cout << "loaded images " << counter << std::endl;
-            }
+            progress.Update(counter);
 
             cv::Mat mat = cv::imread(image_path, CV_LOAD_IMAGE_GRAYSCALE);
             std::vector<double> row;
@@ -103,36 +121,84 @@ namespace ml {
             counter++;
         }
 
-        std::cout << "upload all images from " << data_path << std::endl;
-        std::cout << "number of images " << x.size() << std::endl;
-        std::cout << "dimensionality " << x.at(0).size() << std::endl;
-        std::cout << "number of labels "  << y.size() << std::endl;
-        std::cout << std::endl; 
+        Log(LogLevel::Info) << "upload all images from " << data_path;
+        Log(LogLevel::Info) << "number of images " << x.size();
+        Log(LogLevel::Info) << "dimensionality " << (x.empty() ? 0 : x[0].size());
+        Log(LogLevel::Info) << "number of labels "  << y.size();
 
         return std::make_tuple(x, y, image_paths);
     }
 
+    void ReadDescription(const std::string &data_path,
+                         bool load_label,
+                         std::vector<std::string> &image_paths,
+                         std::vector<int> &labels) {
+        std::ifstream infile(data_path);
+        if (!infile) {
+            throw Exception("can't open " + data_path);
+        }
+
+        image_paths.clear();
+        labels.clear();
+        std::string line, image_path;
+        while (std::getline(infile, line)) {
+            std::istringstream iss(line);
+            int label = -1;
+            if (!(iss >> image_path)) {
+                continue;
+            }
+            if (load_label) {
+                iss >> label;
+            }
+            image_paths.push_back(image_path);
+            labels.push_back(label);
+        }
+    }
+
+    std::vector<std::string> ReadImagePaths(const std::string &data_path) {
+        std::vector<std::string> image_paths;
+        std::vector<int> labels;
+        ReadDescription(data_path, false, image_paths, labels);
+        return image_paths;
+    }
+
+    std::vector<uint8_t> ReadImage(const std::string &image_path) {
+        cv::Mat mat = cv::imread(image_path, CV_LOAD_IMAGE_GRAYSCALE);
+        if (mat.empty()) {
+            throw Exception("can't read image " + image_path);
+        }
+
+        std::vector<uint8_t> pixels(mat.rows * mat.cols);
+        for (int i = 0; i < mat.rows; ++i) {
+            for (int j = 0; j < mat.cols; ++j) {
+                pixels[i * mat.cols + j] = mat.at<uchar>(i, j);
+            }
+        }
+        return pixels;
+    }
+
     void SaveModel(const ml::MulticlassSVM &svm, const std::string &save_path) {
-        std::cout << "saving model to " << save_path << std::endl;
+        Log(LogLevel::Info) << "saving model to " << save_path;
+        ScopedTimer timer("save_model");
 
         std::ofstream output(save_path);
 
-        output << svm.GetModels().size() << " " << svm.GetModels()[0].size() << std::endl;
+        output << svm.GetModels().size() << " " << svm.GetModels()[0].size() << '\n';
         for (auto &model : svm.GetModels()) {
             for (auto val : model) {
                 output << val << " ";
             }
-            output << std::endl;
+            output << '\n';
         }
 
-        output << svm.GetBiases().size() << std::endl;
+        output << svm.GetBiases().size() << '\n';
         for (auto bias : svm.GetBiases()) {
-            output << bias << std::endl;
+            output << bias << '\n';
         }
 
-        output << svm.GetLabels().size() << std::endl;
+        output << svm.GetLabels().size() << '\n';
         for (auto label : svm.GetLabels()) {
-            output << label << std::endl;
+            output << label << '\n';
         }
     }
 
@@ -148,8 +214,8 @@ namespace ml {
             );
         }
 
-        std::cout << "number of binarySVM models " << models_size << std::endl;
-        std::cout << "number of dimensions in model " << nb_dim << std::endl;
+        Log(LogLevel::Info) << "number of binarySVM models " << models_size;
+        Log(LogLevel::Info) << "number of dimensions in model " << nb_dim;
 
         std::vector<std::vector<double>> models(models_size);
         for (size_t i = 0; i < models_size; ++i) {
@@ -175,7 +241,7 @@ namespace ml {
         }
 
         std::vector<double> biases(nb_biases);
-        std::cout << "number of biases " << nb_biases << std::endl;
+        Log(LogLevel::Info) << "number of biases " << nb_biases;
         for (size_t i = 0; i < nb_biases; ++i) {
             double bias_value;
             if (!(model_file >> bias_value)) {
@@ -194,7 +260,7 @@ namespace ml {
             );
         }
 
-        std::cout << "model has " << nb_labels << " labels" << std::endl;
+        Log(LogLevel::Info) << "model has " << nb_labels << " labels";
 
         std::vector<int> labels(nb_labels);
         for (size_t i = 0; i < nb_labels; ++i) {
@@ -208,18 +274,374 @@ namespace ml {
             labels[i] = label;
         }
 
-        std::cout << "model defined for labels:";
-        for (auto label : labels) {
-            std::cout << " " << label;
+        {
+            Log line(LogLevel::Info);
+            line << "model defined for labels:";
+            for (auto label : labels) {
+                line << " " << label;
+            }
         }
-        std::cout << std::endl;
 
-        std::cout << "finish reading model file " << model_path << std::endl;
+        Log(LogLevel::Info) << "finish reading model file " << model_path;
 
         MulticlassSVM svm(models, biases, labels);
         return svm;
     }
 
+    const char QUANTIZED_MODEL_MAGIC[4] = {'Q', 'S', 'V', 'M'};
+    const uint32_t QUANTIZED_MODEL_VERSION = 1;
+
+    template <class T>
+    void WriteBinary(std::ofstream &output, const T &value) {
+        output.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <class T>
+    void ReadBinary(std::ifstream &input, T &value, const std::string &path) {
+        if (!input.read(reinterpret_cast<char*>(&value), sizeof(T))) {
+            throw std::length_error("incorrect model file " + path + ", it is truncated");
+        }
+    }
+
+    void SaveQuantizedModel(const QuantizedMulticlassSVM &svm, const std::string &save_path) {
+        Log(LogLevel::Info) << "saving quantized model to " << save_path;
+        ScopedTimer timer("save_quantized_model");
+
+        std::ofstream output(save_path, std::ios::binary);
+        output.write(QUANTIZED_MODEL_MAGIC, sizeof(QUANTIZED_MODEL_MAGIC));
+        WriteBinary(output, QUANTIZED_MODEL_VERSION);
+        WriteBinary(output, uint64_t(svm.GetModels().size()));
+        WriteBinary(output, uint64_t(svm.GetDim()));
+        for (auto &model : svm.GetModels()) {
+            WriteBinary(output, model.scale);
+            WriteBinary(output, model.bias);
+            output.write(reinterpret_cast<const char*>(model.weights.data()), model.weights.size());
+        }
+
+        WriteBinary(output, uint64_t(svm.GetLabels().size()));
+        for (auto label : svm.GetLabels()) {
+            WriteBinary(output, int32_t(label));
+        }
+    }
+
+    void ReadHeader(std::ifstream &input,
+                    const char (&expected_magic)[4],
+                    uint32_t expected_version,
+                    const std::string &path,
+                    const std::string &kind) {
+        char magic[sizeof(expected_magic)];
+        uint32_t version = 0;
+        if (!input.read(magic, sizeof(magic)) ||
+            !std::equal(magic, magic + sizeof(magic), expected_magic) ||
+            !input.read(reinterpret_cast<char*>(&version), sizeof(version)) ||
+            version != expected_version) {
+            throw std::length_error("incorrect model file " + path + ", it is not " + kind);
+        }
+    }
+
+    QuantizedMulticlassSVM ReadQuantizedModel(const std::string &model_path) {
+        std::ifstream input(model_path, std::ios::binary);
+        ReadHeader(input, QUANTIZED_MODEL_MAGIC, QUANTIZED_MODEL_VERSION, model_path, "quantized model");
+
+        uint64_t nb_models, nb_dim, nb_labels;
+        ReadBinary(input, nb_models, model_path);
+        ReadBinary(input, nb_dim, model_path);
+        Log(LogLevel::Info) << "number of quantized binarySVM models " << nb_models;
+        Log(LogLevel::Info) << "number of dimensions in model " << nb_dim;
+
+        std::vector<QuantizedModel> models(nb_models);
+        for (auto &model : models) {
+            ReadBinary(input, model.scale, model_path);
+            ReadBinary(input, model.bias, model_path);
+            model.weights.resize(nb_dim);
+            if (!input.read(reinterpret_cast<char*>(model.weights.data()), nb_dim)) {
+                throw std::length_error("incorrect model file " + model_path + ", it is truncated");
+            }
+        }
+
+        ReadBinary(input, nb_labels, model_path);
+        std::vector<int> labels(nb_labels);
+        for (auto &label : labels) {
+            int32_t value;
+            ReadBinary(input, value, model_path);
+            label = value;
+        }
+
+        Log(LogLevel::Info) << "finish reading quantized model file " << model_path;
+        return QuantizedMulticlassSVM(models, labels);
+    }
+
+    const char SPARSE_MODEL_MAGIC[4] = {'S', 'S', 'V', 'M'};
+    const uint32_t SPARSE_MODEL_VERSION = 1;
+
+    void SaveSparseModel(const SparseMulticlassSVM &svm, const std::string &save_path) {
+        Log(LogLevel::Info) << "saving sparse model to " << save_path;
+        ScopedTimer timer("save_sparse_model");
+
+        std::ofstream output(save_path, std::ios::binary);
+        output.write(SPARSE_MODEL_MAGIC, sizeof(SPARSE_MODEL_MAGIC));
+        WriteBinary(output, SPARSE_MODEL_VERSION);
+        WriteBinary(output, uint64_t(svm.GetModels().size()));
+        WriteBinary(output, uint64_t(svm.GetDim()));
+        for (auto &model : svm.GetModels()) {
+            WriteBinary(output, model.bias);
+            WriteBinary(output, uint64_t(model.values.size()));
+            output.write(reinterpret_cast<const char*>(model.indices.data()),
+                         model.indices.size() * sizeof(uint32_t));
+            output.write(reinterpret_cast<const char*>(model.values.data()),
+                         model.values.size() * sizeof(double));
+        }
+
+        WriteBinary(output, uint64_t(svm.GetLabels().size()));
+        for (auto label : svm.GetLabels()) {
+            WriteBinary(output, int32_t(label));
+        }
+    }
+
+    SparseMulticlassSVM ReadSparseModel(const std::string &model_path) {
+        std::ifstream input(model_path, std::ios::binary);
+        ReadHeader(input, SPARSE_MODEL_MAGIC, SPARSE_MODEL_VERSION, model_path, "sparse model");
+
+        uint64_t nb_models, nb_dim, nb_labels;
+        ReadBinary(input, nb_models, model_path);
+        ReadBinary(input, nb_dim, model_path);
+        Log(LogLevel::Info) << "number of sparse binarySVM models " << nb_models;
+        Log(LogLevel::Info) << "number of dimensions in model " << nb_dim;
+
+        std::vector<SparseModel> models(nb_models);
+        for (auto &model : models) {
+            uint64_t nb_values;
+            ReadBinary(input, model.bias, model_path);
+            ReadBinary(input, nb_values, model_path);
+            if (nb_values > nb_dim) {
+                throw std::length_error("incorrect model file " + model_path +
+                                        ", model has more values than dimensions");
+            }
+            model.indices.resize(nb_values);
+            model.values.resize(nb_values);
+            if (!input.read(reinterpret_cast<char*>(model.indices.data()), nb_values * sizeof(uint32_t)) ||
+                !input.read(reinterpret_cast<char*>(model.values.data()), nb_values * sizeof(double))) {
+                throw std::length_error("incorrect model file " + model_path + ", it is truncated");
+            }
+        }
+
+        ReadBinary(input, nb_labels, model_path);
+        std::vector<int> labels(nb_labels);
+        for (auto &label : labels) {
+            int32_t value;
+            ReadBinary(input, value, model_path);
+            label = value;
+        }
+
+        Log(LogLevel::Info) << "finish reading sparse model file " << model_path;
+        return SparseMulticlassSVM(models, labels, nb_dim);
+    }
+
+    const char DATA_CACHE_MAGIC[4] = {'M', 'D', 'S', 'C'};
+    const uint32_t DATA_CACHE_VERSION = 1;
+    const size_t CONVERT_MIN_CHUNK_SIZE = 1024;
+
+    struct DataCacheHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t source_size;
+        int64_t source_mtime;
+        uint64_t source_hash;
+        uint64_t nb_images;
+        uint64_t nb_dim;
+        uint32_t has_labels;
+        uint32_t reserved;
+    };
+
+    uint64_t HashBytes(const void *data, size_t size, uint64_t hash) {
+        // FNV-1a
+        const uint8_t *bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    uint64_t HashFile(const std::string &path, uint64_t hash) {
+        MappedFile file(path);
+        return HashBytes(file.GetData(), file.GetSize(), hash);
+    }
+
+    bool IsValidOffsetTable(const std::vector<uint64_t> &offsets, uint64_t total) {
+        if (offsets.empty() || offsets.front() != 0 || offsets.back() != total) {
+            return false;
+        }
+        for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+            if (offsets[i] > offsets[i + 1]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool FillSourceInfo(const std::string &data_path, DataCacheHeader &header) {
+        struct stat info;
+        if (stat(data_path.c_str(), &info) != 0) {
+            return false;
+        }
+        header.source_size = info.st_size;
+        header.source_mtime = info.st_mtim.tv_sec * 1000000000LL + info.st_mtim.tv_nsec;
+        header.source_hash = HashFile(data_path);
+        return true;
+    }
+
+    void WriteDataCache(const std::string &cache_path, const std::string &data_path,
+                        bool load_label, const Data &data) {
+        auto &x = std::get<0>(data);
+        auto &y = std::get<1>(data);
+        auto &image_paths = std::get<2>(data);
+
+        DataCacheHeader header = {};
+        std::copy(DATA_CACHE_MAGIC, DATA_CACHE_MAGIC + sizeof(DATA_CACHE_MAGIC), header.magic);
+        header.version = DATA_CACHE_VERSION;
+        header.nb_images = x.size();
+        header.nb_dim = x.empty() ? 0 : x[0].size();
+        header.has_labels = load_label;
+        if (x.empty() || !FillSourceInfo(data_path, header)) {
+            return;
+        }
+
+        std::vector<uint8_t> pixels(header.nb_images * header.nb_dim);
+        for (size_t i = 0; i < x.size(); ++i) {
+            if (x[i].size() != header.nb_dim) {
+                Log(LogLevel::Warning) << "images have different sizes, data is not cached";
+                return;
+            }
+            std::copy(x[i].begin(), x[i].end(), pixels.begin() + i * header.nb_dim);
+        }
+
+        std::vector<int32_t> labels(y.begin(), y.end());
+        std::vector<uint64_t> offsets(1, 0);
+        for (auto &image_path : image_paths) {
+            offsets.push_back(offsets.back() + image_path.size());
+        }
+
+        // written aside and renamed, a concurrent reader never sees a partial cache
+        std::string tmp_path = cache_path + ".tmp";
+        {
+            std::ofstream output(tmp_path, std::ios::binary);
+            WriteBinary(output, header);
+            output.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+            output.write(reinterpret_cast<const char*>(labels.data()), labels.size() * sizeof(int32_t));
+            output.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+            for (auto &image_path : image_paths) {
+                output.write(image_path.data(), image_path.size());
+            }
+            if (!output) {
+                Log(LogLevel::Warning) << "can't write data cache " << cache_path;
+                std::remove(tmp_path.c_str());
+                return;
+            }
+        }
+        std::rename(tmp_path.c_str(), cache_path.c_str());
+        Log(LogLevel::Info) << "saved data cache " << cache_path;
+    }
+
+    // false if the cache is missing, stale or damaged
+    bool ReadDataCache(const std::string &cache_path, const std::string &data_path,
+                       bool load_label, Data &data) {
+        struct stat info;
+        if (stat(cache_path.c_str(), &info) != 0) {
+            return false;
+        }
+
+        MappedFile file(cache_path);
+        DataCacheHeader header;
+        if (file.GetSize() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, file.GetData(), sizeof(header));
+
+        DataCacheHeader source = {};
+        if (!std::equal(header.magic, header.magic + sizeof(header.magic), DATA_CACHE_MAGIC) ||
+            header.version != DATA_CACHE_VERSION ||
+            header.has_labels != static_cast<uint32_t>(load_label) ||
+            !FillSourceInfo(data_path, source) ||
+            header.source_size != source.source_size ||
+            header.source_mtime != source.source_mtime ||
+            header.source_hash != source.source_hash) {
+            return false;
+        }
+
+        // sizes are bounded by the file before they are multiplied, a damaged header can't wrap them around
+        const size_t file_size = file.GetSize();
+        if (header.nb_images > file_size / (sizeof(int32_t) + sizeof(uint64_t)) ||
+            (header.nb_images > 0 && header.nb_dim > file_size / header.nb_images)) {
+            return false;
+        }
+        const size_t nb_images = header.nb_images;
+        const size_t nb_dim = header.nb_dim;
+        size_t pixels_size = nb_images * nb_dim;
+        size_t offsets_begin = sizeof(header) + pixels_size + nb_images * sizeof(int32_t);
+        size_t paths_begin = offsets_begin + (nb_images + 1) * sizeof(uint64_t);
+        if (file.GetSize() < paths_begin) {
+            return false;
+        }
+
+        const uint8_t *pixels = file.GetData() + sizeof(header);
+        const uint8_t *labels = pixels + pixels_size;
+        std::vector<uint64_t> offsets(nb_images + 1);
+        std::memcpy(offsets.data(), file.GetData() + offsets_begin, offsets.size() * sizeof(uint64_t));
+        if (!IsValidOffsetTable(offsets, file.GetSize() - paths_begin)) {
+            return false;
+        }
+
+        Matrix x(nb_images);
+        std::vector<int> y(nb_images);
+        std::vector<std::string> image_paths(nb_images);
+        const char *paths = reinterpret_cast<const char*>(file.GetData() + paths_begin);
+        ParallelFor(nb_images, CONVERT_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t) {
+            for (size_t i = begin; i < end; ++i) {
+                x[i].assign(pixels + i * nb_dim, pixels + (i + 1) * nb_dim);
+                int32_t label;
+                std::memcpy(&label, labels + i * sizeof(int32_t), sizeof(label));
+                y[i] = label;
+                image_paths[i].assign(paths + offsets[i], paths + offsets[i + 1]);
+            }
+        });
+
+        Log(LogLevel::Info) << "loaded " << nb_images << " images from data cache " << cache_path;
+        data = std::make_tuple(std::move(x), std::move(y), std::move(image_paths));
+        return true;
+    }
+
+    Data ReadData(const std::string &data_path, bool load_label, bool use_cache) {
+        ScopedTimer timer("read_data");
+        std::string cache_path = data_path + ".cache";
+        Data data;
+        if (use_cache && ReadDataCache(cache_path, data_path, load_label, data)) {
+            GetMetrics().Increment("data_cache_hits");
+            timer.SetNumItems(std::get<0>(data).size());
+            return data;
+        }
+
+        data = ReadImages(data_path, load_label);
+        if (use_cache) {
+            GetMetrics().Increment("data_cache_misses");
+            WriteDataCache(cache_path, data_path, load_label, data);
+        }
+        timer.SetNumItems(std::get<0>(data).size());
+        return data;
+    }
+
+    double Accuracy(const std::vector<int> &predictions, const std::vector<int> &y) {
+        if (predictions.size() != y.size()) {
+            throw std::invalid_argument("number of predictions doesn't match number of labels");
+        }
+
+        size_t nb_correct = 0;
+        for (size_t i = 0; i < y.size(); ++i) {
+            nb_correct += predictions[i] == y[i];
+        }
+        return y.empty() ? 0 : double(nb_correct) / y.size();
+    }
+
     void SavePredictions(const std::vector<std::string> &images,
                          const std::vector<int> &predictions, 
                          const std::string &output_path) {
@@ -228,20 +650,23 @@ namespace ml {
                 "can't save predictions as number of images doesn't match number of predictions"
             );
         }
-        std::cout << "saving predictions to " << output_path << std::endl;
+        Log(LogLevel::Info) << "saving predictions to " << output_path;
+        ScopedTimer timer("save_predictions");
+        timer.SetNumItems(predictions.size());
 
         std::ofstream output(output_path);
 
         for (size_t i = 0; i < predictions.size(); ++i) {
-            output << images[i] << " " << predictions[i] << std::endl;
+            output << images[i] << " " << predictions[i] << '\n';
         }
 
     }
 
 
     void SaveNormalizationParams(const std::string &path, double mean, double std_dev) {
+        ScopedTimer timer("save_normalization");
         std::ofstream output(path);
-        output << mean << " " << std_dev << std::endl;
+        output << mean << " " << std_dev << '\n';
     }
 
     std::tuple<double, double> LoadNormalizationParams(const std::string &path) {
@@ -256,7 +681,13 @@ namespace ml {
     }
 
     Matrix Normalize(const Matrix &x, double mean, double std_dev) {
-        Matrix result(x);
+        return Normalize(Matrix(x), mean, std_dev);
+    }
+
+    Matrix Normalize(Matrix &&x, double mean, double std_dev) {
+        ScopedTimer timer("normalize");
+        timer.SetNumItems(x.size());
+        Matrix result(std::move(x));
 
         for (size_t i = 0; i < result.size(); ++i) {
             for (size_t j = 0; j < result.at(0).size(); ++j) {
@@ -272,13 +703,17 @@ namespace ml {
         double sum_of_squares = 0;
         double nb = 0;
 
-        for (auto &row : x) {
-            for (auto value : row) {
-                sum += value;
-                // can it overflow ?
-                // 255 * 255 * 60 000
-                sum_of_squares += value * value;
-                ++nb;
+        {
+            // scaling itself is timed by the overload below
+            ScopedTimer timer("normalize_statistics");
+            for (auto &row : x) {
+                for (auto value : row) {
+                    sum += value;
+                    // can it overflow ?
+                    // 255 * 255 * 60 000
+                    sum_of_squares += value * value;
+                    ++nb;
+                }
             }
         }
 
@@ -288,10 +723,11 @@ namespace ml {
 
         Matrix result = Normalize(x, mean, std_dev);
 
-        return std::make_tuple(result, mean, std_dev);
+        return std::make_tuple(std::move(result), mean, std_dev);
     } 
 
     void SavePCA(const std::string &path, cv::PCA &pca) {
+        ScopedTimer timer("save_pca");
 	cv::FileStorage fs(path, cv::FileStorage::WRITE);  
 	pca.write(fs);  
 	fs.release();  
@@ -329,29 +765,51 @@ namespace ml {
         return x;
     }
 
-    cv::PCA CreatePCA(const Matrix &x, double retain_variance) {
-        cv::Mat mat = MatrixToCVMat(x);
-        // opencv pcl will normalize input by default
-        cv::PCA pca(mat, cv::Mat(), cv::PCA::DATA_AS_ROW,retain_variance); 
-        return pca;
+    cv::PCA CreatePCA(const Matrix &x, double retain_variance, PCAMethod method) {
+        ScopedTimer timer("pca_fit");
+        timer.SetNumItems(x.size());
+        // covariance is streamed over rows, no copy of x as cv::Mat is made
+        if (method == PCAMethod::Randomized) {
+            return CreateRandomizedPCA(x, retain_variance);
+        }
+        return CreateCovariancePCA(x, retain_variance);
     }
 
     Matrix ProjectPCA(const cv::PCA &pca,  const Matrix &x) {
+        if (x.empty()) {
+            return {};
+        }
+
+        ScopedTimer timer("pca_project");
+        timer.SetNumItems(x.size());
         cv::Mat mat = MatrixToCVMat(x);
+        TrackedBuffer tracked_mat("pca_project_input", mat.total() * sizeof(double));
         auto result = pca.project(mat);
         return CVMatToMatrix(result);
     }
 
-    Matrix AddQuadraticInteractions(const Matrix &x) {
-        Matrix result(x);
-        for (size_t i = 0; i < x.size(); ++i) {
-            for (size_t j = 0; j < x.at(0).size(); ++j) {
-                for (size_t k = j + 1; k < x.at(0).size(); ++k) {
-                    result[i].push_back(x[i][j] * x[i][k]);
-                }
-            }
+    const size_t QUADRATIC_MIN_CHUNK_SIZE = 64;
+
+    Matrix AddQuadraticInteractions(const Matrix &x, bool with_squares) {
+        if (x.empty()) {
+            return {};
         }
 
+        ScopedTimer timer("quadratic_expansion");
+        timer.SetNumItems(x.size());
+        const size_t nb_dim = x[0].size();
+        const size_t nb_expanded = GetQuadraticDim(nb_dim, with_squares);
+        Matrix result(x.size());
+
+        ParallelFor(x.size(), QUADRATIC_MIN_CHUNK_SIZE, [&](size_t begin, size_t end, size_t) {
+            for (size_t i = begin; i < end; ++i) {
+                ValidateDimensions(nb_dim, x[i].size(), i);
+                // row is sized once, no reallocation while appending products
+                result[i].resize(nb_expanded);
+                ExpandQuadratic(x[i].data(), nb_dim, result[i].data(), with_squares);
+            }
+        });
+
         return result;
     }
 
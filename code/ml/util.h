@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <sstream>
@@ -8,6 +9,9 @@
 
 #include "exception.h"
 #include "multiclass_svm.h"
+#include "pca.h"
+#include "quantization.h"
+#include "sparse_svm.h"
 
 
 namespace ml {
@@ -27,13 +31,48 @@ namespace ml {
                            const std::vector<int> &y,
                            bool has_binary_labels = true);
 
-    double DotProduct(const std::vector<double> v1, const std::vector<double> v2); 
+    const uint64_t HASH_SEED = 14695981039346656037ULL;
 
-    Data ReadData(const std::string &data_path, bool load_label = true);
+    uint64_t HashBytes(const void *data, size_t size, uint64_t hash = HASH_SEED);
+
+    uint64_t HashFile(const std::string &path, uint64_t hash = HASH_SEED);
+
+    // offsets of strings stored back to back in a cache file: 0 first, never decreasing, total last
+    bool IsValidOffsetTable(const std::vector<uint64_t> &offsets, uint64_t total);
+
+    double DotProduct(const std::vector<double> &v1, const std::vector<double> &v2); 
+
+    // with use_cache, images are stored to data_path.cache and read back from it
+    // while the description file keeps its size, mtime and contents
+    Data ReadData(const std::string &data_path, bool load_label = true, bool use_cache = false);
+
+    // image paths and labels of a description file, images are not read
+    void ReadDescription(const std::string &data_path,
+                         bool load_label,
+                         std::vector<std::string> &image_paths,
+                         std::vector<int> &labels);
+
+    std::vector<std::string> ReadImagePaths(const std::string &data_path);
+
+    // grayscale pixels of a single image, row by row
+    std::vector<uint8_t> ReadImage(const std::string &image_path);
 
     void SaveModel(const MulticlassSVM &svm, const std::string &save_path);
 
     MulticlassSVM ReadModel(const std::string &model_path);
+
+    // binary format, int8 weights with per model scales
+    void SaveQuantizedModel(const QuantizedMulticlassSVM &svm, const std::string &save_path);
+
+    QuantizedMulticlassSVM ReadQuantizedModel(const std::string &model_path);
+
+    // binary format, indices and values of non zero weights
+    void SaveSparseModel(const SparseMulticlassSVM &svm, const std::string &save_path);
+
+    SparseMulticlassSVM ReadSparseModel(const std::string &model_path);
+
+    // share of predictions equal to labels
+    double Accuracy(const std::vector<int> &predictions, const std::vector<int> &y);
     
     void SavePredictions(const std::vector<std::string> &image_paths,
                          const std::vector<int> &predictions, 
@@ -45,16 +84,21 @@ namespace ml {
 
     Matrix Normalize(const Matrix &x, double mean, double std_dev);
 
+    // scales x in place, without a second copy of the data
+    Matrix Normalize(Matrix &&x, double mean, double std_dev);
+
     std::tuple<Matrix, double, double> Normalize(const Matrix &x);
 
     void SavePCA(const std::string &path, cv::PCA &pca);
 
     cv::PCA LoadPCA(const std::string &path);
 
-    cv::PCA CreatePCA(const Matrix &x, double retain_variance = 0.95);
+    cv::PCA CreatePCA(const Matrix &x,
+                      double retain_variance = 0.95,
+                      PCAMethod method = PCAMethod::Covariance);
 
     Matrix ProjectPCA(const cv::PCA &pca, const Matrix &x); 
 
-    Matrix AddQuadraticInteractions(const Matrix &x);
+    Matrix AddQuadraticInteractions(const Matrix &x, bool with_squares = false);
 } // namespace ml
 
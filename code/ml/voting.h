@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+
+namespace ml {
+
+/**
+ * Records the decision of the binary model separating labels i < j,
+ * positive score votes for j. Margins accumulate the signed scores
+ * so ties in votes can be resolved deterministically.
+ */
+inline void AddVote(int *votes, double *margins, size_t i, size_t j, double score) {
+    size_t winner = score > 0 ? j : i;
+    ++votes[winner];
+    margins[j] += score;
+    margins[i] -= score;
+}
+
+// most votes, then largest margin sum, then lowest label index
+inline size_t SelectWinner(const int *votes, const double *margins, size_t nb_labels) {
+    size_t winner = 0;
+    for (size_t i = 1; i < nb_labels; ++i) {
+        if (votes[i] > votes[winner] ||
+            (votes[i] == votes[winner] && margins[i] > margins[winner])) {
+            winner = i;
+        }
+    }
+    return winner;
+}
+
+/**
+ * "one vs one" votes of a single sample over dense label indices.
+ * Buffers are allocated once and reused by Reset, so voting
+ * does no heap allocation per sample.
+ */
+class VoteAccumulator {
+public:
+    explicit VoteAccumulator(size_t nb_labels)
+        :votes_(nb_labels, 0), margins_(nb_labels, 0) {}
+
+    void Reset() {
+        std::fill(votes_.begin(), votes_.end(), 0);
+        std::fill(margins_.begin(), margins_.end(), 0);
+    }
+
+    void Add(size_t i, size_t j, double score) {
+        AddVote(votes_.data(), margins_.data(), i, j, score);
+    }
+
+    size_t GetWinner() const {
+        return SelectWinner(votes_.data(), margins_.data(), votes_.size());
+    }
+
+private:
+    std::vector<int> votes_;
+    std::vector<double> margins_;
+};
+
+} // namespace ml
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+
+/**
+ * Gaussian blobs shared by the solver tests: nb_per_label[k] rows labelled
+ * labels[k] with unit noise in nb_dim dimensions and shifted by shift
+ * in dimension k. Rows of a label are contiguous.
+ */
+inline void MakeBlobs(const std::vector<size_t> &nb_per_label,
+                      const std::vector<int> &labels,
+                      size_t nb_dim,
+                      double shift,
+                      std::vector<std::vector<double>> &x,
+                      std::vector<int> &y) {
+    std::mt19937 random(7);
+    std::normal_distribution<double> noise(0, 1);
+    x.clear();
+    y.clear();
+    for (size_t k = 0; k < nb_per_label.size(); ++k) {
+        for (size_t i = 0; i < nb_per_label[k]; ++i) {
+            std::vector<double> row(nb_dim);
+            for (size_t j = 0; j < nb_dim; ++j) {
+                row[j] = noise(random) + (j == k ? shift : 0);
+            }
+            x.push_back(row);
+            y.push_back(labels[k]);
+        }
+    }
+}
+
+// two blobs labelled -1 and 1 which overlap more as shift goes to 0
+inline void MakeBinaryBlobs(size_t nb_data, size_t nb_dim, double shift,
+                            std::vector<std::vector<double>> &x, std::vector<int> &y) {
+    MakeBlobs({nb_data / 2, nb_data - nb_data / 2}, {-1, 1}, nb_dim, shift, x, y);
+}
@@ -0,0 +1,24 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "export.h"
+#include "export_fixture.h"
+
+
+// writes the headers test_export compiles, 'export_fixture <output_dir>'
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        std::cerr << "usage: export_fixture <output_dir>" << std::endl;
+        return 1;
+    }
+    std::string output_dir = argv[1];
+
+    std::ofstream raw(output_dir + "/exported_raw_model.h");
+    ml::WriteModelHeader(raw, export_fixture::MakeRawSVM(), "exported_raw");
+
+    std::ofstream preprocessed(output_dir + "/exported_preprocessed_model.h");
+    ml::WriteModelHeader(preprocessed, export_fixture::MakePreprocessedSVM(), export_fixture::MakePCA(),
+                         export_fixture::MEAN, export_fixture::STD_DEV, "exported_preprocessed");
+    return raw && preprocessed ? 0 : 1;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <random>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "multiclass_svm.h"
+#include "quadratic.h"
+
+
+// models exported by export_fixture at build time and checked by test_export,
+// values come from the raw mt19937 sequence so both sides rebuild them identically
+namespace export_fixture {
+
+const size_t NB_LABELS = 4;
+const size_t INPUT_DIM = 16;
+const size_t PROJECTED_DIM = 3;
+const bool WITH_SQUARES = true;
+const double MEAN = 110;
+const double STD_DEV = 70;
+
+inline double NextValue(std::mt19937 &random) {
+    return static_cast<double>(random()) / std::mt19937::max() * 2 - 1;
+}
+
+inline ml::MulticlassSVM MakeSVM(size_t nb_dim, unsigned seed) {
+    std::mt19937 random(seed);
+    std::vector<std::vector<double>> models(NB_LABELS * (NB_LABELS - 1) / 2, std::vector<double>(nb_dim));
+    std::vector<double> biases(models.size());
+    for (size_t i = 0; i < models.size(); ++i) {
+        for (auto &value : models[i]) {
+            value = NextValue(random);
+        }
+        biases[i] = NextValue(random);
+    }
+    return ml::MulticlassSVM(models, biases, {2, 3, 5, 7});
+}
+
+// trained on raw pixels, so weights are scaled down to pixel range
+inline ml::MulticlassSVM MakeRawSVM() {
+    ml::MulticlassSVM svm = MakeSVM(INPUT_DIM, 1);
+    auto models = svm.GetModels();
+    auto biases = svm.GetBiases();
+    for (size_t i = 0; i < models.size(); ++i) {
+        for (auto &value : models[i]) {
+            value /= 255;
+        }
+    }
+    return ml::MulticlassSVM(models, biases, svm.GetLabels());
+}
+
+inline ml::MulticlassSVM MakePreprocessedSVM() {
+    return MakeSVM(ml::GetQuadraticDim(PROJECTED_DIM, WITH_SQUARES), 2);
+}
+
+inline cv::PCA MakePCA() {
+    std::mt19937 random(3);
+    cv::PCA pca;
+    pca.mean.create(1, INPUT_DIM, CV_64FC1);
+    for (size_t j = 0; j < INPUT_DIM; ++j) {
+        pca.mean.at<double>(0, j) = 0.1 * NextValue(random);
+    }
+    pca.eigenvectors.create(PROJECTED_DIM, INPUT_DIM, CV_64FC1);
+    for (size_t k = 0; k < PROJECTED_DIM; ++k) {
+        for (size_t j = 0; j < INPUT_DIM; ++j) {
+            pca.eigenvectors.at<double>(k, j) = NextValue(random) / 4;
+        }
+    }
+    return pca;
+}
+
+} // namespace export_fixture
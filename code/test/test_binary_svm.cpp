@@ -127,3 +127,43 @@ TEST_CASE("2 demensional case", "binary svm") {
     REQUIRE(predictions[2] == -1);
     REQUIRE(predictions[3] ==  1);
 }
+
+TEST_CASE("sdca solver stops on the duality gap", "binary svm") {
+    std::vector<std::vector<double>> x = {{8}, {7}, {6}, {3}, {2}, {1}};
+    std::vector<int> y = {1, 1, 1, -1, -1, -1};
+
+    ml::TrainOptions options;
+    options.lambda = 0.001;
+    options.bias_multiplier = 5;
+    options.epsilon = 0.001;
+    options.solver = ml::SolverType::Sdca;
+
+    ml::BinarySVM svm;
+    svm.Train(x, y, options);
+
+    auto &statistics = svm.GetTrainStatistics();
+    REQUIRE_FALSE(statistics.max_iterations_reached);
+    REQUIRE(statistics.duality_gap < options.epsilon);
+    REQUIRE(svm.Predict(x) == y);
+}
+
+TEST_CASE("loss and iteration limit", "binary svm") {
+    std::vector<std::vector<double>> x = {{8}, {7}, {6}, {3}, {2}, {1}};
+    std::vector<int> y = {1, 1, 1, -1, -1, -1};
+
+    ml::TrainOptions options;
+    options.lambda = 0.001;
+    options.bias_multiplier = 5;
+    options.loss = ml::LossType::Logistic;
+    options.max_iterations = 12;
+
+    ml::BinarySVM svm;
+    svm.Train(x, y, options);
+    REQUIRE(svm.GetTrainStatistics().max_iterations_reached);
+    REQUIRE(svm.GetTrainStatistics().nb_iterations < 12);
+
+    REQUIRE(ml::ParseLossType("hinge2") == ml::LossType::Hinge2);
+    REQUIRE(ml::ParseLossType("logistic") == ml::LossType::Logistic);
+    REQUIRE(ml::ParseSolverType("sdca") == ml::SolverType::Sdca);
+    REQUIRE_THROWS_AS(ml::ParseLossType("huber"), ml::Exception);
+}
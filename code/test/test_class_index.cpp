@@ -0,0 +1,43 @@
+#include <vector>
+
+#include <catch.hpp>
+
+#include "class_index.h"
+#include "exception.h"
+
+
+TEST_CASE("class index buckets rows by label", "class index") {
+    std::vector<int> y = {3, 1, 3, 7, 1, 3};
+    ml::ClassIndex index(y);
+
+    REQUIRE(index.GetLabels() == std::vector<int>({1, 3, 7}));
+    REQUIRE(index.GetRows() == std::vector<size_t>({1, 4, 0, 2, 5, 3}));
+    REQUIRE(index.GetBegin(1) == 2);
+    REQUIRE(index.GetEnd(1) == 5);
+    REQUIRE(index.GetSize(2) == 1);
+    REQUIRE_FALSE(index.IsSorted());
+
+    REQUIRE(index.GetPairRows(0, 2) == std::vector<size_t>({1, 4, 3}));
+    REQUIRE(index.GetPairRows(1, 2) == std::vector<size_t>({0, 2, 5, 3}));
+    REQUIRE_THROWS(index.GetSize(3));
+}
+
+TEST_CASE("class index of an empty data set", "class index") {
+    ml::ClassIndex index(std::vector<int>{});
+    REQUIRE(index.GetLabels().empty());
+    REQUIRE(index.GetRows().empty());
+    REQUIRE(index.IsSorted());
+}
+
+TEST_CASE("sort by label is stable", "class index") {
+    std::vector<std::vector<double>> x = {{0}, {1}, {2}, {3}, {4}};
+    std::vector<int> y = {2, 0, 2, 1, 0};
+    ml::SortByLabel(x, y);
+
+    REQUIRE(y == std::vector<int>({0, 0, 1, 2, 2}));
+    REQUIRE(x == std::vector<std::vector<double>>({{1}, {4}, {3}, {0}, {2}}));
+    REQUIRE(ml::ClassIndex(y).IsSorted());
+
+    y.pop_back();
+    REQUIRE_THROWS_AS(ml::SortByLabel(x, y), ml::Exception);
+}
@@ -0,0 +1,203 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+#include <opencv2/opencv.hpp>
+
+#include "feature_cache.h"
+#include "mapped_file.h"
+#include "util.h"
+
+
+std::vector<std::string> WriteImages(size_t nb_images) {
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < nb_images; ++i) {
+        cv::Mat mat(2, 3, CV_8UC1);
+        for (int r = 0; r < mat.rows; ++r) {
+            for (int c = 0; c < mat.cols; ++c) {
+                mat.at<uchar>(r, c) = static_cast<uchar>(i * 40 + r * 3 + c);
+            }
+        }
+        paths.push_back("test_cache_image_" + std::to_string(i) + ".png");
+        cv::imwrite(paths.back(), mat);
+    }
+    return paths;
+}
+
+TEST_CASE("data cache is reused until description changes", "data cache") {
+    auto image_paths = WriteImages(3);
+    std::string data_path = "test_cache_description.txt";
+    {
+        std::ofstream output(data_path);
+        for (size_t i = 0; i < image_paths.size(); ++i) {
+            output << image_paths[i] << " " << i << "\n";
+        }
+    }
+    std::remove((data_path + ".cache").c_str());
+
+    auto expected = ml::ReadData(data_path, true, true);
+    REQUIRE(std::get<0>(expected).size() == 3);
+    REQUIRE(std::get<0>(expected)[1][4] == 40 + 3 + 1);
+
+    // images are gone, everything comes from the cache
+    for (auto &path : image_paths) {
+        std::remove(path.c_str());
+    }
+    auto cached = ml::ReadData(data_path, true, true);
+    REQUIRE(std::get<0>(cached) == std::get<0>(expected));
+    REQUIRE(std::get<1>(cached) == std::get<1>(expected));
+    REQUIRE(std::get<2>(cached) == std::get<2>(expected));
+
+    // a changed description invalidates the cache
+    {
+        std::ofstream output(data_path, std::ios::app);
+        output << WriteImages(1)[0] << " 7\n";
+    }
+    auto reloaded = ml::ReadData(data_path, true, true);
+    REQUIRE(std::get<0>(reloaded).size() == 4);
+    REQUIRE(std::get<1>(reloaded).back() == 7);
+
+    std::remove("test_cache_image_0.png");
+    std::remove(data_path.c_str());
+    std::remove((data_path + ".cache").c_str());
+}
+
+// overwrites 8 bytes of a cache file in place
+void PatchCache(const std::string &path, size_t position, uint64_t value) {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(position);
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+TEST_CASE("damaged data cache is a miss", "data cache") {
+    auto image_paths = WriteImages(3);
+    std::string data_path = "test_damaged_cache_description.txt";
+    {
+        std::ofstream output(data_path);
+        for (size_t i = 0; i < image_paths.size(); ++i) {
+            output << image_paths[i] << " " << i << "\n";
+        }
+    }
+    std::string cache_path = data_path + ".cache";
+    std::remove(cache_path.c_str());
+    auto expected = ml::ReadData(data_path, true, true);
+
+    // header is 56 bytes with nb_images at 32, offsets follow 3 images of 6 pixels and 3 labels
+    const size_t nb_images_position = 32;
+    const size_t offsets_position = 56 + 3 * 6 + 3 * 4;
+    const uint64_t path_size = image_paths[0].size();
+    std::vector<std::pair<size_t, uint64_t>> damages = {
+        {nb_images_position, 1ULL << 62},
+        {nb_images_position, 0x5555555555555556ULL},
+        // the last offset still matches the file size
+        {offsets_position + 8, 100 * path_size},
+        {offsets_position, path_size},
+    };
+    for (auto &damage : damages) {
+        // every miss rewrites the cache, so each damage starts from a valid one
+        PatchCache(cache_path, damage.first, damage.second);
+        auto data = ml::ReadData(data_path, true, true);
+        REQUIRE(std::get<0>(data) == std::get<0>(expected));
+        REQUIRE(std::get<2>(data) == std::get<2>(expected));
+    }
+
+    REQUIRE(ml::IsValidOffsetTable({0, 3, 3, 7}, 7));
+    REQUIRE_FALSE(ml::IsValidOffsetTable({0, 5, 3, 7}, 7));
+    REQUIRE_FALSE(ml::IsValidOffsetTable({1, 3, 7}, 7));
+    REQUIRE_FALSE(ml::IsValidOffsetTable({}, 0));
+
+    for (auto &path : image_paths) {
+        std::remove(path.c_str());
+    }
+    std::remove(data_path.c_str());
+    std::remove(cache_path.c_str());
+}
+
+TEST_CASE("mapped file", "data cache") {
+    std::string path = "test_mapped_file.bin";
+    {
+        std::ofstream output(path, std::ios::binary);
+        output << "mapped";
+    }
+    ml::MappedFile file(path);
+    REQUIRE(file.GetSize() == 6);
+    REQUIRE(std::string(file.GetData(), file.GetData() + file.GetSize()) == "mapped");
+    std::remove(path.c_str());
+
+    REQUIRE_THROWS(ml::MappedFile("missing_mapped_file.bin"));
+}
+
+TEST_CASE("feature cache round trip", "data cache") {
+    std::string path = "test_features.features";
+    std::vector<std::vector<double>> features = {{0.5, -1.25}, {3, 4}, {-7, 1e-3}};
+    std::vector<std::string> image_paths = {"a.png", "bb.png", "ccc.png"};
+    ml::FeatureCache::Save(path, 42, features, image_paths);
+
+    REQUIRE(ml::FeatureCache::Open(path, 43) == nullptr);
+    auto cache = ml::FeatureCache::Open(path, 42);
+    REQUIRE(cache != nullptr);
+    REQUIRE(cache->GetRows() == 3);
+    REQUIRE(cache->GetCols() == 2);
+    REQUIRE(cache->GetImagePaths() == image_paths);
+    for (size_t i = 0; i < features.size(); ++i) {
+        for (size_t j = 0; j < features[i].size(); ++j) {
+            REQUIRE(cache->GetData()[i * 2 + j] == features[i][j]);
+        }
+    }
+    std::remove(path.c_str());
+
+    REQUIRE(ml::FeatureCache::Open("missing_features.features", 42) == nullptr);
+}
+
+TEST_CASE("damaged feature cache is rejected", "data cache") {
+    std::string path = "test_damaged.features";
+    std::vector<std::vector<double>> features = {{0.5, -1.25}, {3, 4}, {-7, 1e-3}};
+    std::vector<std::string> image_paths = {"a.png", "bb.png", "ccc.png"};
+
+    // header is 64 bytes with nb_rows at 16 and nb_cols at 24, offsets follow 3 rows of 2 features
+    const size_t nb_rows_position = 16;
+    const size_t nb_cols_position = 24;
+    const size_t offsets_position = 64 + 3 * 2 * sizeof(double);
+    std::vector<std::pair<size_t, uint64_t>> damages = {
+        {nb_rows_position, 1ULL << 62},
+        {nb_cols_position, 1ULL << 61},
+        {nb_cols_position, 0x2000000000000001ULL},
+        // the last offset still matches the file size
+        {offsets_position + 8, 1000},
+        {offsets_position, 2},
+    };
+    for (auto &damage : damages) {
+        ml::FeatureCache::Save(path, 42, features, image_paths);
+        PatchCache(path, damage.first, damage.second);
+        REQUIRE(ml::FeatureCache::Open(path, 42) == nullptr);
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("feature cache key follows the images", "data cache") {
+    auto image_paths = WriteImages(2);
+    std::string data_path = "test_feature_key_description.txt";
+    {
+        std::ofstream output(data_path);
+        for (auto &image_path : image_paths) {
+            output << image_path << "\n";
+        }
+    }
+    std::string model_path = "test_feature_key_model";
+    std::ofstream(model_path + ".pca") << "pca";
+    std::ofstream(model_path + ".norm") << "norm";
+
+    uint64_t key = ml::GetFeatureCacheKey(data_path, model_path);
+    REQUIRE(ml::GetFeatureCacheKey(data_path, model_path) == key);
+    std::ofstream(image_paths[1], std::ios::binary | std::ios::app) << "changed";
+    REQUIRE(ml::GetFeatureCacheKey(data_path, model_path) != key);
+
+    for (auto &image_path : image_paths) {
+        std::remove(image_path.c_str());
+    }
+    std::remove(data_path.c_str());
+    std::remove((model_path + ".pca").c_str());
+    std::remove((model_path + ".norm").c_str());
+}
@@ -0,0 +1,121 @@
+#include <vector>
+
+#include <catch.hpp>
+
+#include "binary_svm.h"
+#include "blobs.h"
+#include "dual_coordinate_descent.h"
+#include "exception.h"
+#include "parallel.h"
+
+
+TEST_CASE("dual coordinate descent separates linearly separable data", "dual coordinate descent") {
+    std::vector<std::vector<double>> x = {{8}, {7}, {6}, {3}, {2}, {1}};
+    std::vector<int> y = {1, 1, 1, -1, -1, -1};
+
+    ml::TrainOptions options;
+    options.lambda = 0.001;
+    options.bias_multiplier = 5;
+    options.epsilon = 0.0001;
+    options.solver = ml::SolverType::Dcd;
+
+    ml::BinarySVM svm;
+    svm.Train(x, y, options);
+    REQUIRE(svm.Predict(x) == y);
+
+    auto &statistics = svm.GetTrainStatistics();
+    REQUIRE_FALSE(statistics.max_iterations_reached);
+    REQUIRE(statistics.duality_gap < options.epsilon);
+    REQUIRE(statistics.epoch_seconds.size() * x.size() >= statistics.nb_iterations);
+}
+
+TEST_CASE("dual coordinate descent rejects losses other than hinge", "dual coordinate descent") {
+    std::vector<std::vector<double>> x = {{8}, {7}, {2}, {1}};
+    std::vector<int> y = {1, 1, -1, -1};
+
+    ml::TrainOptions options;
+    options.solver = ml::SolverType::Dcd;
+    ml::BinarySVM svm;
+    for (auto loss : {ml::LossType::Hinge2, ml::LossType::L1, ml::LossType::L2, ml::LossType::Logistic}) {
+        options.loss = loss;
+        REQUIRE_THROWS_AS(svm.Train(x, y, options), ml::Exception);
+    }
+    options.loss = ml::LossType::Hinge;
+    REQUIRE_NOTHROW(svm.Train(x, y, options));
+}
+
+TEST_CASE("dual coordinate descent reaches the sdca objective", "dual coordinate descent") {
+    std::vector<std::vector<double>> x;
+    std::vector<int> y;
+    MakeBinaryBlobs(3000, 30, 2, x, y);
+
+    ml::TrainOptions options;
+    options.lambda = 0.001;
+    options.epsilon = 0.0001;
+    options.solver = ml::SolverType::Sdca;
+    options.max_iterations = 100 * x.size();
+    ml::BinarySVM sdca;
+    sdca.Train(x, y, options);
+
+    options.solver = ml::SolverType::Dcd;
+    ml::BinarySVM dcd;
+    dcd.Train(x, y, options);
+
+    REQUIRE_FALSE(dcd.GetTrainStatistics().max_iterations_reached);
+    REQUIRE(dcd.GetTrainStatistics().objective ==
+            Approx(sdca.GetTrainStatistics().objective).epsilon(0.01));
+    // shrinking leaves most of the samples out of the late epochs
+    REQUIRE(dcd.GetTrainStatistics().nb_iterations < sdca.GetTrainStatistics().nb_iterations);
+}
+
+TEST_CASE("dual coordinate descent on several blocks", "dual coordinate descent") {
+    std::vector<std::vector<double>> x;
+    std::vector<int> y;
+    MakeBinaryBlobs(20000, 10, 2, x, y);
+
+    ml::TrainOptions options;
+    options.lambda = 0.0001;
+    options.epsilon = 0.0001;
+    options.solver = ml::SolverType::Dcd;
+
+    double objectives[2];
+    size_t nb_threads[2] = {1, 4};
+    for (size_t k = 0; k < 2; ++k) {
+        ml::SetNumThreads(nb_threads[k]);
+        ml::BinarySVM svm;
+        svm.Train(x, y, options);
+        REQUIRE(svm.GetTrainStatistics().duality_gap < options.epsilon);
+        objectives[k] = svm.GetTrainStatistics().objective;
+    }
+    ml::SetNumThreads(0);
+
+    REQUIRE(objectives[1] == Approx(objectives[0]).epsilon(0.01));
+}
+
+TEST_CASE("training on rows matches training on a copy", "dual coordinate descent") {
+    std::vector<std::vector<double>> x;
+    std::vector<int> y;
+    MakeBinaryBlobs(500, 5, 2, x, y);
+
+    std::vector<size_t> rows;
+    std::vector<std::vector<double>> sub_x;
+    std::vector<int> sub_y;
+    for (size_t i = 0; i < x.size(); i += 3) {
+        rows.push_back(i);
+        sub_x.push_back(x[i]);
+        sub_y.push_back(y[i]);
+    }
+
+    ml::TrainOptions options;
+    options.solver = ml::SolverType::Dcd;
+    ml::BinarySVM on_rows;
+    on_rows.Train(x, rows, sub_y, options);
+    ml::BinarySVM on_copy;
+    on_copy.Train(sub_x, sub_y, options);
+
+    REQUIRE(on_rows.GetModel() == on_copy.GetModel());
+    REQUIRE(on_rows.GetBias() == on_copy.GetBias());
+
+    rows.back() = x.size();
+    REQUIRE_THROWS(on_rows.Train(x, rows, sub_y, options));
+}
@@ -0,0 +1,97 @@
+#include <cstdint>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "embedded_predictor.h"
+#include "exception.h"
+#include "export.h"
+#include "export_fixture.h"
+#include "multiclass_svm.h"
+#include "util.h"
+
+// written by the export_fixture step of the build
+#include "exported_preprocessed_model.h"
+#include "exported_raw_model.h"
+
+
+// rows of random pixels and the same rows as doubles
+void MakePixels(size_t nb_rows, size_t nb_dim,
+                std::vector<std::vector<uint8_t>> &pixels, std::vector<std::vector<double>> &x) {
+    std::mt19937 random(4);
+    pixels.assign(nb_rows, std::vector<uint8_t>(nb_dim));
+    x.assign(nb_rows, std::vector<double>(nb_dim));
+    for (size_t i = 0; i < nb_rows; ++i) {
+        for (size_t j = 0; j < nb_dim; ++j) {
+            pixels[i][j] = static_cast<uint8_t>(random() % 256);
+            x[i][j] = pixels[i][j];
+        }
+    }
+}
+
+TEST_CASE("exported raw model predicts as multiclass svm", "export") {
+    typedef exported_raw::Model Model;
+    static_assert(!Model::kPreprocessed, "raw model");
+    static_assert(Model::kInputDim == export_fixture::INPUT_DIM, "input dimensionality");
+
+    std::vector<std::vector<uint8_t>> pixels;
+    std::vector<std::vector<double>> x;
+    MakePixels(500, Model::kInputDim, pixels, x);
+    auto expected = export_fixture::MakeRawSVM().Predict(x);
+
+    for (size_t i = 0; i < x.size(); ++i) {
+        REQUIRE(ml::EmbeddedPredictor<Model>::Predict(pixels[i].data()) == expected[i]);
+    }
+}
+
+TEST_CASE("exported preprocessed model predicts as multiclass svm", "export") {
+    typedef exported_preprocessed::Model Model;
+    static_assert(Model::kPreprocessed, "preprocessed model");
+    static_assert(Model::kWithSquares == export_fixture::WITH_SQUARES, "quadratic expansion");
+    static_assert(Model::kProjectedDim == export_fixture::PROJECTED_DIM, "projected dimensionality");
+
+    std::vector<std::vector<uint8_t>> pixels;
+    std::vector<std::vector<double>> x;
+    MakePixels(500, Model::kInputDim, pixels, x);
+
+    // same preprocessing 'main classify' applies
+    auto features = ml::Normalize(x, export_fixture::MEAN, export_fixture::STD_DEV);
+    features = ml::ProjectPCA(export_fixture::MakePCA(), features);
+    features = ml::AddQuadraticInteractions(features, export_fixture::WITH_SQUARES);
+    auto expected = export_fixture::MakePreprocessedSVM().Predict(features);
+
+    // the labels don't all come out the same
+    REQUIRE(std::set<int>(expected.begin(), expected.end()).size() > 1);
+    for (size_t i = 0; i < x.size(); ++i) {
+        REQUIRE(ml::EmbeddedPredictor<Model>::Predict(pixels[i].data()) == expected[i]);
+    }
+}
+
+TEST_CASE("model header contents", "export") {
+    std::vector<std::vector<double>> models = {{0.5, -1}, {2, 0.25}, {1, 1}};
+    std::vector<double> biases = {0.125, -3, 7};
+    std::vector<int> labels = {4, 7, 9};
+    ml::MulticlassSVM svm(models, biases, labels);
+
+    std::ostringstream output;
+    ml::WriteModelHeader(output, svm, "exported");
+    std::string header = output.str();
+
+    REQUIRE(header.find("namespace exported {") != std::string::npos);
+    REQUIRE(header.find("kPreprocessed = false") != std::string::npos);
+    REQUIRE(header.find("kModelDim = 2;") != std::string::npos);
+    REQUIRE(header.find("kWeights[kNbModels][kModelDim]") != std::string::npos);
+    REQUIRE(header.find("4, 7, 9") != std::string::npos);
+    REQUIRE(header.find("kPCAMean") == std::string::npos);
+    REQUIRE(header.find("typedef ModelData<> Model;") != std::string::npos);
+}
+
+TEST_CASE("exporting empty model", "export") {
+    ml::MulticlassSVM svm;
+    std::ostringstream output;
+    REQUIRE_THROWS_AS(ml::WriteModelHeader(output, svm, "exported"), ml::Exception);
+}
@@ -0,0 +1,91 @@
+#include <sstream>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "kernels.h"
+#include "util.h"
+
+
+std::vector<double> MakeSequence(size_t nb_dim, double scale) {
+    std::vector<double> v(nb_dim);
+    for (size_t i = 0; i < nb_dim; ++i) {
+        v[i] = scale * ((i % 7) - 3.0);
+    }
+    return v;
+}
+
+TEST_CASE("fixed dot product matches generic", "kernels") {
+    auto v1 = MakeSequence(13, 0.5);
+    auto v2 = MakeSequence(13, 2.0);
+    double expected = 0;
+    for (size_t i = 0; i < v1.size(); ++i) {
+        expected += v1[i] * v2[i];
+    }
+
+    REQUIRE(ml::FixedDotProduct<13>(v1.data(), v2.data()) == Approx(expected));
+    REQUIRE(ml::GenericDotProduct(v1.data(), v2.data(), 13) == Approx(expected));
+    REQUIRE(ml::DotProduct(v1, v2) == Approx(expected));
+}
+
+// stands out from any real dot product
+double SentinelDotProduct(const double *, const double *, size_t) {
+    return 42;
+}
+
+// the registry is process wide, the test leaves it as it found it
+struct RegisteredKernel {
+    RegisteredKernel(size_t nb_dim, ml::DotProductKernel kernel) : nb_dim(nb_dim) {
+        ml::RegisterDotProductKernel(nb_dim, kernel);
+    }
+    ~RegisteredKernel() {
+        ml::UnregisterDotProductKernel(nb_dim);
+    }
+    size_t nb_dim;
+};
+
+TEST_CASE("kernel dispatch by dimensionality", "kernels") {
+    REQUIRE(ml::HasSpecializedKernel(ml::MNIST_DIM));
+    REQUIRE(ml::HasSpecializedKernel(ml::QuadraticDim(50)));
+
+    // no other test uses this dimensionality
+    const size_t nb_dim = 29;
+    REQUIRE_FALSE(ml::HasSpecializedKernel(nb_dim));
+    REQUIRE(ml::GetDotProductKernel(nb_dim) == &ml::GenericDotProduct);
+    {
+        RegisteredKernel registered(nb_dim, &ml::SpecializedDotProduct<29>);
+        REQUIRE(ml::HasSpecializedKernel(nb_dim));
+    }
+    REQUIRE_FALSE(ml::HasSpecializedKernel(nb_dim));
+
+    auto v1 = MakeSequence(ml::MNIST_DIM, 1.0);
+    auto v2 = MakeSequence(ml::MNIST_DIM, 0.25);
+    auto kernel = ml::GetDotProductKernel(ml::MNIST_DIM);
+    REQUIRE(kernel(v1.data(), v2.data(), ml::MNIST_DIM) ==
+            Approx(ml::GenericDotProduct(v1.data(), v2.data(), ml::MNIST_DIM)));
+}
+
+TEST_CASE("cached kernel lookup sees later registrations", "kernels") {
+    const size_t nb_dim = 31;
+    auto v1 = MakeSequence(nb_dim, 1.0);
+    auto v2 = MakeSequence(nb_dim, 0.5);
+    const double expected = ml::GenericDotProduct(v1.data(), v2.data(), nb_dim);
+    REQUIRE(ml::DotProduct(v1, v2) == Approx(expected));
+    {
+        RegisteredKernel registered(nb_dim, &SentinelDotProduct);
+        REQUIRE(ml::DotProduct(v1, v2) == 42);
+    }
+    REQUIRE(ml::DotProduct(v1, v2) == Approx(expected));
+}
+
+TEST_CASE("generated kernel source", "kernels") {
+    std::ostringstream output;
+    ml::WriteSpecializedKernels(output, {1830, 60, 1830}, "test model");
+    std::string source = output.str();
+
+    REQUIRE(source.find("#include \"kernels.h\"") != std::string::npos);
+    REQUIRE(source.find("ml::KernelRegistrar<1830>") != std::string::npos);
+    REQUIRE(source.find("ml::KernelRegistrar<60>") != std::string::npos);
+    // duplicated dimensions are emitted once
+    REQUIRE(source.find("ml::KernelRegistrar<1830>") == source.rfind("ml::KernelRegistrar<1830>"));
+}
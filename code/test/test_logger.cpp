@@ -0,0 +1,104 @@
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "exception.h"
+#include "logger.h"
+
+
+TEST_CASE("log levels", "logger") {
+    std::ostringstream output;
+    ml::Logger logger(output);
+    REQUIRE(logger.GetLevel() == ml::LogLevel::Info);
+
+    ml::Log(ml::LogLevel::Debug, logger) << "hidden";
+    ml::Log(ml::LogLevel::Info, logger) << "loaded " << 3 << " images";
+    logger.SetLevel(ml::LogLevel::Error);
+    ml::Log(ml::LogLevel::Warning, logger) << "hidden";
+    ml::Log(ml::LogLevel::Error, logger) << "failed";
+    {
+        ml::ScopedLogLevel silence(ml::LogLevel::Off, logger);
+        ml::Log(ml::LogLevel::Error, logger) << "hidden";
+    }
+    REQUIRE(logger.GetLevel() == ml::LogLevel::Error);
+    logger.Flush();
+
+    REQUIRE(output.str() == "loaded 3 images\nfailed\n");
+
+    REQUIRE(ml::ParseLogLevel("warning") == ml::LogLevel::Warning);
+    REQUIRE(ml::ParseLogLevel("off") == ml::LogLevel::Off);
+    REQUIRE_THROWS_AS(ml::ParseLogLevel("verbose"), ml::Exception);
+}
+
+TEST_CASE("lines from many threads", "logger") {
+    std::ostringstream output;
+    const size_t nb_threads = 4;
+    const size_t nb_lines = 200;
+    {
+        ml::Logger logger(output, 1 << 12);
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < nb_threads; ++t) {
+            threads.emplace_back([&logger, t]() {
+                for (size_t i = 0; i < nb_lines; ++i) {
+                    ml::Log(ml::LogLevel::Info, logger) << "thread " << t << " line " << i;
+                }
+            });
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        logger.Flush();
+        REQUIRE(logger.GetNumDropped() == 0);
+    }
+
+    // every line is written whole and lines of one thread keep their order
+    std::istringstream input(output.str());
+    std::vector<size_t> next(nb_threads, 0);
+    std::string line;
+    size_t nb_read = 0;
+    while (std::getline(input, line)) {
+        std::istringstream iss(line);
+        std::string thread_word, line_word;
+        size_t t, i;
+        REQUIRE(iss >> thread_word >> t >> line_word >> i);
+        REQUIRE(i == next[t]);
+        ++next[t];
+        ++nb_read;
+    }
+    REQUIRE(nb_read == nb_threads * nb_lines);
+}
+
+TEST_CASE("full ring drops lines instead of blocking", "logger") {
+    std::ostringstream output;
+    ml::Logger logger(output, 2);
+    for (int i = 0; i < 10000; ++i) {
+        ml::Log(ml::LogLevel::Info, logger) << i;
+    }
+    logger.Flush();
+
+    std::istringstream input(output.str());
+    std::string line;
+    size_t nb_written = 0;
+    while (std::getline(input, line)) {
+        ++nb_written;
+    }
+    REQUIRE(nb_written + logger.GetNumDropped() == 10000);
+}
+
+TEST_CASE("progress is rate limited", "logger") {
+    std::ostringstream output;
+    ml::Logger logger(output);
+    ml::ProgressReporter progress("images", 1000, std::chrono::milliseconds(20), logger);
+    for (size_t i = 0; i < 1000; ++i) {
+        progress.Update(i);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    progress.Update(1000);
+    logger.Flush();
+
+    REQUIRE(output.str() == "images 1000 of 1000\n");
+}
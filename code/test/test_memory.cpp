@@ -0,0 +1,93 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "exception.h"
+#include "memory.h"
+#include "util.h"
+
+
+TEST_CASE("process memory usage", "memory") {
+    auto usage = ml::GetMemoryUsage();
+    REQUIRE(usage.rss_bytes > 0);
+    REQUIRE(usage.peak_rss_bytes >= usage.rss_bytes);
+
+    std::vector<std::vector<double>> x(10, std::vector<double>(100));
+    REQUIRE(ml::GetMatrixBytes(x) >= ml::EstimateMatrixBytes(10, 100));
+    REQUIRE(ml::EstimateMatrixBytes(10, 100) == 10 * (sizeof(std::vector<double>) + 800));
+}
+
+TEST_CASE("tracked buffers", "memory") {
+    ml::MemoryTracker tracker;
+    {
+        ml::TrackedBuffer images("images", 100, tracker);
+        size_t labels = tracker.Track("labels", 10);
+        REQUIRE(tracker.GetTrackedBytes() == 110);
+
+        {
+            ml::TrackedBuffer expanded("expanded", 300, tracker);
+            images.Update(50);
+            REQUIRE(tracker.GetTrackedBytes() == 360);
+        }
+        tracker.Release(labels);
+
+        auto live = tracker.GetLiveBuffers();
+        REQUIRE(live.size() == 1);
+        REQUIRE(live[0].first == "images");
+        REQUIRE(live[0].second == 50);
+    }
+    REQUIRE(tracker.GetTrackedBytes() == 0);
+    REQUIRE(tracker.GetPeakTrackedBytes() == 410);
+
+    // buffers live when the total peaked, largest first
+    auto peak = tracker.GetPeakBuffers();
+    REQUIRE(peak.size() == 3);
+    REQUIRE(peak[0].first == "expanded");
+    REQUIRE(peak[1].first == "images");
+    REQUIRE(peak[1].second == 100);
+    REQUIRE(peak[2].first == "labels");
+}
+
+TEST_CASE("memory budget", "memory") {
+    ml::MemoryTracker tracker;
+    tracker.CheckBudget("unlimited", size_t(1) << 60);
+
+    size_t rss = ml::GetMemoryUsage().rss_bytes;
+    tracker.SetBudget(rss + (size_t(1) << 30));
+    tracker.CheckBudget("fits", 1 << 20);
+    REQUIRE_THROWS_AS(tracker.CheckBudget("too large", size_t(1) << 31), ml::Exception);
+    REQUIRE_THROWS_AS(ml::MemoryStage("too large", size_t(1) << 31, tracker), ml::Exception);
+    REQUIRE(tracker.GetStages().empty());
+}
+
+TEST_CASE("memory stages", "memory") {
+    ml::MemoryTracker tracker;
+    {
+        ml::MemoryStage stage("allocate", 1 << 20, tracker);
+        ml::TrackedBuffer buffer("buffer", 1 << 20, tracker);
+    }
+
+    auto stages = tracker.GetStages();
+    REQUIRE(stages.size() == 1);
+    REQUIRE(stages[0].name == "allocate");
+    REQUIRE(stages[0].estimated_bytes == 1 << 20);
+    REQUIRE(stages[0].after.peak_rss_bytes >= stages[0].before.peak_rss_bytes);
+
+    std::ostringstream report;
+    tracker.WriteReport(report);
+    REQUIRE(report.str().find("allocate") != std::string::npos);
+    REQUIRE(report.str().find("buffer") != std::string::npos);
+    REQUIRE(report.str().find("1.0 MB") != std::string::npos);
+}
+
+TEST_CASE("normalizing in place", "memory") {
+    std::vector<std::vector<double>> x = {{1, 3}, {5, 7}};
+    const double *data = x[0].data();
+
+    auto result = ml::Normalize(std::move(x), 1, 2);
+    REQUIRE(result[0].data() == data);
+    REQUIRE(result[0][1] == 1);
+    REQUIRE(result[1][1] == 3);
+}
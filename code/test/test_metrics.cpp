@@ -0,0 +1,118 @@
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "binary_svm.h"
+#include "metrics.h"
+#include "multiclass_svm.h"
+
+
+TEST_CASE("histogram buckets", "metrics") {
+    ml::Histogram histogram;
+    REQUIRE(histogram.GetCount() == 0);
+    REQUIRE(histogram.GetMin() == 0);
+    REQUIRE(histogram.GetMean() == 0);
+
+    histogram.Observe(0.5);
+    histogram.Observe(1);
+    histogram.Observe(20);
+    histogram.Observe(1e9);
+
+    REQUIRE(histogram.GetCount() == 4);
+    REQUIRE(histogram.GetSum() == Approx(1e9 + 21.5));
+    REQUIRE(histogram.GetMin() == 0.5);
+    REQUIRE(histogram.GetMax() == 1e9);
+
+    auto &bounds = ml::Histogram::GetBounds();
+    auto counts = histogram.GetCumulativeCounts();
+    REQUIRE(counts.size() == bounds.size() + 1);
+    for (size_t i = 0; i < bounds.size(); ++i) {
+        size_t expected = (bounds[i] >= 0.5) + (bounds[i] >= 1) + (bounds[i] >= 20);
+        REQUIRE(counts[i] == expected);
+    }
+    REQUIRE(counts.back() == 4);
+}
+
+TEST_CASE("metrics registry", "metrics") {
+    ml::Metrics metrics;
+    metrics.Increment("images", 3);
+    metrics.Increment("images");
+    metrics.SetGauge("pair{first=\"1\",second=\"2\"}", 7);
+    metrics.Observe("phase_seconds", 2);
+    metrics.Observe("phase_seconds", 4);
+
+    REQUIRE(metrics.GetCounter("images") == 4);
+    REQUIRE(metrics.GetCounter("missing") == 0);
+    REQUIRE(metrics.GetGauge("pair{first=\"1\",second=\"2\"}") == 7);
+    REQUIRE(metrics.GetHistogram("phase_seconds").GetMean() == 3);
+
+    metrics.Reset();
+    REQUIRE(metrics.GetCounter("images") == 0);
+    REQUIRE(metrics.GetHistogram("phase_seconds").GetCount() == 0);
+}
+
+TEST_CASE("metrics dumps", "metrics") {
+    ml::Metrics metrics;
+    metrics.Increment("phase_items", 10);
+    metrics.Observe("phase_seconds", 2);
+    metrics.SetGauge("pair{first=\"1\",second=\"2\"}", 7);
+    metrics.SetGauge("pair{first=\"1\",second=\"3\"}", 8);
+
+    std::ostringstream json;
+    metrics.WriteJson(json);
+    std::string text = json.str();
+    REQUIRE(text.find("\"phase_items\": 10") != std::string::npos);
+    REQUIRE(text.find("\"pair{first=\\\"1\\\",second=\\\"2\\\"}\": 7") != std::string::npos);
+    REQUIRE(text.find("\"phase_seconds\": {\"count\": 1, \"sum\": 2") != std::string::npos);
+    REQUIRE(text.find("\"phase_items_per_second\": 5") != std::string::npos);
+
+    std::ostringstream prometheus;
+    metrics.WritePrometheus(prometheus);
+    text = prometheus.str();
+    REQUIRE(text.find("mnist_svm_phase_items_total 10\n") != std::string::npos);
+    REQUIRE(text.find("mnist_svm_pair{first=\"1\",second=\"3\"} 8\n") != std::string::npos);
+    REQUIRE(text.find("mnist_svm_phase_seconds_bucket{le=\"1\"} 0\n") != std::string::npos);
+    REQUIRE(text.find("mnist_svm_phase_seconds_bucket{le=\"10\"} 1\n") != std::string::npos);
+    REQUIRE(text.find("mnist_svm_phase_seconds_count 1\n") != std::string::npos);
+    // one type line per metric, not per label set
+    REQUIRE(text.find("# TYPE mnist_svm_pair gauge") == text.rfind("# TYPE mnist_svm_pair gauge"));
+}
+
+TEST_CASE("scoped timer", "metrics") {
+    ml::Metrics metrics;
+    {
+        ml::ScopedTimer timer("phase", metrics);
+        timer.SetNumItems(5);
+        REQUIRE(timer.GetSeconds() >= 0);
+    }
+    {
+        ml::ScopedTimer timer("phase", metrics);
+    }
+
+    REQUIRE(metrics.GetHistogram("phase_seconds").GetCount() == 2);
+    REQUIRE(metrics.GetCounter("phase_items") == 5);
+}
+
+TEST_CASE("training reports solver statistics", "metrics") {
+    std::vector<std::vector<double>> x = {{8}, {7}, {6}, {3}, {2}, {1}};
+    std::vector<int> y = {1, 1, 1, -1, -1, -1};
+
+    ml::BinarySVM svm;
+    svm.Train(x, y, 0.000001);
+    auto &statistics = svm.GetTrainStatistics();
+    REQUIRE(statistics.nb_iterations > 0);
+    REQUIRE(statistics.objective > 0);
+    REQUIRE(statistics.seconds >= 0);
+
+    ml::GetMetrics().Reset();
+    ml::MulticlassSVM multiclass_svm;
+    multiclass_svm.Train(x, {1, 1, 2, 2, 3, 3});
+
+    auto &metrics = ml::GetMetrics();
+    REQUIRE(metrics.GetHistogram("binary_svm_train_seconds").GetCount() == 3);
+    REQUIRE(metrics.GetHistogram("binary_svm_iterations").GetCount() == 3);
+    REQUIRE(metrics.GetCounter("binary_svm_train_items") == 12);
+    REQUIRE(metrics.GetGauge("svm_pair_iterations{first=\"1\",second=\"3\"}") > 0);
+}
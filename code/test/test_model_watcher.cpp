@@ -0,0 +1,75 @@
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "exception.h"
+#include "model_watcher.h"
+#include "multiclass_svm.h"
+#include "util.h"
+
+
+ml::MulticlassSVM MakeConstantModel(size_t nb_dim, const std::vector<int> &labels) {
+    size_t nb_models = labels.size() * (labels.size() - 1) / 2;
+    std::vector<std::vector<double>> models(nb_models, std::vector<double>(nb_dim, 0.5));
+    std::vector<double> biases(nb_models, -1);
+    return ml::MulticlassSVM(models, biases, labels);
+}
+
+TEST_CASE("model watcher swaps in changed models", "model watcher") {
+    std::string path = "test_watcher_model";
+    ml::SaveModel(MakeConstantModel(4, {1, 2}), path + ".svm");
+
+    ml::ModelWatcher watcher(path, false);
+    auto old_predictor = watcher.Get();
+    REQUIRE(old_predictor->GetLabels().size() == 2);
+    REQUIRE_FALSE(watcher.Poll());
+
+    ml::SaveModel(MakeConstantModel(4, {1, 2, 3}), path + ".svm");
+    REQUIRE(watcher.Poll());
+    REQUIRE(watcher.Get()->GetLabels().size() == 3);
+    // holders of the previous model are not affected
+    REQUIRE(old_predictor->GetLabels().size() == 2);
+
+    // input dimensionality must not change, the current model stays
+    ml::SaveModel(MakeConstantModel(5, {1, 2}), path + ".svm");
+    REQUIRE_FALSE(watcher.Poll());
+    REQUIRE(watcher.Get()->GetLabels().size() == 3);
+
+    auto stats = watcher.GetStats();
+    REQUIRE(stats.nb_reloads == 2);
+    REQUIRE(stats.nb_failed_reloads == 1);
+    REQUIRE_FALSE(stats.last_error.empty());
+
+    std::remove((path + ".svm").c_str());
+}
+
+TEST_CASE("model watcher keeps the model when the new one is inconsistent", "model watcher") {
+    std::string path = "test_watcher_inconsistent_model";
+    ml::SaveModel(MakeConstantModel(4, {1, 2, 3}), path + ".svm");
+    ml::ModelWatcher watcher(path, false);
+    auto old_predictor = watcher.Get();
+
+    // 2 models and biases for 3 labels, as a half written model file could have them
+    auto svm = MakeConstantModel(4, {1, 2});
+    std::vector<std::vector<double>> models = {svm.GetModels()[0], svm.GetModels()[0]};
+    std::vector<double> biases = {svm.GetBiases()[0], svm.GetBiases()[0]};
+    ml::SaveModel(ml::MulticlassSVM(models, biases, {1, 2, 3}), path + ".svm");
+    REQUIRE_FALSE(watcher.Poll());
+
+    REQUIRE(watcher.Get() == old_predictor);
+    auto stats = watcher.GetStats();
+    REQUIRE(stats.nb_reloads == 1);
+    REQUIRE(stats.nb_failed_reloads == 1);
+    REQUIRE(stats.last_error.find("inconsistent") != std::string::npos);
+
+    std::remove((path + ".svm").c_str());
+}
+
+TEST_CASE("model watcher without model", "model watcher") {
+    REQUIRE_THROWS_AS(ml::ModelWatcher("missing_watcher_model", false), ml::Exception);
+
+    auto loader = []() -> ml::SharedPredictor { throw ml::Exception("broken model"); };
+    REQUIRE_THROWS_AS(ml::ModelWatcher(std::vector<std::string>(), loader), ml::Exception);
+}
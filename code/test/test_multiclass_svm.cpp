@@ -3,8 +3,11 @@
 
 #include <catch.hpp>
 
+#include "blobs.h"
 #include "multiclass_svm.h"
 #include "exception.h"
+#include "metrics.h"
+#include "util.h"
 
 
 TEST_CASE("empty multiclass model", "multiclass svm") {
@@ -68,6 +71,19 @@ TEST_CASE("initializing multiclass models and biases", "multiclass svm") {
     REQUIRE(predictions[5] == Approx(y[5]));
 }
 
+TEST_CASE("multiclass vote ties are broken by margins", "multiclass svm") {
+    // every label gets exactly one vote
+    std::vector<std::vector<double>> models = {{0}, {0}, {0}};
+    std::vector<double> biases = {1, -1, 3};
+    std::vector<int> labels = {1, 2, 3};
+
+    ml::MulticlassSVM svm(models, biases, labels);
+
+    auto predictions = svm.Predict({{1}, {2}});
+    REQUIRE(predictions[0] == 3);
+    REQUIRE(predictions[1] == 3);
+}
+
 TEST_CASE("checking inconsistent multiclass input", "multiclass svm") {
     std::vector<std::vector<double>> models = {
         {0.9986288825},
@@ -84,3 +100,76 @@ TEST_CASE("checking inconsistent multiclass input", "multiclass svm") {
     REQUIRE_THROWS_AS(svm.Predict(x), ml::Exception);
 }
 
+
+TEST_CASE("stratified sample keeps label proportions", "multiclass svm") {
+    std::vector<int> y;
+    for (size_t k = 0; k < 1000; ++k) {
+        y.push_back(k < 900 ? 7 : 3);
+    }
+    y.push_back(5);
+
+    auto sample = ml::StratifiedSample(y, 0.1, 1);
+    size_t counts[3] = {0, 0, 0};
+    for (size_t k = 0; k < sample.size(); ++k) {
+        if (k > 0) {
+            REQUIRE(sample[k - 1] < sample[k]);
+        }
+        counts[y[sample[k]] == 7 ? 0 : y[sample[k]] == 3 ? 1 : 2]++;
+    }
+    REQUIRE(counts[0] == 90);
+    REQUIRE(counts[1] == 10);
+    // every label keeps at least one row
+    REQUIRE(counts[2] == 1);
+    REQUIRE(ml::StratifiedSample(y, 0.1, 1) == sample);
+    REQUIRE(ml::StratifiedSample(y, 1, 1).size() == y.size());
+}
+
+TEST_CASE("zero weights leave rows out", "multiclass svm") {
+    std::vector<std::vector<double>> x = {{1}, {2}, {3}, {4}, {5}, {6}, {1.5}};
+    // the last row would pull the boundary between 2 and 3 below 2
+    std::vector<int> y = {1, 1, 2, 2, 3, 3, 3};
+    std::vector<double> weights = {1, 1, 1, 1, 1, 1, 0};
+
+    ml::TrainOptions options;
+    options.lambda = 0.00001;
+    options.bias_multiplier = 5;
+    options.solver = ml::SolverType::Dcd;
+    options.epsilon = 0.00001;
+
+    ml::MulticlassSVM svm;
+    svm.Train(x, y, options, weights);
+    auto predictions = svm.Predict(x);
+    for (size_t k = 0; k < 6; ++k) {
+        REQUIRE(predictions[k] == y[k]);
+    }
+
+    weights.pop_back();
+    REQUIRE_THROWS_AS(svm.Train(x, y, options, weights), ml::Exception);
+    options.subsample = 0;
+    REQUIRE_THROWS_AS(svm.Train(x, y, options), ml::Exception);
+}
+
+TEST_CASE("subsampled pairs with hard example re-mining", "multiclass svm") {
+    std::vector<std::vector<double>> x;
+    std::vector<int> y;
+    MakeBlobs({3000, 600, 300}, {0, 1, 2}, 5, 3, x, y);
+
+    ml::TrainOptions options;
+    options.lambda = 0.001;
+    options.solver = ml::SolverType::Dcd;
+    options.balance_classes = true;
+    ml::MulticlassSVM full;
+    full.Train(x, y, options);
+
+    options.subsample = 0.1;
+    options.remine_hard_examples = true;
+    ml::MulticlassSVM subsampled;
+    subsampled.Train(x, y, options);
+
+    REQUIRE(ml::Accuracy(subsampled.Predict(x), y) > ml::Accuracy(full.Predict(x), y) - 0.02);
+    ml::Metrics &metrics = ml::GetMetrics();
+    double nb_rows = metrics.GetGauge("svm_pair_rows{first=\"0\",second=\"1\"}");
+    REQUIRE(nb_rows < 3600 / 2);
+    REQUIRE(nb_rows > 360);
+    REQUIRE(metrics.GetGauge("svm_pair_hard_examples{first=\"0\",second=\"1\"}") == nb_rows - 360);
+}
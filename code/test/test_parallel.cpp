@@ -0,0 +1,73 @@
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "binary_svm.h"
+#include "multiclass_svm.h"
+#include "parallel.h"
+#include "thread_pool.h"
+
+
+TEST_CASE("parallel for covers every item once", "parallel") {
+    for (size_t nb_threads : {1, 3, 8}) {
+        ml::SetNumThreads(nb_threads);
+        std::vector<int> visits(1000, 0);
+        std::vector<size_t> chunk_begins(ml::GetNumChunks(visits.size(), 10), visits.size());
+
+        ml::ParallelFor(visits.size(), 10, [&](size_t begin, size_t end, size_t chunk) {
+            chunk_begins[chunk] = begin;
+            for (size_t i = begin; i < end; ++i) {
+                ++visits[i];
+            }
+        });
+
+        REQUIRE(chunk_begins.size() == nb_threads);
+        REQUIRE(chunk_begins[0] == 0);
+        for (auto count : visits) {
+            REQUIRE(count == 1);
+        }
+    }
+    ml::SetNumThreads(0);
+}
+
+TEST_CASE("thread pool runs nested batches and rethrows", "parallel") {
+    ml::ThreadPool pool(3);
+    std::atomic<int> counter(0);
+
+    pool.Run(20, [&](size_t) {
+        pool.Run(10, [&](size_t) {
+            ++counter;
+        });
+    });
+    REQUIRE(counter.load() == 200);
+
+    REQUIRE_THROWS_AS(pool.Run(5, [&](size_t task) {
+        if (task == 3) {
+            throw std::runtime_error("task failed");
+        }
+    }), std::runtime_error);
+}
+
+TEST_CASE("parallel predict is deterministic", "parallel") {
+    std::vector<std::vector<double>> models = {{2.99943}, {1.99984}, {2.99876}};
+    std::vector<double> biases = {-7.49945, -5.4998, -13.4973};
+    std::vector<int> labels = {1, 2, 3};
+    ml::MulticlassSVM svm(models, biases, labels);
+
+    std::vector<std::vector<double>> x;
+    for (int i = 0; i < 5000; ++i) {
+        x.push_back({(i % 70) / 10.0});
+    }
+
+    ml::SetNumThreads(1);
+    auto expected = svm.Predict(x);
+    ml::BinarySVM binary(models[0], biases[0]);
+    auto expected_binary = binary.Predict(x);
+
+    ml::SetNumThreads(4);
+    REQUIRE(svm.Predict(x) == expected);
+    REQUIRE(binary.Predict(x) == expected_binary);
+    ml::SetNumThreads(0);
+}
@@ -0,0 +1,86 @@
+#include <cmath>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "exception.h"
+#include "pca.h"
+#include "util.h"
+
+
+std::vector<std::vector<double>> MakeCorrelatedData(size_t nb_data) {
+    // most of the variance lies along (1, 1, 0)
+    std::vector<std::vector<double>> x;
+    for (size_t i = 0; i < nb_data; ++i) {
+        double t = std::sin(0.37 * i) * 3;
+        double noise = std::cos(1.13 * i) * 0.1;
+        x.push_back({t + noise + 1, t - noise + 2, std::sin(2.71 * i) * 0.05});
+    }
+    return x;
+}
+
+TEST_CASE("covariance accumulator merge", "pca") {
+    auto x = MakeCorrelatedData(300);
+
+    ml::CovarianceAccumulator whole(3);
+    whole.Add(x, 0, x.size());
+
+    ml::CovarianceAccumulator first(3), second(3);
+    first.Add(x, 0, 100);
+    second.Add(x, 100, x.size());
+    first.Merge(second);
+
+    REQUIRE(first.GetCount() == x.size());
+    auto expected = whole.GetCovariance();
+    auto merged = first.GetCovariance();
+    for (int j = 0; j < 3; ++j) {
+        REQUIRE(first.GetMean()[j] == Approx(whole.GetMean()[j]));
+        for (int k = 0; k < 3; ++k) {
+            REQUIRE(merged.at<double>(j, k) == Approx(expected.at<double>(j, k)));
+        }
+    }
+}
+
+TEST_CASE("covariance pca finds main direction", "pca") {
+    auto x = MakeCorrelatedData(500);
+    auto pca = ml::CreatePCA(x, 0.95);
+
+    REQUIRE(pca.mean.cols == 3);
+    REQUIRE(pca.eigenvectors.cols == 3);
+    REQUIRE(pca.eigenvectors.rows >= 1);
+    REQUIRE(std::fabs(pca.eigenvectors.at<double>(0, 0)) == Approx(std::sqrt(0.5)).epsilon(0.01));
+    REQUIRE(std::fabs(pca.eigenvectors.at<double>(0, 1)) == Approx(std::sqrt(0.5)).epsilon(0.01));
+}
+
+TEST_CASE("randomized pca matches covariance pca", "pca") {
+    auto x = MakeCorrelatedData(500);
+    auto exact = ml::CreatePCA(x, 0.95, ml::PCAMethod::Covariance);
+    auto randomized = ml::CreatePCA(x, 0.95, ml::PCAMethod::Randomized);
+
+    REQUIRE(randomized.eigenvectors.rows == exact.eigenvectors.rows);
+    for (int j = 0; j < 3; ++j) {
+        REQUIRE(randomized.mean.at<double>(0, j) == Approx(exact.mean.at<double>(0, j)));
+    }
+    for (int i = 0; i < exact.eigenvalues.rows; ++i) {
+        REQUIRE(randomized.eigenvalues.at<double>(i, 0) ==
+                Approx(exact.eigenvalues.at<double>(i, 0)).epsilon(0.001));
+    }
+
+    auto projected_exact = ml::ProjectPCA(exact, x);
+    auto projected_randomized = ml::ProjectPCA(randomized, x);
+    for (size_t i = 0; i < x.size(); ++i) {
+        // eigenvectors are defined up to a sign
+        REQUIRE(std::fabs(projected_randomized[i][0]) ==
+                Approx(std::fabs(projected_exact[i][0])).margin(1e-6));
+    }
+}
+
+TEST_CASE("pca of empty input", "pca") {
+    std::vector<std::vector<double>> x;
+    REQUIRE_THROWS_AS(ml::CreatePCA(x, 0.95), ml::Exception);
+    REQUIRE_THROWS_AS(ml::CreatePCA(x, 0.95, ml::PCAMethod::Randomized), ml::Exception);
+
+    // classifying an empty description projects nothing
+    auto pca = ml::CreatePCA({{1, 2}, {2, 1}, {3, 5}}, 0.95);
+    REQUIRE(ml::ProjectPCA(pca, x).empty());
+}
@@ -0,0 +1,102 @@
+#include <vector>
+
+#include <catch.hpp>
+
+#include "binary_svm.h"
+#include "blobs.h"
+#include "exception.h"
+#include "parallel.h"
+#include "pegasos.h"
+#include "util.h"
+
+
+TEST_CASE("pegasos separates linearly separable data", "pegasos") {
+    std::vector<std::vector<double>> x = {{8}, {7}, {6}, {3}, {2}, {1}};
+    std::vector<int> y = {1, 1, 1, -1, -1, -1};
+
+    ml::TrainOptions options;
+    options.lambda = 0.001;
+    options.bias_multiplier = 5;
+    options.solver = ml::SolverType::Pegasos;
+    options.batch_size = 2;
+
+    ml::BinarySVM svm;
+    svm.Train(x, y, options);
+    REQUIRE(svm.Predict(x) == y);
+    REQUIRE(svm.GetTrainStatistics().nb_iterations > 0);
+}
+
+TEST_CASE("pegasos is on par with vlfeat sgd", "pegasos") {
+    std::vector<std::vector<double>> x;
+    std::vector<int> y;
+    MakeBinaryBlobs(2000, 40, 2.5, x, y);
+
+    ml::TrainOptions options;
+    options.lambda = 0.001;
+    ml::BinarySVM sgd;
+    sgd.Train(x, y, options);
+
+    options.solver = ml::SolverType::Pegasos;
+    ml::BinarySVM pegasos;
+    pegasos.Train(x, y, options);
+
+    REQUIRE(pegasos.GetModel().size() == 40);
+    REQUIRE(ml::Accuracy(pegasos.Predict(x), y) > ml::Accuracy(sgd.Predict(x), y) - 0.01);
+    REQUIRE(pegasos.GetTrainStatistics().objective <
+            sgd.GetTrainStatistics().objective * 1.05);
+}
+
+TEST_CASE("pegasos result doesn't depend on the number of threads", "pegasos") {
+    std::vector<std::vector<double>> x;
+    std::vector<int> y;
+    MakeBinaryBlobs(1000, 1500, 2.5, x, y);
+
+    ml::TrainOptions options;
+    options.lambda = 0.01;
+    options.batch_size = 128;
+
+    std::vector<size_t> rows(x.size());
+    for (size_t i = 0; i < rows.size(); ++i) {
+        rows[i] = i;
+    }
+
+    std::vector<double> models[2];
+    double biases[2];
+    size_t nb_threads[2] = {1, 4};
+    for (size_t k = 0; k < 2; ++k) {
+        ml::SetNumThreads(nb_threads[k]);
+        ml::TrainPegasos(x, rows, y, {}, options, models[k], biases[k]);
+    }
+    ml::SetNumThreads(0);
+
+    REQUIRE(models[0] == models[1]);
+    REQUIRE(biases[0] == biases[1]);
+}
+
+TEST_CASE("pegasos with squared hinge and logistic losses", "pegasos") {
+    std::vector<std::vector<double>> x;
+    std::vector<int> y;
+    MakeBinaryBlobs(1000, 20, 2.5, x, y);
+
+    ml::TrainOptions options;
+    options.lambda = 0.001;
+    options.solver = ml::SolverType::Pegasos;
+    options.batch_size = 32;
+    options.max_iterations = 3000;
+
+    ml::BinarySVM hinge;
+    hinge.Train(x, y, options);
+    for (auto loss : {ml::LossType::Hinge2, ml::LossType::Logistic}) {
+        options.loss = loss;
+        ml::BinarySVM svm;
+        svm.Train(x, y, options);
+        REQUIRE(svm.GetTrainStatistics().nb_iterations == 3000);
+        REQUIRE(ml::Accuracy(svm.Predict(x), y) > ml::Accuracy(hinge.Predict(x), y) - 0.02);
+    }
+}
+
+TEST_CASE("unknown solver", "pegasos") {
+    REQUIRE(ml::ParseSolverType("sgd") == ml::SolverType::Sgd);
+    REQUIRE(ml::ParseSolverType("pegasos") == ml::SolverType::Pegasos);
+    REQUIRE_THROWS_AS(ml::ParseSolverType("newton"), ml::Exception);
+}
@@ -0,0 +1,116 @@
+#include <atomic>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+#include <opencv2/opencv.hpp>
+
+#include "bounded_queue.h"
+#include "multiclass_svm.h"
+#include "pipeline.h"
+#include "predictor.h"
+
+
+TEST_CASE("bounded queue push and pop", "pipeline") {
+    ml::BoundedQueue<int> queue(3);
+    REQUIRE(queue.GetCapacity() == 4);
+
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.TryPush(i));
+    }
+    int value = 10;
+    REQUIRE_FALSE(queue.TryPush(value));
+    REQUIRE(queue.GetSize() == 4);
+
+    for (int i = 0; i < 4; ++i) {
+        REQUIRE(queue.TryPop(value));
+        REQUIRE(value == i);
+    }
+    REQUIRE_FALSE(queue.TryPop(value));
+}
+
+TEST_CASE("bounded queue with several producers and consumers", "pipeline") {
+    const int nb_items = 20000;
+    ml::BoundedQueue<int> queue(64);
+    std::atomic<long long> sum(0);
+    std::atomic<int> nb_popped(0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 2; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int i = t; i < nb_items; i += 2) {
+                int value = i;
+                while (!queue.TryPush(value)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        threads.emplace_back([&]() {
+            int value;
+            while (nb_popped.load() < nb_items) {
+                if (queue.TryPop(value)) {
+                    sum += value;
+                    ++nb_popped;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    REQUIRE(sum.load() == static_cast<long long>(nb_items) * (nb_items - 1) / 2);
+}
+
+std::vector<std::string> WritePipelineImages(size_t nb_images) {
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < nb_images; ++i) {
+        cv::Mat mat(2, 2, CV_8UC1);
+        for (int r = 0; r < 2; ++r) {
+            for (int c = 0; c < 2; ++c) {
+                mat.at<uchar>(r, c) = static_cast<uchar>((i * 37 + r * 11 + c * 5) % 256);
+            }
+        }
+        paths.push_back("test_pipeline_image_" + std::to_string(i) + ".png");
+        cv::imwrite(paths.back(), mat);
+    }
+    return paths;
+}
+
+TEST_CASE("pipelined classification keeps input order", "pipeline") {
+    auto image_paths = WritePipelineImages(100);
+    std::vector<std::vector<double>> models = {{1, -1, 0, 0}, {0, 1, -1, 0}, {0, 0, 1, -1}};
+    ml::Predictor predictor(ml::MulticlassSVM(models, {0.5, -3, 1}, {1, 2, 3}));
+
+    std::ostringstream expected;
+    for (auto &path : image_paths) {
+        cv::Mat mat = cv::imread(path, 0);
+        std::vector<uint8_t> pixels = {mat.at<uchar>(0, 0), mat.at<uchar>(0, 1),
+                                       mat.at<uchar>(1, 0), mat.at<uchar>(1, 1)};
+        expected << path << " " << predictor.PredictOne(pixels.data()) << "\n";
+    }
+
+    for (size_t nb_workers : {1, 3}) {
+        ml::PipelineOptions options;
+        options.nb_workers = nb_workers;
+        options.queue_capacity = 4;
+        std::ostringstream output;
+        auto stats = ml::ClassifyPipelined(predictor, image_paths, output, options);
+        REQUIRE(output.str() == expected.str());
+        REQUIRE(stats.nb_images == image_paths.size());
+        REQUIRE(stats.decoded_occupancy <= 1);
+    }
+
+    // a missing image fails the whole job
+    std::remove(image_paths[50].c_str());
+    std::ostringstream output;
+    REQUIRE_THROWS(ml::ClassifyPipelined(predictor, image_paths, output));
+
+    for (auto &path : image_paths) {
+        std::remove(path.c_str());
+    }
+}
@@ -0,0 +1,144 @@
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "exception.h"
+#include "multiclass_svm.h"
+#include "predictor.h"
+#include "quadratic.h"
+#include "util.h"
+
+
+std::vector<std::vector<uint8_t>> MakeImages(size_t nb_images, size_t nb_dim) {
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> pixel(0, 255);
+    std::vector<std::vector<uint8_t>> images(nb_images, std::vector<uint8_t>(nb_dim));
+    for (auto &image : images) {
+        // a few smooth patterns so pca keeps a handful of components
+        double phase = pixel(generator) / 40.0;
+        for (size_t j = 0; j < nb_dim; ++j) {
+            double value = 128 + 100 * std::sin(phase + 0.3 * j) + pixel(generator) / 16.0;
+            image[j] = static_cast<uint8_t>(value);
+        }
+    }
+    return images;
+}
+
+ml::MulticlassSVM MakeRandomModel(size_t nb_dim, const std::vector<int> &labels) {
+    std::mt19937 generator(11);
+    std::normal_distribution<double> normal(0, 1);
+    size_t nb_models = labels.size() * (labels.size() - 1) / 2;
+    std::vector<std::vector<double>> models(nb_models, std::vector<double>(nb_dim));
+    std::vector<double> biases(nb_models);
+    for (size_t i = 0; i < nb_models; ++i) {
+        for (auto &value : models[i]) {
+            value = normal(generator);
+        }
+        biases[i] = normal(generator);
+    }
+    return ml::MulticlassSVM(models, biases, labels);
+}
+
+ml::Matrix ToMatrix(const std::vector<std::vector<uint8_t>> &images) {
+    ml::Matrix x;
+    for (auto &image : images) {
+        x.emplace_back(image.begin(), image.end());
+    }
+    return x;
+}
+
+TEST_CASE("predictor on raw pixels matches multiclass svm", "predictor") {
+    auto images = MakeImages(50, 20);
+    auto svm = MakeRandomModel(20, {0, 3, 5, 8});
+    auto expected = svm.Predict(ToMatrix(images));
+
+    ml::Predictor predictor(svm);
+    ml::PredictorScratch scratch;
+    REQUIRE(predictor.GetInputDim() == 20);
+    for (size_t i = 0; i < images.size(); ++i) {
+        REQUIRE(predictor.PredictOne(images[i].data(), scratch) == expected[i]);
+        REQUIRE(predictor.PredictOne(images[i].data()) == expected[i]);
+    }
+}
+
+TEST_CASE("preprocessed predictor matches batch pipeline", "predictor") {
+    auto images = MakeImages(200, 24);
+    auto out = ml::Normalize(ToMatrix(images));
+    double mean = std::get<1>(out);
+    double std_dev = std::get<2>(out);
+    auto pca = ml::CreatePCA(std::get<0>(out), 0.9);
+    auto projected = ml::ProjectPCA(pca, std::get<0>(out));
+
+    for (bool with_squares : {false, true}) {
+        auto x = ml::AddQuadraticInteractions(projected, with_squares);
+        auto svm = MakeRandomModel(x.at(0).size(), {1, 2, 3});
+        auto expected = svm.Predict(x);
+
+        ml::Predictor predictor(svm, pca, mean, std_dev);
+        REQUIRE(predictor.HasSquares() == with_squares);
+        REQUIRE(predictor.GetModelDim() == x.at(0).size());
+        ml::PredictorScratch scratch;
+        for (size_t i = 0; i < images.size(); ++i) {
+            REQUIRE(predictor.PredictOne(images[i].data(), scratch) == expected[i]);
+        }
+        REQUIRE(predictor.Predict(ToMatrix(images)) == expected);
+
+        std::vector<double> rows;
+        for (auto &row : projected) {
+            rows.insert(rows.end(), row.begin(), row.end());
+        }
+        REQUIRE(predictor.PredictProjected(rows.data(), projected.size()) == expected);
+    }
+}
+
+TEST_CASE("predictor with inconsistent pca", "predictor") {
+    auto images = MakeImages(100, 12);
+    auto pca = ml::CreatePCA(ToMatrix(images), 0.9);
+    auto svm = MakeRandomModel(ml::GetQuadraticDim(pca.eigenvectors.rows) + 1, {1, 2});
+    REQUIRE_THROWS_AS(ml::Predictor(svm, pca, 0, 1), ml::Exception);
+    REQUIRE_THROWS_AS(ml::Predictor(ml::MulticlassSVM()), ml::Exception);
+}
+
+TEST_CASE("predictor with inconsistent models, biases and labels", "predictor") {
+    auto svm = MakeRandomModel(4, {1, 2, 3});
+    auto models = svm.GetModels();
+    auto biases = svm.GetBiases();
+
+    // 2 models for 3 labels, as a damaged model file would have them
+    std::vector<std::vector<double>> fewer_models(models.begin(), models.begin() + 2);
+    std::vector<double> fewer_biases(biases.begin(), biases.begin() + 2);
+    REQUIRE_THROWS_AS(ml::Predictor(ml::MulticlassSVM(fewer_models, fewer_biases, {1, 2, 3})), ml::Exception);
+    REQUIRE_THROWS_AS(ml::Predictor(ml::MulticlassSVM(models, fewer_biases, {1, 2, 3})), ml::Exception);
+    REQUIRE_THROWS_AS(ml::Predictor(ml::MulticlassSVM(models, biases, {1, 2})), ml::Exception);
+    REQUIRE_NOTHROW(ml::Predictor(ml::MulticlassSVM(models, biases, {1, 2, 3})));
+}
+
+TEST_CASE("predictor shared between threads", "predictor") {
+    auto images = MakeImages(300, 16);
+    auto x = ToMatrix(images);
+    ml::SharedPredictor predictor =
+        std::make_shared<const ml::Predictor>(MakeRandomModel(16, {1, 2, 3, 4, 5}));
+    auto expected = predictor->Predict(x);
+
+    std::vector<std::vector<int>> results(4, std::vector<int>(images.size()));
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < results.size(); ++t) {
+        threads.emplace_back([&, t]() {
+            for (size_t i = 0; i < images.size(); ++i) {
+                results[t][i] = predictor->PredictOne(images[i].data());
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (auto &result : results) {
+        REQUIRE(result == expected);
+    }
+}
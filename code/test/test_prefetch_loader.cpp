@@ -0,0 +1,112 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <catch.hpp>
+#include <opencv2/opencv.hpp>
+
+#include "exception.h"
+#include "parallel.h"
+#include "pca.h"
+#include "prefetch_loader.h"
+#include "util.h"
+
+
+std::string WritePrefetchData(size_t nb_images) {
+    std::string data_path = "test_prefetch_description.txt";
+    std::ofstream description(data_path);
+    for (size_t i = 0; i < nb_images; ++i) {
+        cv::Mat mat(3, 3, CV_8UC1);
+        for (int r = 0; r < 3; ++r) {
+            for (int c = 0; c < 3; ++c) {
+                mat.at<uchar>(r, c) = static_cast<uchar>((i * (r + 1) * 7 + c * c * 13) % 256);
+            }
+        }
+        std::string path = "test_prefetch_image_" + std::to_string(i) + ".png";
+        cv::imwrite(path, mat);
+        description << path << " " << i % 3 << "\n";
+    }
+    return data_path;
+}
+
+void RemovePrefetchData(size_t nb_images) {
+    for (size_t i = 0; i < nb_images; ++i) {
+        std::remove(("test_prefetch_image_" + std::to_string(i) + ".png").c_str());
+    }
+    std::remove("test_prefetch_description.txt");
+}
+
+TEST_CASE("prefetch loader hands out batches in order", "prefetch loader") {
+    auto data_path = WritePrefetchData(50);
+    auto expected = ml::ReadData(data_path);
+
+    ml::PrefetchLoader loader(data_path, true, 4, 2, 3);
+    REQUIRE(loader.GetNumImages() == 50);
+    ml::ImageBatch batch;
+    size_t nb_images = 0;
+    while (loader.Next(batch)) {
+        REQUIRE(batch.begin == nb_images);
+        for (size_t i = 0; i < batch.x.size(); ++i) {
+            REQUIRE(batch.x[i] == std::get<0>(expected)[batch.begin + i]);
+            REQUIRE(batch.y[i] == std::get<1>(expected)[batch.begin + i]);
+        }
+        nb_images += batch.x.size();
+    }
+    REQUIRE(nb_images == 50);
+    RemovePrefetchData(50);
+}
+
+TEST_CASE("streamed statistics match normalized pca", "prefetch loader") {
+    auto data_path = WritePrefetchData(300);
+    ml::PixelStatistics statistics;
+    auto data = ml::ReadDataWithStatistics(data_path, statistics);
+    RemovePrefetchData(300);
+
+    auto out = ml::Normalize(std::get<0>(data));
+    REQUIRE(statistics.mean == Approx(std::get<1>(out)));
+    REQUIRE(statistics.std_dev == Approx(std::get<2>(out)));
+
+    auto expected = ml::CreatePCA(std::get<0>(out), 0.9);
+    auto pca = ml::PCAFromScaledCovariance(statistics.covariance, statistics.mean,
+                                           statistics.std_dev, 0.9);
+    REQUIRE(pca.eigenvectors.rows == expected.eigenvectors.rows);
+    for (int j = 0; j < pca.mean.cols; ++j) {
+        REQUIRE(pca.mean.at<double>(0, j) == Approx(expected.mean.at<double>(0, j)).margin(1e-9));
+    }
+    for (int i = 0; i < pca.eigenvalues.rows; ++i) {
+        REQUIRE(pca.eigenvalues.at<double>(i, 0) == Approx(expected.eigenvalues.at<double>(i, 0)));
+    }
+}
+
+TEST_CASE("streamed statistics don't depend on the number of decoders", "prefetch loader") {
+    auto data_path = WritePrefetchData(1000);
+    ml::PixelStatistics statistics[2];
+    size_t nb_threads[2] = {1, 4};
+    for (size_t k = 0; k < 2; ++k) {
+        ml::SetNumThreads(nb_threads[k]);
+        ml::ReadDataWithStatistics(data_path, statistics[k]);
+    }
+    ml::SetNumThreads(0);
+    RemovePrefetchData(1000);
+
+    REQUIRE(statistics[1].mean == statistics[0].mean);
+    REQUIRE(statistics[1].std_dev == statistics[0].std_dev);
+    REQUIRE(statistics[1].covariance.GetCount() == 1000);
+    REQUIRE(statistics[1].covariance.GetMean() == statistics[0].covariance.GetMean());
+    cv::Mat covariance[2] = {statistics[0].covariance.GetCovariance(), statistics[1].covariance.GetCovariance()};
+    for (int i = 0; i < covariance[0].rows; ++i) {
+        for (int j = 0; j < covariance[0].cols; ++j) {
+            REQUIRE(covariance[1].at<double>(i, j) == covariance[0].at<double>(i, j));
+        }
+    }
+}
+
+TEST_CASE("prefetch loader with missing image", "prefetch loader") {
+    auto data_path = WritePrefetchData(20);
+    std::remove("test_prefetch_image_13.png");
+
+    ml::PixelStatistics statistics;
+    REQUIRE_THROWS(ml::ReadDataWithStatistics(data_path, statistics));
+    RemovePrefetchData(20);
+}
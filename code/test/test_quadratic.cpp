@@ -0,0 +1,55 @@
+#include <cstdint>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "dense_matrix.h"
+#include "quadratic.h"
+#include "util.h"
+
+
+TEST_CASE("quadratic dimensionality", "quadratic") {
+    REQUIRE(ml::GetQuadraticDim(1) == 1);
+    REQUIRE(ml::GetQuadraticDim(3) == 6);
+    REQUIRE(ml::GetQuadraticDim(3, true) == 9);
+    REQUIRE(ml::GetQuadraticDim(40) == 40 + 780);
+}
+
+TEST_CASE("packed upper triangular order", "quadratic") {
+    std::vector<double> x = {1, 2, 3};
+
+    std::vector<double> out(ml::GetQuadraticDim(3));
+    ml::ExpandQuadratic(x.data(), x.size(), out.data());
+    REQUIRE(out == std::vector<double>({1, 2, 3, 2, 3, 6}));
+
+    std::vector<double> squares(ml::GetQuadraticDim(3, true));
+    ml::ExpandQuadratic(x.data(), x.size(), squares.data(), true);
+    REQUIRE(squares == std::vector<double>({1, 2, 3, 1, 2, 3, 4, 6, 9}));
+}
+
+TEST_CASE("expansion of many rows", "quadratic") {
+    std::vector<std::vector<double>> x;
+    for (int i = 0; i < 500; ++i) {
+        x.push_back({0.5 * i, -1.0 * i, 2.0, 0.25 * i});
+    }
+
+    auto expanded = ml::AddQuadraticInteractions(x);
+    auto dense = ml::ExpandQuadratic(x);
+
+    REQUIRE(dense.GetRows() == x.size());
+    REQUIRE(dense.GetCols() == ml::GetQuadraticDim(4));
+    for (size_t i = 0; i < x.size(); ++i) {
+        REQUIRE(expanded[i].size() == ml::GetQuadraticDim(4));
+        REQUIRE(reinterpret_cast<uintptr_t>(dense.Row(i)) % ml::CACHE_LINE_SIZE == 0);
+        REQUIRE(expanded[i][4] == x[i][0] * x[i][1]);
+        REQUIRE(expanded[i][9] == x[i][2] * x[i][3]);
+        for (size_t j = 0; j < dense.GetCols(); ++j) {
+            REQUIRE(dense.Row(i)[j] == expanded[i][j]);
+        }
+    }
+}
+
+TEST_CASE("quadratic expansion of inconsistent input", "quadratic") {
+    std::vector<std::vector<double>> x = {{1, 2}, {3}};
+    REQUIRE_THROWS_AS(ml::AddQuadraticInteractions(x), ml::Exception);
+}
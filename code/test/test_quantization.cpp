@@ -0,0 +1,82 @@
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "exception.h"
+#include "multiclass_svm.h"
+#include "quantization.h"
+#include "util.h"
+
+
+TEST_CASE("symmetric int8 quantization", "quantization") {
+    std::vector<double> values = {0.5, -1.27, 0.01, 1.0, 0};
+    std::vector<int8_t> quantized(values.size());
+    double scale = ml::QuantizeValues(values.data(), values.size(), quantized.data());
+
+    REQUIRE(scale == Approx(0.01));
+    REQUIRE(quantized[1] == -127);
+    for (size_t i = 0; i < values.size(); ++i) {
+        REQUIRE(std::fabs(quantized[i] * scale - values[i]) <= scale / 2 + 1e-12);
+    }
+
+    std::vector<double> zeros(3, 0);
+    REQUIRE(ml::QuantizeValues(zeros.data(), zeros.size(), quantized.data()) == 0);
+}
+
+TEST_CASE("int8 dot product is exact", "quantization") {
+    std::mt19937 generator(7);
+    std::uniform_int_distribution<int> uniform(-127, 127);
+
+    for (size_t nb_dim : {0, 1, 15, 16, 17, 63, 64, 65, 200, 1830}) {
+        std::vector<int8_t> v1(nb_dim), v2(nb_dim);
+        int32_t expected = 0;
+        for (size_t i = 0; i < nb_dim; ++i) {
+            v1[i] = static_cast<int8_t>(uniform(generator));
+            v2[i] = static_cast<int8_t>(uniform(generator));
+            expected += int32_t(v1[i]) * v2[i];
+        }
+        REQUIRE(ml::Int8DotProduct(v1.data(), v2.data(), nb_dim) == expected);
+    }
+}
+
+TEST_CASE("quantized multiclass prediction", "quantization") {
+    std::vector<std::vector<double>> models = {{2.99943}, {1.99984}, {2.99876}};
+    std::vector<double> biases = {-7.49945, -5.4998, -13.4973};
+    std::vector<int> labels = {1, 2, 3};
+    ml::MulticlassSVM svm(models, biases, labels);
+    auto quantized = ml::QuantizedMulticlassSVM::Quantize(svm);
+
+    std::vector<std::vector<double>> x = {{1}, {2}, {3}, {4}, {5}, {6}};
+    auto expected = svm.Predict(x);
+    REQUIRE(quantized.Predict(x, false) == expected);
+    REQUIRE(quantized.Predict(x, true) == expected);
+
+    std::vector<std::vector<double>> inconsistent = {{1, 2}};
+    REQUIRE_THROWS_AS(quantized.Predict(inconsistent), ml::Exception);
+}
+
+TEST_CASE("quantized model file round trip", "quantization") {
+    std::vector<std::vector<double>> models = {{0.5, -1, 0.25}, {2, 0.25, -0.125}, {1, 1, 1}};
+    std::vector<double> biases = {0.125, -3, 7};
+    std::vector<int> labels = {4, 7, 9};
+    auto quantized = ml::QuantizedMulticlassSVM::Quantize(ml::MulticlassSVM(models, biases, labels));
+
+    std::string path = "test_quantized_model.qsvm";
+    ml::SaveQuantizedModel(quantized, path);
+    auto loaded = ml::ReadQuantizedModel(path);
+    std::remove(path.c_str());
+
+    REQUIRE(loaded.GetLabels() == labels);
+    REQUIRE(loaded.GetDim() == 3);
+    for (size_t i = 0; i < models.size(); ++i) {
+        REQUIRE(loaded.GetModels()[i].weights == quantized.GetModels()[i].weights);
+        REQUIRE(loaded.GetModels()[i].scale == quantized.GetModels()[i].scale);
+        REQUIRE(loaded.GetModels()[i].bias == biases[i]);
+    }
+
+    REQUIRE_THROWS(ml::ReadQuantizedModel("missing_model.qsvm"));
+}
@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <catch.hpp>
+
+#include "exception.h"
+#include "multiclass_svm.h"
+#include "sparse_svm.h"
+#include "util.h"
+
+
+TEST_CASE("gather dot product", "sparse svm") {
+    std::vector<double> x(100);
+    for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = 0.5 * i - 7;
+    }
+
+    for (size_t nb_values : {0, 3, 8, 13, 50}) {
+        std::vector<uint32_t> indices;
+        std::vector<double> values;
+        double expected = 0;
+        for (size_t i = 0; i < nb_values; ++i) {
+            indices.push_back((i * 7) % x.size());
+            values.push_back(1.0 / (i + 1));
+            expected += values.back() * x[indices.back()];
+        }
+        REQUIRE(ml::GatherDotProduct(indices.data(), values.data(), nb_values, x.data()) ==
+                Approx(expected));
+    }
+}
+
+TEST_CASE("pruning keeps largest weights", "sparse svm") {
+    std::vector<std::vector<double>> models = {
+        {0.1, -3, 0.01, 2},
+        {1, 0, -0.5, 0.2},
+        {-4, 0.3, 0.2, 0.1}
+    };
+    std::vector<double> biases = {1, 2, 3};
+    std::vector<int> labels = {1, 2, 3};
+    ml::MulticlassSVM svm(models, biases, labels);
+
+    auto sparse = ml::SparseMulticlassSVM::Prune(svm, 0.5);
+    REQUIRE(sparse.GetDim() == 4);
+    REQUIRE(sparse.GetModels()[0].indices == std::vector<uint32_t>({1, 3}));
+    REQUIRE(sparse.GetModels()[0].values == std::vector<double>({-3, 2}));
+    REQUIRE(sparse.GetModels()[1].indices == std::vector<uint32_t>({0, 2}));
+    REQUIRE(sparse.GetModels()[2].indices == std::vector<uint32_t>({0, 1}));
+    REQUIRE(sparse.GetModels()[2].bias == 3);
+    REQUIRE(sparse.GetNbNonZero() == 6);
+
+    // zero weights are never stored
+    auto dense = ml::SparseMulticlassSVM::Prune(svm, 0);
+    REQUIRE(dense.GetNbNonZero() == 11);
+
+    REQUIRE_THROWS_AS(ml::SparseMulticlassSVM::Prune(svm, 1), ml::Exception);
+}
+
+TEST_CASE("sparse prediction and accuracy budget", "sparse svm") {
+    std::vector<std::vector<double>> models = {{2.99943, 0.001}, {1.99984, -0.002}, {2.99876, 0.001}};
+    std::vector<double> biases = {-7.49945, -5.4998, -13.4973};
+    std::vector<int> labels = {1, 2, 3};
+    ml::MulticlassSVM svm(models, biases, labels);
+
+    std::vector<std::vector<double>> x = {{1, 1}, {2, 1}, {3, 1}, {4, 1}, {5, 1}, {6, 1}};
+    std::vector<int> y = {1, 1, 2, 2, 3, 3};
+    auto expected = svm.Predict(x);
+
+    auto sparse = ml::SparseMulticlassSVM::PruneToAccuracy(svm, x, y, 0);
+    REQUIRE(sparse.Predict(x) == expected);
+    // tiny second weights can go without losing accuracy
+    REQUIRE(sparse.GetNbNonZero() == 3);
+}
+
+TEST_CASE("sparse model file round trip", "sparse svm") {
+    std::vector<std::vector<double>> models = {{0.5, -1, 0.25}, {2, 0.25, -0.125}, {1, 1, 1}};
+    std::vector<double> biases = {0.125, -3, 7};
+    std::vector<int> labels = {4, 7, 9};
+    auto sparse = ml::SparseMulticlassSVM::Prune(ml::MulticlassSVM(models, biases, labels), 0.34);
+
+    std::string path = "test_sparse_model.ssvm";
+    ml::SaveSparseModel(sparse, path);
+    auto loaded = ml::ReadSparseModel(path);
+    std::remove(path.c_str());
+
+    REQUIRE(loaded.GetLabels() == labels);
+    REQUIRE(loaded.GetDim() == 3);
+    for (size_t i = 0; i < models.size(); ++i) {
+        REQUIRE(loaded.GetModels()[i].indices == sparse.GetModels()[i].indices);
+        REQUIRE(loaded.GetModels()[i].values == sparse.GetModels()[i].values);
+        REQUIRE(loaded.GetModels()[i].bias == biases[i]);
+    }
+
+    REQUIRE_THROWS(ml::ReadSparseModel("missing_model.ssvm"));
+}